@@ -33,30 +33,44 @@
 #include "openXpsTypes.h"
 
 
+/* A TCAM row. An ACE is expanded into several rows when its L4 port
+ * match can not be expressed by a single value/mask pair. */
 struct xp_acl_rule {
     struct ovs_list list_node;
     uint32_t        rule_id;
+    uint16_t        ace_idx;    /* Index of compiled ACE the row was expanded from */
+    uint32_t        priority;   /* TCAM manager priority of the row */
     uint8_t         counter_en;
     uint64_t        count;
 };
 
+/* A port or L3 interface the ACL ID of a classifier list is set on */
 struct xp_acl_interface {
     struct ovs_list     list_node;
-    xpsInterfaceId_t    intf_num;
+    xpsDevice_t         devId;
+    xpsInterfaceId_t    intf_num;   /* Port or L3 interface ID */
+    bool                l3;         /* intf_num is an L3 interface */
 };
 
+struct xp_acl_set;
+struct xp_cls_tcam_block;
+
+/* Rules of a classifier rule set programmed into an ACL table */
 struct xp_acl_entry {
-    struct hmap_node        hnode;      /* Node in a xp_acl hmap. */
-    struct uuid             list_uid;   /* uuid of classifier list in OVSDB */
-    uint8_t                 acl_id;     /* Identifies this list node inside XDK */
+    struct xp_acl_set       *acl_set;   /* Owning rule set */
+    struct uuid             list_uid;   /* uuid of classifier list the rows were created for */
+    uint8_t                 acl_id;     /* Identifies this list node inside XDK, owned by acl_set */
 
     /* Rule index list, maintained through a linked list */
     uint16_t                num_rules;  /* number of rules in this classifier list */
+    uint16_t                num_aces;   /* number of rules left after compiling the list */
+    uint32_t                num_rows;   /* number of TCAM rows the rules are expanded into */
+    struct ops_cls_list_entry *aces;    /* compiled rules as programmed, to diff updates against */
+    uint16_t                *ace_map;   /* index of the list rule each compiled rule stands for */
     struct ovs_list         rule_list;  /* list that holds rule ids in TCAM for the corresponding classifier rules in order */
+    struct xp_cls_tcam_block *block;    /* TCAM priorities reserved for the rows */
 
-    /* Interface list, maintained through a dynamic array (intial size 4) */
-    uint16_t                num_intfs;          /* number of interfaces on which ACL is applied */
-    struct ovs_list         intf_list;          /* list of interfaces on which ACL is applied */
+    uint16_t                num_intfs;          /* number of interfaces on which rule set is applied */
     struct ops_cls_interface_info   intf_info;  /* store interface type PORT or VLAN or TUNNEL*/
     enum ops_cls_direction  cls_direction;      /* indicates whether the classifier is applied on INGRESS or EGRESS*/
 };
@@ -66,6 +80,11 @@ typedef struct iacl_v4_key {
     uint8_t         size;
 } iacl_v4_key_t;
 
+typedef struct iacl_v6_key {
+    xpIaclV6KeyFlds v6_field;
+    uint8_t         size;
+} iacl_v6_key_t;
+
 int ops_xp_cls_apply(struct ops_cls_list *list, struct ofproto *ofproto,
                      void *aux, struct ops_cls_interface_info *interface_info,
                      enum ops_cls_direction direction,
@@ -103,5 +122,8 @@ int ops_xp_cls_stats_clear_all(struct ops_cls_pd_list_status *status);
 
 int ops_xp_cls_acl_log_pkt_register_cb(void (*callback_handler)(struct acl_log_info *));
 int ops_xp_cls_init(xpsDevice_t devId);
+void ops_xp_cls_run(void);
+void ops_xp_cls_wait(void);
+void ops_xp_cls_unixctl_init(void);
 
 #endif /* ops-xp-classifier.h */
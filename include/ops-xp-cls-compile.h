@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-cls-compile.h
+ *
+ * Purpose: This file provides public definitions for compiling OpenSwitch
+ *          classifier lists into TCAM entries for the Cavium/XPliant SDK.
+ */
+
+#ifndef OPS_XP_CLS_COMPILE_H
+#define OPS_XP_CLS_COMPILE_H 1
+
+#include "ops-cls-asic-plugin.h"
+
+/* Entries of a classifier list as they are programmed into TCAM. The
+ * compiled list matches the same packets with the same actions as the
+ * source list. Entries with counting enabled are kept as they are, so
+ * their hit counts stay per ACE. */
+struct xp_cls_compiled {
+    struct ops_cls_list_entry *entries;
+    uint16_t    *ace_idx;       /* Source list index of each entry */
+    uint32_t    n;              /* Number of compiled entries */
+    uint32_t    n_list;         /* Number of source list entries */
+    uint32_t    n_shadowed;     /* Dropped, covered by an earlier entry */
+    uint32_t    n_redundant;    /* Dropped, redundant with implicit deny */
+    uint32_t    n_merged;       /* Merged into the preceding entry */
+};
+
+void ops_xp_cls_compile(const struct ops_cls_list *list,
+                        struct xp_cls_compiled *comp);
+void ops_xp_cls_compiled_destroy(struct xp_cls_compiled *comp);
+
+uint32_t ops_xp_cls_entry_hash(const struct ops_cls_list_entry *entry,
+                               enum ops_cls_type list_type, uint32_t basis);
+bool ops_xp_cls_entry_equal(const struct ops_cls_list_entry *a,
+                            const struct ops_cls_list_entry *b,
+                            enum ops_cls_type list_type);
+
+#endif /* ops-xp-cls-compile.h */
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-cls-tcam.h
+ *
+ * Purpose: This file provides public definitions for TCAM space management
+ *          of OpenSwitch classifier tables for the Cavium/XPliant SDK.
+ */
+
+#ifndef OPS_XP_CLS_TCAM_H
+#define OPS_XP_CLS_TCAM_H 1
+
+#include "dynamic-string.h"
+#include "ovs/list.h"
+#include "openXpsTypes.h"
+
+/* Block of TCAM priorities reserved for rows of a single ACL. TCAM
+ * manager keeps rows ordered by priority, so rows of the ACL stay
+ * adjacent and inserting into the ACL only moves its own rows.
+ * Access is serialized by the classifier. */
+struct xp_cls_tcam_block {
+    struct ovs_list list_node;  /* Node in table's blocks, by base */
+    uint32_t        base;       /* Lowest priority of the block */
+    uint32_t        span;       /* Number of priorities in the block */
+    uint32_t        rows;       /* TCAM rows reserved for the ACL */
+};
+
+void ops_xp_cls_tcam_table_init(xpsDevice_t devId, uint32_t tableId,
+                                uint32_t size);
+
+struct xp_cls_tcam_block *ops_xp_cls_tcam_block_alloc(uint32_t tableId,
+                                                      uint32_t n_rows,
+                                                      uint32_t step);
+void ops_xp_cls_tcam_block_free(uint32_t tableId,
+                                struct xp_cls_tcam_block *block);
+uint32_t ops_xp_cls_tcam_block_release(uint32_t tableId,
+                                       struct xp_cls_tcam_block *block);
+void ops_xp_cls_tcam_block_reclaim(uint32_t tableId,
+                                   struct xp_cls_tcam_block *block,
+                                   uint32_t rows);
+
+XP_STATUS ops_xp_cls_tcam_entry_alloc(xpsDevice_t devId, uint32_t tableId,
+                                      uint32_t priority, uint32_t *rule_id);
+void ops_xp_cls_tcam_entry_free(xpsDevice_t devId, uint32_t tableId,
+                                uint32_t rule_id);
+
+void ops_xp_cls_tcam_defragmented(uint32_t tableId);
+void ops_xp_cls_tcam_format(struct ds *ds);
+
+#endif /* ops-xp-cls-tcam.h */
@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <ofproto/ofproto.h>
 #include "copp-asic-provider.h"
+#include "openXpsTypes.h"
 
 int ops_xp_copp_stats_get(const unsigned int hw_asic_id,
                           const enum copp_protocol_class class,
@@ -35,4 +36,8 @@ int ops_xp_copp_hw_status_get(const unsigned int hw_asic_id,
                               const enum copp_protocol_class class,
                               struct copp_hw_status *const hw_status);
 
+bool ops_xp_copp_police(xpsDevice_t dev_id, xpsPort_t port,
+                        const void *pkt, uint16_t size);
+void ops_xp_copp_unixctl_init(void);
+
 #endif /* ops-xp-copp.h */
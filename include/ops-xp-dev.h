@@ -26,6 +26,7 @@
 #include <netdev-provider.h>
 #include <latch.h>
 #include <hmap.h>
+#include <ovs/list.h>
 #include <ovs-thread.h>
 #include "ops-xp-port.h"
 
@@ -45,6 +46,20 @@
 #define XP_UNLOCK() \
         ops_xp_mutex_unlock();
 
+/* Buffer of a packet sent from CPU. The packet is built at data, behind
+ * the headroom reserved for the Tx header, so it is sent without a copy.
+ * Buffers come from a per-device pool, see ops_xp_dev_tx_buf_get(). */
+struct xp_tx_buf {
+    struct ovs_list list_node;      /* Node in pool's free list. */
+    uint8_t *data;                  /* Packet data. */
+    uint16_t size;                  /* Packet size. */
+    uint16_t room;                  /* Space for packet data. */
+    uint8_t queue;                  /* CPU Tx queue, set on send from
+                                     * the packet class. */
+    bool pooled;                    /* False if pool was empty. */
+    xpsInterfaceId_t dst_if_id;     /* Egress interface while queued. */
+};
+
 struct netdev_xpliant;
 struct xp_l3_mgr;
 struct xp_vlan_mgr;
@@ -56,6 +71,7 @@ struct xpliant_dev {
     xpRxConfigMode rx_mode;         /* Rx mode INTR/POLL */
     xpPacketInterface cpu_port_type;/* CPU interface type DMA/ETHER/NETDEV_DMA */
     pthread_t rxq_thread;           /* RxQ Thread ID. */
+    pthread_t txq_thread;           /* Async TxQ Thread ID. */
     pthread_t event_thread;         /* Event processing Thread ID. */
     struct latch exit_latch;        /* Tells child threads to exit. */
     struct latch rxq_latch;         /* Tells child threads to handle pkt Rx. */
@@ -89,6 +105,11 @@ struct xp_port_info *ops_xp_dev_get_port_info(xpsDevice_t id,
                                               xpsPort_t port_num);
 int ops_xp_dev_send(xpsDevice_t xp_dev_id, xpsInterfaceId_t dst_if_id,
                     void *buff, uint16_t buff_size);
+struct xp_tx_buf *ops_xp_dev_tx_buf_get(xpsDevice_t xp_dev_id);
+void ops_xp_dev_tx_buf_put(xpsDevice_t xp_dev_id, struct xp_tx_buf *tx_buf);
+int ops_xp_dev_send_buf(xpsDevice_t xp_dev_id, xpsInterfaceId_t dst_if_id,
+                        struct xp_tx_buf *tx_buf);
+void ops_xp_dev_unixctl_init(void);
 xp_host_if_type_t ops_xp_host_if_type_get(void);
 xpPacketInterface ops_xp_packet_if_type_get(void);
 int ops_xp_dev_add_intf_entry(struct xpliant_dev *xpdev,
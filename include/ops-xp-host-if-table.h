@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-host-if-table.h
+ *
+ * Purpose: This file provides public definitions for the table of host
+ *          interfaces shared by fd based host interface backends for the
+ *          Cavium/XPliant SDK.
+ */
+
+#ifndef OPS_XP_HOST_IF_TABLE_H
+#define OPS_XP_HOST_IF_TABLE_H 1
+
+#include <stdbool.h>
+#include <hmap.h>
+#include "ovs-atomic.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
+#include "openXpsTypes.h"
+#include "openXpsEnums.h"
+#include "openXpsInterface.h"
+
+/* Host interface backed by file descriptor @fd. Backends embed it into
+ * their own interface entries. Entries are freed by backends after an
+ * RCU grace period, so the receive path uses them without locking. */
+struct xp_host_if_entry {
+    /* Node in a if_id_map. */
+    struct hmap_node if_id_node;
+    /* Node in a fd_map. */
+    struct hmap_node fd_node;
+    xpsInterfaceId_t if_id;
+    /* ID of the interface which will be used for sending. Written under
+     * table's mutex, read by the receive path without it. */
+    ATOMIC(xpsInterfaceId_t) send_if_id;
+    int fd;
+    char *name;
+    atomic_bool filter_created;
+    /* Port the entry is mapped to in port_map, XP_MAX_TOTAL_PORTS if
+     * none. */
+    xpsPort_t port;
+};
+
+/* Interface entries by port. Replaced as a whole under table's mutex,
+ * read by receive path without locking. */
+struct xp_host_if_port_map {
+    struct xp_host_if_entry *entries[XP_MAX_TOTAL_PORTS];
+};
+
+struct xp_host_if_table {
+    struct ovs_mutex mutex;
+    /* XPS intf ID to xp_host_if_entry map. Filtered entries only. */
+    struct hmap if_id_map;
+    /* FD to xp_host_if_entry map. */
+    struct hmap fd_map;
+    /* Entries of filtered interfaces by port. */
+    OVSRCU_TYPE(struct xp_host_if_port_map *) port_map;
+};
+
+void ops_xp_host_if_table_init(struct xp_host_if_table *table);
+void ops_xp_host_if_table_destroy(struct xp_host_if_table *table);
+
+void ops_xp_host_if_entry_init(struct xp_host_if_entry *entry,
+                               xpsInterfaceId_t if_id, int fd,
+                               const char *name);
+void ops_xp_host_if_entry_destroy(struct xp_host_if_entry *entry);
+
+void ops_xp_host_if_table_insert(struct xp_host_if_table *table,
+                                 struct xp_host_if_entry *entry);
+struct xp_host_if_entry *
+ops_xp_host_if_table_remove(struct xp_host_if_table *table, int fd);
+
+int ops_xp_host_if_table_filter_create(struct xp_host_if_table *table,
+                                       xpsInterfaceId_t xps_if_id, int fd,
+                                       int *filter_id);
+int ops_xp_host_if_table_filter_delete(struct xp_host_if_table *table,
+                                       int filter_id);
+int ops_xp_host_if_table_control_id_set(struct xp_host_if_table *table,
+                                        xpsDevice_t dev_id,
+                                        xpsInterfaceId_t xps_if_id, int fd,
+                                        bool set);
+
+/* Returns the current port map of @table. Valid until the caller
+ * quiesces. */
+static inline struct xp_host_if_port_map *
+ops_xp_host_if_table_port_map(struct xp_host_if_table *table)
+{
+    return ovsrcu_get(struct xp_host_if_port_map *, &table->port_map);
+}
+
+#endif /* ops-xp-host-if-table.h */
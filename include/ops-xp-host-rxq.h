@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-host-rxq.h
+ *
+ * Purpose: This file provides public definitions for CPU receive queues
+ *          of host interfaces for the Cavium/XPliant SDK.
+ */
+
+#ifndef OPS_XP_HOST_RXQ_H
+#define OPS_XP_HOST_RXQ_H 1
+
+#include <stdbool.h>
+#include <ovs/list.h>
+#include "openXpsTypes.h"
+
+/* Packet trapped to CPU, waiting in a receive queue. */
+struct xp_rxq_pkt {
+    struct ovs_list list_node;      /* Node in queue's pending list. */
+    xpsPort_t port;                 /* Ingress port. */
+    uint16_t size;                  /* Packet size. */
+    bool pooled;                    /* Buffer is from the queue's pool. */
+    uint8_t data[];                 /* Packet data. */
+};
+
+/* Delivers @n packets to host interfaces. Called by the worker thread of
+ * a receive queue, which is not quiescent during the call. Packets are
+ * returned to the queue by the caller. */
+typedef void xp_rxq_deliver_cb(void *aux, struct xp_rxq_pkt **pkts,
+                               size_t n);
+
+struct xp_rxq_set;
+
+struct xp_rxq_set *ops_xp_host_rxq_create(xpsDevice_t dev_id,
+                                          xp_rxq_deliver_cb *deliver,
+                                          void *aux);
+void ops_xp_host_rxq_destroy(struct xp_rxq_set *set);
+int ops_xp_host_rxq_enqueue(struct xp_rxq_set *set, xpsPort_t port,
+                            const void *buf, uint16_t size);
+void ops_xp_host_rxq_unixctl_init(void);
+
+#endif /* ops-xp-host-rxq.h */
@@ -35,6 +35,7 @@ struct xpliant_dev;
 typedef enum {
     XP_HOST_IF_XPNET,
     XP_HOST_IF_TAP,
+    XP_HOST_IF_PACKET,
     XP_HOST_IF_DEFAULT = XP_HOST_IF_TAP
 } xp_host_if_type_t;
 
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-netlink.h
+ *
+ * Purpose: This file provides public definitions for OpenSwitch kernel
+ *          link configuration over rtnetlink for the Cavium/XPliant SDK.
+ */
+
+#ifndef OPS_XP_NETLINK_H
+#define OPS_XP_NETLINK_H 1
+
+#include <stdbool.h>
+#include <net/ethernet.h>
+
+/* Maximum number of requests queued in a batch. Batch is committed
+ * automatically once it is full. */
+#define XP_NL_BATCH_MAX     64
+
+/* A set of rtnetlink requests sent to kernel in a single transaction. */
+struct xp_nl_batch;
+
+struct xp_nl_batch *ops_xp_nl_batch_create(void);
+void ops_xp_nl_batch_destroy(struct xp_nl_batch *batch);
+int ops_xp_nl_batch_commit(struct xp_nl_batch *batch);
+
+int ops_xp_nl_batch_link(struct xp_nl_batch *batch, const char *if_name,
+                         const struct ether_addr *mac, bool up);
+int ops_xp_nl_batch_veth(struct xp_nl_batch *batch, bool add,
+                         const char *if_name, const char *peer_name);
+
+#endif /* ops-xp-netlink.h */
@@ -25,9 +25,27 @@
 
 #include <net/if.h>
 #include <ofproto/ofproto.h>
+#include "simap.h"
 #include "openXpsL3.h"
 
 
+/* HW L3 tables occupancy as programmed by the L3 manager.
+ * Guarded by owning xp_l3_mgr's mutex */
+typedef struct {
+    uint32_t ipv4_routes;       /* IPv4 routes in LPM table */
+    uint32_t ipv6_routes;       /* IPv6 routes in LPM table */
+    uint32_t hosts;             /* Entries in host table */
+    uint32_t host_routes;       /* Host routes placed into host table */
+    uint32_t nh_groups;         /* NextHop groups in NH table */
+    uint32_t nh_entries;        /* NextHop entries in NH table */
+    uint32_t route_failures;    /* Failed LPM table insertions */
+    uint32_t host_failures;     /* Failed host table insertions */
+    uint32_t host_route_fallbacks;  /* Host routes placed into LPM table
+                                     * since host table insertion failed */
+    uint32_t stale_route_retries;   /* Retries of routes whose placement
+                                     * or host entry update failed */
+} xp_l3_hw_usage_t;
+
 typedef struct {
     struct ovs_refcount ref_cnt;
     struct ovs_mutex mutex;
@@ -41,6 +59,17 @@ typedef struct {
     struct hmap host_id_map;    /* Hosts by ID value */
 
     uint32_t ecmp_hash;
+    uint32_t ecmp_buckets;      /* Buckets of resilient ECMP groups.
+                                 * 0 if resilient hashing is disabled */
+    struct simap nh_weights;    /* ECMP weights of NHs by NH ID */
+
+    xp_l3_hw_usage_t hw_usage;  /* HW L3 tables occupancy */
+    bool route_compression;     /* Do not program routes whose NH group is
+                                 * the same as of their covering prefix */
+    struct ovs_list stale_routes;   /* Routes which could not be placed
+                                     * into HW or whose host table entry
+                                     * could not be updated */
+    long long int stale_retry_time; /* When to retry stale routes */
 
     void *dbg;                  /* Debugging hooks */
 } xp_l3_mgr_t;
@@ -49,21 +78,17 @@ typedef struct {
     struct hmap_node hmap_node; /* Node in a xp_l3_mgr's nh_group_map. */
     struct hmap nh_map;         /* NextHops in ECMP group */
     struct ovs_refcount ref_cnt;/* How many routes reference to this NH group */
+    struct ovs_list host_routes;/* Routes of this group in host table */
     uint32_t nh_id;
     uint32_t size;
     uint32_t hash;
+    bool in_hw;                 /* HW NH entries have been allocated */
+    uint32_t n_buckets;         /* HW NH entries of resilient or weighted
+                                 * group. 0 if each NH has a single HW NH
+                                 * entry */
+    struct xp_nh_entry **buckets;   /* NH of each bucket of resilient group */
 } xp_nh_group_entry_t;
 
-/* A route MAP entry.
- * Guarded by owning xp_l3_mgr's mutex */
-typedef struct {
-    struct hmap_node hmap_node; /* Node in a xp_l3_mgr's route_map. */
-    char *prefix;
-    struct ovs_refcount ref_cnt;/* Number of references to this route */
-    xpsL3RouteEntry_t xp_route;
-    xp_nh_group_entry_t *nh_group;
-} xp_route_entry_t;
-
 /* A host MAP entry.
  * Guarded by owning xp_l3_mgr's mutex */
 typedef struct {
@@ -78,13 +103,36 @@ typedef struct {
     uint32_t id;    /* Host HW entry ID which must be constant */
 } xp_host_entry_t;
 
+/* A route MAP entry.
+ * Guarded by owning xp_l3_mgr's mutex */
+typedef struct xp_route_entry {
+    struct hmap_node hmap_node; /* Node in a xp_l3_mgr's route_map. */
+    char *prefix;
+    struct ovs_refcount ref_cnt;/* Number of references to this route */
+    xpsL3RouteEntry_t xp_route;
+    xp_nh_group_entry_t *nh_group;
+    bool in_hw;                 /* Route is programmed into LPM or host
+                                 * table */
+    xp_host_entry_t *host;      /* Host table entry if host route has been
+                                 * placed into host table. NULL otherwise */
+    struct ovs_list host_node;  /* Node in a NH group's host_routes list. */
+    struct ovs_list stale_node; /* Node in a xp_l3_mgr's stale_routes list
+                                 * if route is missing from HW or its host
+                                 * table entry is out of date. */
+    struct xp_route_entry *cover;   /* Closest covering route if this route
+                                     * is not in HW. NULL otherwise */
+    struct ovs_list cover_node; /* Node in a cover's covered list. */
+    struct ovs_list covered;    /* Routes not in HW covered by this route. */
+} xp_route_entry_t;
+
 /* A nh MAP entry.
  * Guarded by owning xp_l3_mgr's mutex */
-typedef struct {
+typedef struct xp_nh_entry {
     struct hmap_node hmap_node; /* Node in nh_map of NH group. */
     xpsL3NextHopEntry_t xp_nh;  /* NH entry in HW */
     uint32_t xp_nh_id;          /* NH ID in the HW */
     char *id;                   /* NH ID in OPS */
+    uint32_t weight;            /* ECMP weight */
     bool nh_port;
 } xp_nh_entry_t;
 
@@ -108,6 +156,9 @@ xp_l3_mgr_t *ops_xp_l3_mgr_create(xpsDevice_t devId);
 xp_l3_mgr_t *ops_xp_l3_mgr_ref(xp_l3_mgr_t *mgr);
 void ops_xp_l3_mgr_unref(struct ofproto_xpliant *ofproto);
 void ops_xp_l3_mgr_destroy(struct ofproto_xpliant *ofproto);
+void ops_xp_l3_mgr_get_memory_usage(xp_l3_mgr_t *mgr, struct simap *usage);
+void ops_xp_routing_run(struct ofproto_xpliant *ofproto);
+void ops_xp_routing_wait(struct ofproto_xpliant *ofproto);
 
 int ops_xp_routing_add_host_entry(struct ofproto_xpliant *ofproto,
                                   xpsInterfaceId_t port_intf_id,
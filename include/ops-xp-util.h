@@ -120,6 +120,22 @@ struct arp_hdr {
     ovs_be32 t_ip;                  /* Target IP address  */
 }__attribute__((packed));
 
+/* Headers of an Ethernet frame sent to or from CPU, as parsed by
+ * ops_xp_pkt_parse(). The packet paths classify frames by these. */
+struct xp_pkt_hdrs {
+    const uint8_t *eth_dst;         /* Destination MAC address */
+    uint16_t eth_type;              /* Behind VLAN tags, if any */
+    bool link_local;                /* Sent to 01:80:C2:00:00:0X */
+    bool ip;                        /* Complete IPv4 or IPv6 header */
+    bool ip_options;                /* IPv4 options or IPv6 hop-by-hop */
+    bool ip_mcast;                  /* IP multicast or IPv4 broadcast */
+    uint8_t ip_proto;               /* Next header for IPv6 */
+    uint8_t ip_ttl;                 /* Hop limit for IPv6 */
+    bool l4_ports;                  /* TCP or UDP ports below are set */
+    uint16_t src_port;
+    uint16_t dst_port;
+};
+
 /* Max number for a frame(value taken from XDK) */
 #define RX_MAX_FRM_LEN_MAX_VAL   16384
 
@@ -147,11 +163,11 @@ int ops_xp_string_to_prefix(int family, const char *ip_address, void *prefix,
                             unsigned char *prefixlen);
 int ops_xp_parse_ip_str(const char *ip_str, ovs_be32 *ip);
 int ops_xp_parse_netmask_str(const char *netmask_str, ovs_be32 *mask);
-int ops_xp_linux_route_update(bool route_add, const char *prefix,
-                              const char *nh, bool nh_port);
 bool ops_xp_is_l3_packet(void *buf, uint16_t bufSize);
 bool ops_xp_is_arp_packet(void *buf, uint16_t bufSize);
 bool ops_xp_is_ip_packet(void *buf, uint16_t bufSize);
+bool ops_xp_pkt_parse(const uint8_t *pkt, size_t size,
+                      struct xp_pkt_hdrs *hdrs);
 void ops_xp_mac_copy_and_reverse(uint8_t *dst, const uint8_t *src);
 void ops_xp_ip_addr_copy_and_reverse(uint8_t *dst_ip, const uint8_t *src_ip,
                                      bool is_ipv6_addr);
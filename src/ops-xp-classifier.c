@@ -21,8 +21,14 @@
  */
 
 #include "ops-xp-classifier.h"
+#include <limits.h>
 #include <unistd.h>
 #include <uuid.h>
+#include "dynamic-string.h"
+#include "hash.h"
+#include "ovs-thread.h"
+#include "poll-loop.h"
+#include "timeval.h"
 #include "openvswitch/vlog.h"
 #include "ofproto/ofproto-provider.h"
 #include "openXpsAclIdMgr.h"
@@ -34,19 +40,138 @@
 #include "openXpsTypes.h"
 #include "ops-cls-asic-plugin.h"
 #include "ops-xp-ofproto-provider.h"
+#include "ops-xp-cls-compile.h"
+#include "ops-xp-cls-tcam.h"
+#include "unixctl.h"
 
 VLOG_DEFINE_THIS_MODULE(xp_classifier);
 
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
 
-/* hmap data structure stores classifier and its entries */
-struct hmap classifier_hmap_pacl;
-struct hmap classifier_hmap_racl;
-struct hmap classifier_hmap_bacl;
+/* Number of rows in each IACL TCAM table */
+#define XP_CLS_TCAM_TABLE_SIZE      512
+
+/* Width in bits of IACL table keys. Both IPv4 and IPv6 keys have to
+ * fit into it */
+#define XP_CLS_IACL_KEY_SIZE        390
+
+/* Maximum number of value/mask pairs a 16 bit L4 port
+ * match may be expanded into */
+#define XP_CLS_L4_PORT_PREFIX_MAX   32
+
+/* Distance between TCAM priorities of adjacent entries. The gaps let
+ * incremental updates insert entries without touching their neighbors */
+#define XP_CLS_PRIORITY_STEP        16
+
+/* Number of row descriptors the pool grows by when it runs empty */
+#define XP_CLS_RULE_POOL_GROW       64
+
+/* Interval in ms HW hit counters of ACL rows are harvested at. HW
+ * counters are cleared on read, so the values are accumulated in SW */
+#define XP_CLS_STATS_INTERVAL       1000
+
+/* Number of counted ACL rows harvested per hold of cls_mutex */
+#define XP_CLS_STATS_BATCH          256
+
+/* Interval in ms ACL rows are checked for fragmentation at */
+#define XP_CLS_DEFRAG_INTERVAL      10000
+
+/* Value/mask pair matching a block of L4 ports.
+ * Bits set in mask are significant */
+struct xp_cls_port_prefix {
+    uint16_t value;
+    uint16_t mask;
+};
+
+/* TCAM row waiting to be written into hw */
+struct xp_cls_batch_row {
+    struct xp_acl_rule              *rule;
+    const struct ops_cls_list_entry *ace;
+    struct xp_cls_port_prefix       src;
+    struct xp_cls_port_prefix       dst;
+};
+
+/* Rows of a classifier programmed together. TCAM entries of all rows
+ * are allocated first, so TCAM manager only moves rows not written yet,
+ * then the rows are written in one pass reusing the scratch key/data */
+struct xp_cls_batch {
+    struct xp_acl_entry         *classifier;
+    uint32_t                    tableId;
+    struct xp_cls_batch_row     *rows;
+    size_t                      n_rows;
+    size_t                      allocated_rows;
+};
+
+/* Scratch keys and data every TCAM row is built in */
+static xpsIaclkeyFieldList_t *cls_field;
+static xpsIaclData_t *cls_data;
+static xpsIaclkeyFieldList_t *cls_field_v6;
+static xpsIaclData_t *cls_data_v6;
+
+/* Unused TCAM row descriptors. They are reserved in blocks for a whole
+ * list and recycled here once the rows are released */
+static struct ovs_list cls_rule_pool;
+static size_t cls_rule_pool_size;
+
+/* Rule set programmed into TCAM. Classifier lists with identical entries
+ * share the set, hence the ACL ID and the TCAM rows selected by it.
+ * Lists counting hits have sets of their own. */
+struct xp_acl_set {
+    struct hmap_node        hnode;      /* Node in cls_acl_sets */
+    uint32_t                hash;       /* Hash of the entries */
+    uint8_t                 acl_id;     /* Identifies the set inside XDK */
+    uint32_t                ref_cnt;    /* Number of lists using the set */
+    enum ops_cls_type       list_type;  /* IPv4 or IPv6 ACL */
+    int                     num_entries;
+    struct ops_cls_list_entry *entries; /* Entries the set was built from */
+    struct xp_acl_entry     *tables[XP_ACML_TOTAL_TYPE];    /* Rows per ACL table */
+};
+
+/* An ACL by its classifier list UUID */
+struct xp_acl {
+    struct hmap_node        hnode;      /* Node in cls_acl_registry */
+    struct uuid             list_uid;   /* uuid of classifier list in OVSDB */
+    struct xp_acl_set       *acl_set;   /* Rule set the list is programmed with */
+    uint16_t                num_intfs[XP_ACML_TOTAL_TYPE];  /* Bindings per ACL table */
+    struct ovs_list         intfs[XP_ACML_TOTAL_TYPE];      /* Interfaces ACL ID is set on */
+};
+
+/* All ACLs by classifier list UUID */
+static struct hmap cls_acl_registry;
+
+/* All rule sets by hash of their entries */
+static struct hmap cls_acl_sets;
+
+/* Guards the registries against the counters harvesting thread */
+static struct ovs_mutex cls_mutex = OVS_MUTEX_INITIALIZER;
+
+/* Time of the next periodic fragmentation check. Set once the
+ * classifier is initialized */
+static long long int cls_defrag_time = LLONG_MAX;
+
+/* Device the hit counters are harvested from */
+static xpsDevice_t cls_dev_id;
+
+/* Position of the counters harvester in cls_acl_sets. The registries
+ * may change between harvested chunks, so a row may be skipped or read
+ * twice in a round. HW counters are cleared on read, so nothing is lost
+ * or counted twice either way */
+struct xp_cls_stats_cursor {
+    uint32_t    bucket;     /* hmap_at_position() position of the set */
+    uint32_t    offset;
+    int         table;      /* ACL table of the set */
+    size_t      row;        /* Next row of the table */
+};
+
+void ops_xp_cls_acl_delete(struct xp_acl_entry *acl_entry);
 
 int key_failed_pacl = 0;
 int key_failed_racl = 0;
 int key_failed_bacl = 0;
 
+/* IPv6 keys are defined in IACL tables */
+static bool cls_v6_supported;
+
 typedef enum 
 {
     OPS_XP_IACL_KEY_TYPE_V4,
@@ -89,6 +214,32 @@ iacl_v4_key_t iacl_key_v4[OPS_XP_IACL_V4_MAX_FIELDS] =
 };
 
 
+typedef enum
+{
+    OPS_XP_IACL_KEY_TYPE_V6,
+    OPS_XP_IACL_ID_V6,
+    OPS_XP_IACL_DIP_V6,
+    OPS_XP_IACL_SIP_V6,
+    OPS_XP_IACL_L4_V6_DEST_PORT,
+    OPS_XP_IACL_L4_V6_SRC_PORT,
+    OPS_XP_IACL_ICMP_V6_MSG_TYPE,
+    OPS_XP_IACL_NXT_HDR,
+    OPS_XP_IACL_V6_MAX_FIELDS
+} ops_v6_key_fields;
+
+/* Sizes are in bytes */
+iacl_v6_key_t iacl_key_v6[OPS_XP_IACL_V6_MAX_FIELDS] =
+{
+    { XP_IACL_KEY_TYPE_V6, 1},
+    { XP_IACL_ID_V6, 1},
+    { XP_IACL_DIP_V6, 16},
+    { XP_IACL_SIP_V6, 16},
+    { XP_IACL_L4_V6_DEST_PORT, 2},
+    { XP_IACL_L4_V6_SRC_PORT, 2},
+    { XP_IACL_ICMP_V6_MSG_TYPE, 1},
+    { XP_IACL_NXT_HDR, 1},
+};
+
 uint32_t iaclV4KeyByteMask[] =
 {
     0x1,//keyType
@@ -169,12 +320,78 @@ ops_xp_alloc_reset_field_data(xpsIaclkeyFieldList_t **field_new,
     *iaclData_new = iaclData;
 }
 
+/*
+ * reset field list allocated by ops_xp_alloc_reset_field_data
+ * to an empty key without reallocating it
+ */
+static void
+ops_xp_cls_reset_field_data(xpsIaclkeyFieldList_t *field,
+                            xpsIaclData_t *iaclData)
+{
+    field->numFlds = OPS_XP_IACL_V4_MAX_FIELDS;
+    field->isValid = 0x0;
+    field->type = XP_IACL_V4_TYPE;
+    for (int i = 0; i < OPS_XP_IACL_V4_MAX_FIELDS; i++) {
+        field->fldList[i].fld.v4Fld = iacl_key_v4[i].v4_field;
+        memset(field->fldList[i].value, 0x0, iacl_key_v4[i].size);
+        memset(field->fldList[i].mask, 0xff, iacl_key_v4[i].size);
+    }
+
+    memset(iaclData, 0x0, sizeof(xpsIaclData_t));
+}
+
+/*
+ * reset IPv6 field list allocated by ops_xp_alloc_reset_field_data_v6
+ * to an empty key without reallocating it
+ */
+static void
+ops_xp_cls_reset_field_data_v6(xpsIaclkeyFieldList_t *field,
+                               xpsIaclData_t *iaclData)
+{
+    field->numFlds = OPS_XP_IACL_V6_MAX_FIELDS;
+    field->isValid = 0x0;
+    field->type = XP_IACL_V6_TYPE;
+    for (int i = 0; i < OPS_XP_IACL_V6_MAX_FIELDS; i++) {
+        field->fldList[i].fld.v6Fld = iacl_key_v6[i].v6_field;
+        memset(field->fldList[i].value, 0x0, iacl_key_v6[i].size);
+        memset(field->fldList[i].mask, 0xff, iacl_key_v6[i].size);
+    }
+
+    memset(iaclData, 0x0, sizeof(xpsIaclData_t));
+}
+
+/*
+ * reset IPv6 field list to install/delete from hw
+ */
+void
+ops_xp_alloc_reset_field_data_v6(xpsIaclkeyFieldList_t **field_new,
+                                 xpsIaclData_t **iaclData_new)
+{
+    xpsIaclkeyFieldList_t   *field;
+    xpsIaclData_t           *iaclData;
+
+    field = xzalloc(sizeof(xpsIaclkeyFieldList_t));
+    field->fldList = xcalloc(OPS_XP_IACL_V6_MAX_FIELDS,
+                             sizeof(xpIaclkeyField_t));
+    iaclData = xzalloc(sizeof(xpsIaclData_t));
+
+    for (int i = 0; i < OPS_XP_IACL_V6_MAX_FIELDS; i++) {
+        field->fldList[i].value = xmalloc(iacl_key_v6[i].size);
+        field->fldList[i].mask = xmalloc(iacl_key_v6[i].size);
+    }
+
+    ops_xp_cls_reset_field_data_v6(field, iaclData);
+
+    *field_new = field;
+    *iaclData_new = iaclData;
+}
+
 void
 ops_xp_free_field_data(xpsIaclkeyFieldList_t *field,
                        xpsIaclData_t *iaclData)
 {
     VLOG_DBG("%s", __FUNCTION__);
-    for (int i= 0; i < OPS_XP_IACL_V4_MAX_FIELDS; i++) {
+    for (int i= 0; i < field->numFlds; i++) {
         free(field->fldList[i].value);
         free(field->fldList[i].mask);
     }
@@ -191,28 +408,39 @@ ops_xp_acl_table_init(xpsDevice_t devId)
     xpsIaclkeyFieldList_t   *fields_pacl, *fields_bacl, *fields_racl;
     xpsIaclData_t           *iaclData_pacl, *iaclData_bacl, *iaclData_racl;
     XP_STATUS               status = XP_NO_ERR;
+    uint32_t                key_size_v6 = 0;
+    int                     rc = 0;
 
     VLOG_DBG("%s", __FUNCTION__);
 
     VLOG_DBG("Initializing ACL tables %s", __FUNCTION__);
 
+    /* Tables are sized for the widest key type */
+    for (int i = 0; i < OPS_XP_IACL_V6_MAX_FIELDS; i++) {
+        key_size_v6 += iacl_key_v6[i].size * 8;
+    }
+    if (key_size_v6 > XP_CLS_IACL_KEY_SIZE) {
+        VLOG_ERR("IPv6 IACL key of %u bits does not fit into %u bits",
+                 key_size_v6, XP_CLS_IACL_KEY_SIZE);
+        rc = EINVAL;
+    }
 
     /* Populate table profiles data */
     tableProfile.numTables = XP_IACL_TOTAL_TYPE;
 
     /* Populate PACL config */
     tableProfile.tableProfile[XP_ACL_IACL0].tblType = XP_ACL_IACL0; 
-    tableProfile.tableProfile[XP_ACL_IACL0].keySize = 390; 
+    tableProfile.tableProfile[XP_ACL_IACL0].keySize = XP_CLS_IACL_KEY_SIZE;
     tableProfile.tableProfile[XP_ACL_IACL0].numDb = 1; 
 
     /* Populate BACL config */
     tableProfile.tableProfile[XP_ACL_IACL1].tblType = XP_ACL_IACL1; 
-    tableProfile.tableProfile[XP_ACL_IACL1].keySize = 390; 
+    tableProfile.tableProfile[XP_ACL_IACL1].keySize = XP_CLS_IACL_KEY_SIZE;
     tableProfile.tableProfile[XP_ACL_IACL1].numDb = 1;
 
     /* Populate RACL config */
     tableProfile.tableProfile[XP_ACL_IACL2].tblType = XP_ACL_IACL2; 
-    tableProfile.tableProfile[XP_ACL_IACL2].keySize = 390; 
+    tableProfile.tableProfile[XP_ACL_IACL2].keySize = XP_CLS_IACL_KEY_SIZE;
     tableProfile.tableProfile[XP_ACL_IACL2].numDb = 1; 
 
     xpsIaclCreateTable(devId, tableProfile);
@@ -241,14 +469,173 @@ ops_xp_acl_table_init(xpsDevice_t devId)
     }
     ops_xp_free_field_data(fields_racl, iaclData_racl);
 
+    cls_v6_supported = !rc;
+    if (!cls_v6_supported) {
+        VLOG_ERR("IPv6 IACL keys are not defined");
+        return rc;
+    }
+
+    /* IPv6 keys for IACL tables */
+    ops_xp_alloc_reset_field_data_v6(&fields_pacl, &iaclData_pacl);
+    fields_pacl->isValid = 0x1;
+    status = xpsIaclDefinePaclKey(devId, XP_IACL_V6_TYPE, fields_pacl);
+
+    if (status != XP_NO_ERR) {
+        key_failed_pacl = 1;
+    }
+    ops_xp_free_field_data(fields_pacl, iaclData_pacl);
+
+    ops_xp_alloc_reset_field_data_v6(&fields_bacl, &iaclData_bacl);
+    fields_bacl->isValid = 0x1;
+    status = xpsIaclDefineBaclKey(devId, XP_IACL_V6_TYPE, fields_bacl);
+
+    if (status != XP_NO_ERR) {
+        key_failed_bacl = 1;
+    }
+    ops_xp_free_field_data(fields_bacl, iaclData_bacl);
+
+    ops_xp_alloc_reset_field_data_v6(&fields_racl, &iaclData_racl);
+    fields_racl->isValid = 0x1;
+    status = xpsIaclDefineRaclKey(devId, XP_IACL_V6_TYPE, fields_racl);
+
+    if (status != XP_NO_ERR) {
+        key_failed_racl = 1;
+    }
+    ops_xp_free_field_data(fields_racl, iaclData_racl);
+
     VLOG_DBG("Init completed ACL %s", __FUNCTION__);
+
+    return 0;
+}
+
+/*
+ * Get ACM client counting hits of the ACL table. Returns false if rows
+ * of the table have no counters.
+ */
+static bool
+ops_xp_cls_counter_client(xpAclType_e acl_type, xpAcmClient_e *client)
+{
+    switch (acl_type) {
+    case XP_ACL_IACL0:
+        *client = XP_ACM_IPACL_COUNTER;
+        return true;
+
+    case XP_ACL_IACL1:
+        *client = XP_ACM_IBACL_COUNTER;
+        return true;
+
+    case XP_ACL_IACL2:
+        *client = XP_ACM_IRACL_COUNTER;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/*
+ * Accumulate HW hit counters of up to XP_CLS_STATS_BATCH counted ACL rows
+ * into their SW counters, starting at cursor. Returns false once all rule
+ * sets have been harvested
+ */
+static bool
+ops_xp_cls_stats_harvest(xpsDevice_t devId,
+                         struct xp_cls_stats_cursor *cursor)
+    OVS_REQUIRES(cls_mutex)
+{
+    struct xp_acl_set   *acl_set;
+    struct xp_acl_rule  *entry;
+    struct hmap_node    *node;
+    xpAcmClient_e       client;
+    uint32_t            tcamId;
+    uint64_t            count_pkts, count_bytes;
+    XP_STATUS           status;
+    uint32_t            bucket, offset;
+    size_t              n = 0;
+
+    for (;;) {
+        bucket = cursor->bucket;
+        offset = cursor->offset;
+        node = hmap_at_position(&cls_acl_sets, &bucket, &offset);
+        if (!node) {
+            return false;
+        }
+        acl_set = CONTAINER_OF(node, struct xp_acl_set, hnode);
+
+        for (int i = cursor->table; i < XP_ACML_TOTAL_TYPE;
+             i++, cursor->row = 0) {
+            size_t row = 0;
+
+            cursor->table = i;
+            if (!acl_set->tables[i] || !ops_xp_cls_counter_client(i, &client)) {
+                continue;
+            }
+
+            LIST_FOR_EACH (entry, list_node, &acl_set->tables[i]->rule_list) {
+                if (row++ < cursor->row || !entry->counter_en) {
+                    continue;
+                }
+
+                if (n++ == XP_CLS_STATS_BATCH) {
+                    cursor->row = row - 1;
+                    return true;
+                }
+
+                count_pkts = 0;
+                count_bytes = 0;
+
+                /* Rows may be moved by TCAM manager, so resolve
+                 * HW index every time */
+                XP_LOCK();
+                if (xpsTcamMgrTcamIdFromEntryGet(devId, i, entry->rule_id,
+                                                 &tcamId) != XP_NO_ERR) {
+                    XP_UNLOCK();
+                    continue;
+                }
+                status = xpsAcmGetCounterValue(devId, client, tcamId,
+                                               &count_pkts, &count_bytes);
+                XP_UNLOCK();
+
+                if (status == XP_NO_ERR) {
+                    entry->count += count_pkts;
+                }
+            }
+        }
+
+        /* Move on to the next set */
+        cursor->bucket = bucket;
+        cursor->offset = offset;
+        cursor->table = 0;
+        cursor->row = 0;
+    }
+}
+
+static void *
+ops_xp_cls_stats_handler(void *arg OVS_UNUSED)
+{
+    for (;;) {
+        struct xp_cls_stats_cursor cursor;
+        bool more;
+
+        /* ACL programming waits for cls_mutex at most one chunk */
+        memset(&cursor, 0, sizeof cursor);
+        do {
+            ovs_mutex_lock(&cls_mutex);
+            more = ops_xp_cls_stats_harvest(cls_dev_id, &cursor);
+            ovs_mutex_unlock(&cls_mutex);
+        } while (more);
+
+        poll_timer_wait(XP_CLS_STATS_INTERVAL);
+        poll_block();
+    }
+
+    return NULL;
 }
 
 int
 ops_xp_cls_init(xpsDevice_t dev)
 {
     xpsDevice_t devId; 
-    XP_STATUS   status;
 
     devId = dev;
 
@@ -257,68 +644,36 @@ ops_xp_cls_init(xpsDevice_t dev)
     /* Classifier related initializations */
     /* Creating and configuring TCAM Manager tables for IACLs and EACL */
     VLOG_DBG("Initializing TCAM Manager and hmap %s", __FUNCTION__);
-    status = XP_NO_ERR;
-
-    /* Port IACL */
-    status = xpsTcamMgrAddTable(devId, XP_ACL_IACL0, XPS_TCAM_LIST_ALGORITHM);
-    if (status != XP_NO_ERR) {
-        VLOG_INFO("xpsTcamMgrAddTable failed with error code %d, "
-                  "for table type  %s", status, XP_ACL_IACL0);
-    }
-    
-    status = xpsTcamMgrConfigTable(devId, XP_ACL_IACL0, &xpsTcamMgrRuleMoveAcl, 512, 16);
-    if (status != XP_NO_ERR) {
-        VLOG_INFO("xpsTcamMgrConfigTable failed with error code %d, "
-                  "for table type  %s", status, XP_ACL_IACL0);
-    }
-
-    /* Bridge IACL */
-    status = xpsTcamMgrAddTable(devId, XP_ACL_IACL1, XPS_TCAM_LIST_ALGORITHM);
-    if (status != XP_NO_ERR) {
-        VLOG_INFO("xpsTcamMgrAddTable failed with error code %d, "
-                  "for table type  %s", status, XP_ACL_IACL1);
-    }
 
-    status = xpsTcamMgrConfigTable(devId, XP_ACL_IACL1, &xpsTcamMgrRuleMoveAcl, 512, 16);
-    if (status != XP_NO_ERR) {
-        VLOG_INFO("xpsTcamMgrConfigTable failed with error code %d, "
-                  "for table type  %s", status, XP_ACL_IACL1);
-    }
+    ops_xp_cls_tcam_table_init(devId, XP_ACL_IACL0, XP_CLS_TCAM_TABLE_SIZE);
+    ops_xp_cls_tcam_table_init(devId, XP_ACL_IACL1, XP_CLS_TCAM_TABLE_SIZE);
+    ops_xp_cls_tcam_table_init(devId, XP_ACL_IACL2, XP_CLS_TCAM_TABLE_SIZE);
+    ops_xp_cls_tcam_table_init(devId, XP_ACL_EACL, XP_CLS_TCAM_TABLE_SIZE);
 
-    /* Router IACL */
-    status = xpsTcamMgrAddTable(devId, XP_ACL_IACL2, XPS_TCAM_LIST_ALGORITHM);
-    if (status != XP_NO_ERR) {
-        VLOG_INFO("xpsTcamMgrAddTable failed with error code %d, "
-                  "for table type  %s", status, XP_ACL_IACL2);
+    /* Init IACL. IPv4 ACLs are offloaded even if IPv6 keys do not fit. */
+    if (ops_xp_acl_table_init(devId)) {
+        VLOG_WARN("IPv6 ACLs will not be offloaded on device %d", devId);
     }
 
-    status = xpsTcamMgrConfigTable(devId, XP_ACL_IACL2, &xpsTcamMgrRuleMoveAcl, 512, 16);
-    if (status != XP_NO_ERR) {
-        VLOG_INFO("xpsTcamMgrConfigTable failed with error code %d, "
-                  "for table type  %s", status, XP_ACL_IACL2);
-    }
+    /* Scratch key/data and row descriptors pool */
+    ops_xp_alloc_reset_field_data(&cls_field, &cls_data);
+    ops_xp_alloc_reset_field_data_v6(&cls_field_v6, &cls_data_v6);
+    list_init(&cls_rule_pool);
+    cls_rule_pool_size = 0;
 
-    /* EACL */
-    status = xpsTcamMgrAddTable(devId, XP_ACL_EACL,  XPS_TCAM_LIST_ALGORITHM);
-    if (status != XP_NO_ERR) {
-        VLOG_INFO("xpsTcamMgrAddTable failed with error code %d, "
-                  "for table type  %s", status, XP_ACL_EACL);
-    }
+    /* Classifier registry initialization */
+    hmap_init(&cls_acl_registry);
+    hmap_init(&cls_acl_sets);
 
-    status = xpsTcamMgrConfigTable(devId, XP_ACL_EACL, &xpsTcamMgrRuleMoveAcl, 512, 16);
-    if (status != XP_NO_ERR) {
-        VLOG_INFO("xpsTcamMgrConfigTable failed with error code %d, "
-                  "for table type  %s", status, XP_ACL_EACL);
-    }
+    cls_defrag_time = time_msec() + XP_CLS_DEFRAG_INTERVAL;
 
-    /* Init IACL */
-    ops_xp_acl_table_init(devId);
+    /* Start harvesting hit counters of ACL rows */
+    cls_dev_id = devId;
+    ovs_thread_create("ops-xp-acl-stats", ops_xp_cls_stats_handler, NULL);
 
-    /* Classifier hmap initialization */
-    hmap_init(&classifier_hmap_pacl);
-    hmap_init(&classifier_hmap_bacl);
-    hmap_init(&classifier_hmap_racl);
     VLOG_DBG("Init complete TCAM Manager and hmap %s", __FUNCTION__);
+
+    return 0;
 }
 
 /*
@@ -363,140 +718,505 @@ ops_xp_cls_get_type(struct ops_cls_interface_info *interface_info,
 }
 
 /*
- * Search for the classifier in hmap by interface info and uid
+ * Search for the ACL in the registry by uid
  */
-struct xp_acl_entry*
-ops_xp_cls_hmap_lookup(const struct uuid *cls_uid, 
-                       struct ops_cls_interface_info *intf_info,
-                       enum ops_cls_direction cls_direction)
+static struct xp_acl *
+ops_xp_cls_acl_lookup(const struct uuid *cls_uid)
 {
-    uint32_t                hash_id;
-    struct xp_acl_entry     *classifier = NULL;
-    xpAclType_e             acl_type;
-
-    /* Get hash id from uid */
-    hash_id = uuid_hash(cls_uid);
-
-    VLOG_DBG("%s", __FUNCTION__);
+    struct xp_acl *acl;
 
-    acl_type = ops_xp_cls_get_type(intf_info, cls_direction);
-
-    /* Search hmap for the hashid matching entries */
-
-    if (acl_type == XP_ACL_IACL0) {
-        /* Search in PACL */
-        HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_pacl) {
-            if (uuid_equals(&classifier->list_uid, cls_uid)) {
-                return classifier;
-            }
-        }
-    } else if (acl_type == XP_ACL_IACL1) {
-        /* Search in BACL */
-        HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_bacl) {
-            if (uuid_equals(&classifier->list_uid, cls_uid)) {
-                return classifier;
-            }
-        }
-    } else if(acl_type == XP_ACL_IACL2) {
-        /* Search in RACL */
-        HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_racl) {
-            if (uuid_equals(&classifier->list_uid, cls_uid)) {
-                return classifier;
-            }
+    HMAP_FOR_EACH_WITH_HASH (acl, hnode, uuid_hash(cls_uid),
+                             &cls_acl_registry) {
+        if (uuid_equals(&acl->list_uid, cls_uid)) {
+            return acl;
         }
     }
     return NULL;
 }
 
 /*
- * Search for the classifier from specific hmap provided in arguments
+ * Search for the classifier bound to the ACL table of the type by uid
  */
 struct xp_acl_entry*
-ops_xp_cls_lookup_from_hmap_type(const struct uuid *cls_uid, 
-                       struct hmap *classifier_hmap)
-
+ops_xp_cls_lookup(const struct uuid *cls_uid, xpAclType_e acl_type)
 {
-    uint32_t                hash_id;
-    struct xp_acl_entry     *classifier = NULL;
+    struct xp_acl *acl;
 
-    /* Get hash id from uid */
-    hash_id = uuid_hash(cls_uid);
-
-    VLOG_DBG("%s", __FUNCTION__);
+    if (acl_type >= XP_ACML_TOTAL_TYPE) {
+        return NULL;
+    }
 
-    HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, classifier_hmap) {
-        if (uuid_equals(&classifier->list_uid, cls_uid)) {
-            return classifier;
-        }
+    acl = ops_xp_cls_acl_lookup(cls_uid);
+    if (!acl || !acl->num_intfs[acl_type]) {
+        return NULL;
     }
-    return NULL;
+
+    return acl->acl_set->tables[acl_type];
 }
 
 /*
- * API to reverse byte ordering to resolve Little Endian and Big Endian issues
+ * Search for the classifier by interface info and uid
  */
-uint32_t
-ops_xp_cls_reverse_byte_order(uint32_t src)
+struct xp_acl_entry*
+ops_xp_cls_hmap_lookup(const struct uuid *cls_uid, 
+                       struct ops_cls_interface_info *intf_info,
+                       enum ops_cls_direction cls_direction)
 {
-    uint32_t dst;
-    dst = ((src >> 24) & 0xff) |        // byte 3 to byte 0
-          ((src << 8) & 0xff0000) |     // byte 1 to byte 2
-          ((src >> 8) & 0xff00) |       // byte 2 to byte 1
-          ((src << 24) & 0xff000000);   // byte 0 to byte 3
-    return dst;
+    VLOG_DBG("%s", __FUNCTION__);
+
+    return ops_xp_cls_lookup(cls_uid,
+                             ops_xp_cls_get_type(intf_info, cls_direction));
 }
 
 /*
- * populate Iacl Entries
+ * Hash of the entries of a list, field by field
  */
-void
-ops_xp_cls_populate_iacl_entires(struct ops_cls_list_entry *entry,
-                                 xpsIaclkeyFieldList_t *field,
-                                 xpsIaclData_t *iaclData)
+static uint32_t
+ops_xp_cls_entries_hash(const struct ops_cls_list_entry *entries,
+                        uint32_t n, enum ops_cls_type list_type)
 {
-    uint32_t sip_mask, dip_mask, sip_mask_in, dip_mask_in, sip, dip;
+    uint32_t hash = list_type;
 
-    /* Populate key */
-    VLOG_DBG("%s", __FUNCTION__);
+    for (uint32_t i = 0; i < n; i++) {
+        hash = ops_xp_cls_entry_hash(&entries[i], list_type, hash);
+    }
 
-    /* Poupulate SRC IP and DST IP */
-    if (entry->entry_fields.entry_flags & OPS_CLS_SRC_IPADDR_VALID) {
+    return hash;
+}
 
-        field->fldList[OPS_XP_IACL_SIP_V4].fld.v4Fld = XP_IACL_SIP_V4;
+/*
+ * Whether any entry of the list counts its hits
+ */
+static bool
+ops_xp_cls_list_counted(const struct ops_cls_list *list)
+{
+    for (int i = 0; i < list->num_entries; i++) {
+        if (list->entries[i].entry_actions.action_flags &
+            OPS_CLS_ACTION_COUNT) {
+            return true;
+        }
+    }
 
-        memcpy(&sip, &entry->entry_fields.src_ip_address.v4, sizeof(uint32_t));
+    return false;
+}
 
-        sip = ops_xp_cls_reverse_byte_order(sip);
+/*
+ * Search for the rule set built from the entries of the list. Lists
+ * counting hits are not shared, as statistics of one of them would
+ * include hits of the other ones and clearing them would clear all.
+ */
+static struct xp_acl_set *
+ops_xp_cls_acl_set_lookup(const struct ops_cls_list *list)
+{
+    struct xp_acl_set   *acl_set;
+    uint32_t            hash;
 
-        memcpy(field->fldList[OPS_XP_IACL_SIP_V4].value,
-               &sip, iacl_key_v4[OPS_XP_IACL_SIP_V4].size);
+    if (ops_xp_cls_list_counted(list)) {
+        return NULL;
+    }
 
-        VLOG_DBG("SIP %#x", sip);
+    hash = ops_xp_cls_entries_hash(list->entries, list->num_entries,
+                                   list->list_type);
 
-        memcpy(&sip_mask_in, &entry->entry_fields.src_ip_address_mask.v4,
-               iacl_key_v4[OPS_XP_IACL_SIP_V4].size);
+    HMAP_FOR_EACH_WITH_HASH (acl_set, hnode, hash, &cls_acl_sets) {
+        int i;
 
-        sip_mask_in = ops_xp_cls_reverse_byte_order(sip_mask_in);
+        if (acl_set->list_type != list->list_type ||
+            acl_set->num_entries != list->num_entries) {
+            continue;
+        }
 
-        /* Set all 32 bits to 1 and do xor with it to toggle */
-        sip_mask = 0xffffffff;
+        for (i = 0; i < acl_set->num_entries; i++) {
+            if (!ops_xp_cls_entry_equal(&acl_set->entries[i],
+                                        &list->entries[i],
+                                        list->list_type)) {
+                break;
+            }
+        }
 
-        /* Toggle the mask as per xdk requirement
-         * we mask the matching fields with zero in xdk
-         */
-        sip_mask = sip_mask ^ sip_mask_in;
+        if (i == acl_set->num_entries) {
+            return acl_set;
+        }
+    }
+    return NULL;
+}
 
-        memcpy(field->fldList[OPS_XP_IACL_SIP_V4].mask, 
-               &sip_mask, iacl_key_v4[OPS_XP_IACL_SIP_V4].size);
+/*
+ * Get a reference to the rule set built from the entries of the list.
+ * A new set with its own ACL ID is created if no list uses the same
+ * entries yet. Returns NULL if ACL ID could not be allocated.
+ */
+static struct xp_acl_set *
+ops_xp_cls_acl_set_get(const struct ops_cls_list *list)
+{
+    struct xp_acl_set   *acl_set;
+    size_t              size;
+    uint8_t             acl_id;
+
+    acl_set = ops_xp_cls_acl_set_lookup(list);
+    if (acl_set) {
+        VLOG_DBG("Sharing ACLID %d with %u lists", acl_set->acl_id,
+                 acl_set->ref_cnt);
+        acl_set->ref_cnt++;
+        return acl_set;
     }
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_DEST_IPADDR_VALID) {
+    if (xpsAclIdAllocEntry(0, &acl_id) != XP_NO_ERR) {
+        return NULL;
+    }
 
-        field->fldList[OPS_XP_IACL_DIP_V4].fld.v4Fld = XP_IACL_DIP_V4;
+    VLOG_DBG("Allocated ACLID %d", acl_id);
 
-        memcpy(&dip, &entry->entry_fields.dst_ip_address.v4, sizeof(uint32_t));
+    size = list->num_entries * sizeof(struct ops_cls_list_entry);
 
-        dip = ops_xp_cls_reverse_byte_order(dip);
+    acl_set = xzalloc(sizeof(*acl_set));
+    acl_set->acl_id = acl_id;
+    acl_set->ref_cnt = 1;
+    acl_set->list_type = list->list_type;
+    acl_set->num_entries = list->num_entries;
+    acl_set->entries = size ? xmemdup(list->entries, size) : NULL;
+    acl_set->hash = ops_xp_cls_entries_hash(list->entries, list->num_entries,
+                                            list->list_type);
+    hmap_insert(&cls_acl_sets, &acl_set->hnode, acl_set->hash);
+
+    return acl_set;
+}
+
+/*
+ * Re-key the rule set after its rows have been updated to the entries
+ * of the list.
+ */
+static void
+ops_xp_cls_acl_set_rekey(struct xp_acl_set *acl_set,
+                         const struct ops_cls_list *list)
+{
+    size_t size = list->num_entries * sizeof(struct ops_cls_list_entry);
+
+    hmap_remove(&cls_acl_sets, &acl_set->hnode);
+
+    free(acl_set->entries);
+    acl_set->num_entries = list->num_entries;
+    acl_set->entries = size ? xmemdup(list->entries, size) : NULL;
+    acl_set->hash = ops_xp_cls_entries_hash(list->entries, list->num_entries,
+                                            acl_set->list_type);
+
+    hmap_insert(&cls_acl_sets, &acl_set->hnode, acl_set->hash);
+}
+
+/*
+ * Destroy rows of the rule set in the ACL tables it is no more applied in
+ */
+static void
+ops_xp_cls_acl_set_trim(struct xp_acl_set *acl_set)
+{
+    for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+        if (acl_set->tables[i] && !acl_set->tables[i]->num_intfs) {
+            ops_xp_cls_acl_delete(acl_set->tables[i]);
+        }
+    }
+}
+
+/*
+ * Drop a reference to the rule set. ACL ID is released once the set is
+ * not used by any list.
+ */
+static void
+ops_xp_cls_acl_set_put(struct xp_acl_set *acl_set)
+{
+    if (--acl_set->ref_cnt) {
+        VLOG_DBG("ACLID %d is still used by %u lists, hence not deleting",
+                 acl_set->acl_id, acl_set->ref_cnt);
+        return;
+    }
+
+    for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+        if (acl_set->tables[i]) {
+            ops_xp_cls_acl_delete(acl_set->tables[i]);
+        }
+    }
+
+    xpsAclIdFreeEntry(0, acl_set->acl_id);
+    hmap_remove(&cls_acl_sets, &acl_set->hnode);
+    free(acl_set->entries);
+    free(acl_set);
+}
+
+/*
+ * Bind the classifier rows to their ACL table in the rule set
+ */
+static int
+ops_xp_cls_acl_bind(struct xp_acl_set *acl_set, struct xp_acl_entry *acl_entry)
+{
+    xpAclType_e     acl_type;
+
+    acl_type = ops_xp_cls_get_type(&acl_entry->intf_info,
+                                   acl_entry->cls_direction);
+    if (acl_type >= XP_ACML_TOTAL_TYPE) {
+        return EINVAL;
+    }
+
+    ovs_assert(!acl_set->tables[acl_type]);
+
+    acl_set->tables[acl_type] = acl_entry;
+
+    acl_entry->acl_set = acl_set;
+    acl_entry->acl_id = acl_set->acl_id;
+
+    return 0;
+}
+
+/*
+ * Unbind the classifier rows from their ACL table
+ */
+static void
+ops_xp_cls_acl_unbind(struct xp_acl_entry *acl_entry)
+{
+    xpAclType_e     acl_type;
+
+    acl_type = ops_xp_cls_get_type(&acl_entry->intf_info,
+                                   acl_entry->cls_direction);
+
+    acl_entry->acl_set->tables[acl_type] = NULL;
+    acl_entry->acl_set = NULL;
+}
+
+/*
+ * Set ACL ID of the interface and enable or disable ACL on it
+ */
+static void
+ops_xp_cls_intf_set(const struct xp_acl_interface *intf, uint8_t acl_id,
+                    bool enable)
+{
+    if (intf->l3) {
+        xpsL3SetRouterAclId(intf->devId, intf->intf_num,
+                            enable ? acl_id : 0x0);
+        xpsL3SetRouterAclEnable(intf->devId, intf->intf_num,
+                                enable ? 0x1 : 0x0);
+    } else {
+        xpsPortSetField(intf->devId, intf->intf_num,
+                        XPS_PORT_ACL_EN, enable ? 1 : 0);
+        xpsPortSetField(intf->devId, intf->intf_num,
+                        XPS_PORT_ACL_ID, enable ? acl_id : 0x0);
+    }
+}
+
+static void
+ops_xp_cls_intf_add(struct xp_acl *acl, xpAclType_e acl_type,
+                    xpsDevice_t devId, xpsInterfaceId_t intf_num, bool l3)
+{
+    struct xp_acl_interface *intf;
+
+    intf = xzalloc(sizeof(*intf));
+    intf->devId = devId;
+    intf->intf_num = intf_num;
+    intf->l3 = l3;
+    list_push_back(&acl->intfs[acl_type], &intf->list_node);
+
+    ops_xp_cls_intf_set(intf, acl->acl_set->acl_id, true);
+
+    VLOG_DBG("Interface value on which acl %d, applied is %d",
+             acl->acl_set->acl_id, intf_num);
+}
+
+static void
+ops_xp_cls_intf_del(struct xp_acl *acl, xpAclType_e acl_type,
+                    xpsInterfaceId_t intf_num, bool l3)
+{
+    struct xp_acl_interface *intf;
+
+    LIST_FOR_EACH (intf, list_node, &acl->intfs[acl_type]) {
+        if (intf->intf_num == intf_num && intf->l3 == l3) {
+            ops_xp_cls_intf_set(intf, 0, false);
+            list_remove(&intf->list_node);
+            free(intf);
+            return;
+        }
+    }
+}
+
+/*
+ * Set ACL ID of the list on the interfaces of the bundle and account
+ * the binding in the list and its rule set
+ */
+static void
+ops_xp_cls_acl_attach(struct xp_acl *acl, xpAclType_e acl_type,
+                      struct ofproto_xpliant *ofproto_xp,
+                      struct bundle_xpliant *bundle,
+                      struct ops_cls_interface_info *interface_info)
+{
+    struct ofport_xpliant   *port = NULL;
+    xpsDevice_t             devId = ofproto_xp->xpdev->id;
+
+    if (interface_info->interface == OPS_CLS_INTERFACE_VLAN) {
+        if (interface_info->flags & OPS_CLS_INTERFACE_L3ONLY) {
+            ops_xp_cls_intf_add(acl, acl_type, devId,
+                                bundle->l3_intf->l3_intf_id, true);
+        }
+    } else if (interface_info->interface == OPS_CLS_INTERFACE_PORT) {
+        LIST_FOR_EACH (port, bundle_node, &bundle->ports) {
+            ops_xp_cls_intf_add(acl, acl_type, devId,
+                                ops_xp_get_ofport_intf_id(port), false);
+        }
+    }
+
+    acl->num_intfs[acl_type]++;
+    acl->acl_set->tables[acl_type]->num_intfs++;
+}
+
+/*
+ * Reset ACL ID on the interfaces of the bundle. Rows which are not in
+ * use anymore are kept until ops_xp_cls_acl_release() is called.
+ */
+static void
+ops_xp_cls_acl_detach(struct xp_acl *acl, xpAclType_e acl_type,
+                      struct bundle_xpliant *bundle,
+                      struct ops_cls_interface_info *interface_info)
+{
+    struct ofport_xpliant   *port = NULL;
+
+    if (interface_info->interface == OPS_CLS_INTERFACE_VLAN) {
+        if (interface_info->flags & OPS_CLS_INTERFACE_L3ONLY) {
+            ops_xp_cls_intf_del(acl, acl_type,
+                                bundle->l3_intf->l3_intf_id, true);
+        }
+    } else if (interface_info->interface == OPS_CLS_INTERFACE_PORT) {
+        LIST_FOR_EACH (port, bundle_node, &bundle->ports) {
+            ops_xp_cls_intf_del(acl, acl_type,
+                                ops_xp_get_ofport_intf_id(port), false);
+        }
+    }
+
+    acl->num_intfs[acl_type]--;
+    acl->acl_set->tables[acl_type]->num_intfs--;
+}
+
+/*
+ * Create the registry entry of the list. Its rule set is shared with
+ * other lists having the same entries, unless they count hits.
+ */
+static struct xp_acl *
+ops_xp_cls_acl_create(const struct ops_cls_list *list)
+{
+    struct xp_acl_set   *acl_set;
+    struct xp_acl       *acl;
+
+    acl_set = ops_xp_cls_acl_set_get(list);
+    if (!acl_set) {
+        return NULL;
+    }
+
+    acl = xzalloc(sizeof(*acl));
+    acl->list_uid = list->list_id;
+    acl->acl_set = acl_set;
+    for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+        list_init(&acl->intfs[i]);
+    }
+    hmap_insert(&cls_acl_registry, &acl->hnode, uuid_hash(&acl->list_uid));
+
+    return acl;
+}
+
+/*
+ * Destroy rows which are not in use anymore and remove the list from the
+ * registry once it is not applied on any interface.
+ */
+static void
+ops_xp_cls_acl_release(struct xp_acl *acl)
+{
+    ops_xp_cls_acl_set_trim(acl->acl_set);
+
+    for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+        if (acl->num_intfs[i]) {
+            return;
+        }
+    }
+
+    hmap_remove(&cls_acl_registry, &acl->hnode);
+    ops_xp_cls_acl_set_put(acl->acl_set);
+    free(acl);
+}
+
+/*
+ * API to reverse byte ordering to resolve Little Endian and Big Endian issues
+ */
+uint32_t
+ops_xp_cls_reverse_byte_order(uint32_t src)
+{
+    uint32_t dst;
+    dst = ((src >> 24) & 0xff) |        // byte 3 to byte 0
+          ((src << 8) & 0xff0000) |     // byte 1 to byte 2
+          ((src >> 8) & 0xff00) |       // byte 2 to byte 1
+          ((src << 24) & 0xff000000);   // byte 0 to byte 3
+    return dst;
+}
+
+/*
+ * populate Iacl data of the entry
+ */
+static void
+ops_xp_cls_populate_iacl_data(const struct ops_cls_list_entry *entry,
+                              xpsIaclData_t *iaclData)
+{
+    iaclData->isTerminal = 1;
+    iaclData->enPktCmdUpd = 1;
+    if (entry->entry_actions.action_flags & OPS_CLS_ACTION_PERMIT) {
+        iaclData->pktCmd = XP_PKTCMD_FWD;
+    } else if (entry->entry_actions.action_flags & OPS_CLS_ACTION_DENY) {
+        iaclData->pktCmd = XP_PKTCMD_DROP;
+    }
+}
+
+/*
+ * populate Iacl Entries
+ */
+void
+ops_xp_cls_populate_iacl_entires(struct ops_cls_list_entry *entry,
+                                 xpsIaclkeyFieldList_t *field,
+                                 xpsIaclData_t *iaclData)
+{
+    uint32_t sip_mask, dip_mask, sip_mask_in, dip_mask_in, sip, dip;
+
+    /* Populate key */
+    VLOG_DBG("%s", __FUNCTION__);
+
+    /* Poupulate SRC IP and DST IP */
+    if (entry->entry_fields.entry_flags & OPS_CLS_SRC_IPADDR_VALID) {
+
+        field->fldList[OPS_XP_IACL_SIP_V4].fld.v4Fld = XP_IACL_SIP_V4;
+
+        memcpy(&sip, &entry->entry_fields.src_ip_address.v4, sizeof(uint32_t));
+
+        sip = ops_xp_cls_reverse_byte_order(sip);
+
+        memcpy(field->fldList[OPS_XP_IACL_SIP_V4].value,
+               &sip, iacl_key_v4[OPS_XP_IACL_SIP_V4].size);
+
+        VLOG_DBG("SIP %#x", sip);
+
+        memcpy(&sip_mask_in, &entry->entry_fields.src_ip_address_mask.v4,
+               iacl_key_v4[OPS_XP_IACL_SIP_V4].size);
+
+        sip_mask_in = ops_xp_cls_reverse_byte_order(sip_mask_in);
+
+        /* Set all 32 bits to 1 and do xor with it to toggle */
+        sip_mask = 0xffffffff;
+
+        /* Toggle the mask as per xdk requirement
+         * we mask the matching fields with zero in xdk
+         */
+        sip_mask = sip_mask ^ sip_mask_in;
+
+        memcpy(field->fldList[OPS_XP_IACL_SIP_V4].mask, 
+               &sip_mask, iacl_key_v4[OPS_XP_IACL_SIP_V4].size);
+    }
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_DEST_IPADDR_VALID) {
+
+        field->fldList[OPS_XP_IACL_DIP_V4].fld.v4Fld = XP_IACL_DIP_V4;
+
+        memcpy(&dip, &entry->entry_fields.dst_ip_address.v4, sizeof(uint32_t));
+
+        dip = ops_xp_cls_reverse_byte_order(dip);
 
         memcpy(field->fldList[OPS_XP_IACL_DIP_V4].value, &dip,
                iacl_key_v4[OPS_XP_IACL_DIP_V4].size);
@@ -520,147 +1240,657 @@ ops_xp_cls_populate_iacl_entires(struct ops_cls_list_entry *entry,
                &dip_mask, iacl_key_v4[OPS_XP_IACL_DIP_V4].size);
         }
 
-    /* Populate L4 SRC DST PORT */
+    /* L4 SRC DST PORT are populated per TCAM row,
+     * see ops_xp_cls_set_l4_port() */
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_L4_SRC_PORT_VALID) {
+    if (entry->entry_fields.entry_flags & OPS_CLS_PROTOCOL_VALID) {
 
-        field->fldList[OPS_XP_IACL_L4_SRC_PORT].fld.v4Fld = XP_IACL_L4_SRC_PORT;
+        field->fldList[OPS_XP_IACL_PROTOCOL].fld.v4Fld = XP_IACL_PROTOCOL;
 
-        memcpy(field->fldList[OPS_XP_IACL_L4_SRC_PORT].value, 
-               &entry->entry_fields.L4_src_port_min,
-               iacl_key_v4[OPS_XP_IACL_L4_SRC_PORT].size);
+        memcpy(field->fldList[OPS_XP_IACL_PROTOCOL].value, 
+               &entry->entry_fields.protocol,
+               iacl_key_v4[OPS_XP_IACL_PROTOCOL].size);
 
-        memset(field->fldList[OPS_XP_IACL_L4_SRC_PORT].mask, 0x0,
-               iacl_key_v4[OPS_XP_IACL_L4_SRC_PORT].size);
+        memset(field->fldList[OPS_XP_IACL_PROTOCOL].mask, 0x0,
+               iacl_key_v4[OPS_XP_IACL_PROTOCOL].size);
     }
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_L4_DEST_PORT_VALID) {
+    if (entry->entry_fields.entry_flags & OPS_CLS_TOS_VALID) {
 
-        field->fldList[OPS_XP_IACL_L4_DEST_PORT].fld.v4Fld = XP_IACL_L4_DEST_PORT;
+        field->fldList[OPS_XP_IACL_DSCP_ECN].fld.v4Fld = XP_IACL_DSCP_ECN;
 
-        memcpy(field->fldList[OPS_XP_IACL_L4_DEST_PORT].value, 
-               &entry->entry_fields.L4_dst_port_min,
-               iacl_key_v4[OPS_XP_IACL_L4_DEST_PORT].size);
+        memcpy(field->fldList[OPS_XP_IACL_DSCP_ECN].value, 
+               &entry->entry_fields.tos,
+               iacl_key_v4[OPS_XP_IACL_DSCP_ECN].size);
 
-        memset(field->fldList[OPS_XP_IACL_L4_DEST_PORT].mask, 0x0,
-               iacl_key_v4[OPS_XP_IACL_L4_DEST_PORT].size);
+        memcpy(field->fldList[OPS_XP_IACL_DSCP_ECN].mask, 
+               &entry->entry_fields.tos_mask,
+               iacl_key_v4[OPS_XP_IACL_DSCP_ECN].size);
     }
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_PROTOCOL_VALID) {
+   /* if(entry->entry_fields.entry_flags & OPS_CLS_TCP_FLAGS_VALID) {
 
-        field->fldList[OPS_XP_IACL_PROTOCOL].fld.v4Fld = XP_IACL_PROTOCOL;
+        field->fldList[OPS_XP_IACL_TCP_FLAGS].fld.v4Fld = XP_IACL_TCP_FLAGS;
 
-        memcpy(field->fldList[OPS_XP_IACL_PROTOCOL].value, 
+        memcpy(field->fldList[OPS_XP_IACL_TCP_FLAGS].value, 
+               &entry->entry_fields.tcp_flags, sizeof(uint8_t));
+
+        memcpy(field->fldList[OPS_XP_IACL_TCP_FLAGS].mask, 
+               &entry->entry_fields.tcp_flags_mask, sizeof(uint8_t));
+    }*/
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_ICMP_CODE_VALID) {
+
+        field->fldList[OPS_XP_IACL_ICMP_CODE].fld.v4Fld = XP_IACL_ICMP_CODE;
+
+        memcpy(field->fldList[OPS_XP_IACL_ICMP_CODE].value, 
+               &entry->entry_fields.icmp_code,
+               iacl_key_v4[OPS_XP_IACL_ICMP_CODE].size);
+
+        memset(field->fldList[OPS_XP_IACL_ICMP_CODE].mask, 0x0,
+               iacl_key_v4[OPS_XP_IACL_ICMP_CODE].size);
+    }
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_ICMP_TYPE_VALID) {
+
+        field->fldList[OPS_XP_IACL_ICMP_MSG_TYPE].fld.v4Fld = XP_IACL_ICMP_MSG_TYPE;
+
+        memcpy(field->fldList[OPS_XP_IACL_ICMP_MSG_TYPE].value, 
+               &entry->entry_fields.icmp_type,
+               iacl_key_v4[OPS_XP_IACL_ICMP_MSG_TYPE].size);
+
+        memset(field->fldList[OPS_XP_IACL_ICMP_MSG_TYPE].mask, 0x0,
+               iacl_key_v4[OPS_XP_IACL_ICMP_MSG_TYPE].size);
+    }
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_VLAN_VALID) {
+
+        field->fldList[OPS_XP_IACL_BD].fld.v4Fld = XP_IACL_BD;
+
+        memcpy(field->fldList[OPS_XP_IACL_BD].value, 
+               &entry->entry_fields.vlan, iacl_key_v4[OPS_XP_IACL_BD].size);
+
+        memset(field->fldList[OPS_XP_IACL_BD].mask, 0x0,
+               iacl_key_v4[OPS_XP_IACL_BD].size);
+    }
+
+    /* Populate SRC MAC and DST MAC */
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_L2_ETHERTYPE_VALID) {
+
+        field->fldList[OPS_XP_IACL_V4_ETHER_TYPE].fld.v4Fld = XP_IACL_V4_ETHER_TYPE;
+
+        memcpy(field->fldList[OPS_XP_IACL_V4_ETHER_TYPE].value, 
+               &entry->entry_fields.L2_ethertype,
+               iacl_key_v4[OPS_XP_IACL_V4_ETHER_TYPE].size);
+
+        memset(field->fldList[OPS_XP_IACL_V4_ETHER_TYPE].mask, 0x0,
+               iacl_key_v4[OPS_XP_IACL_V4_ETHER_TYPE].size);
+    }
+
+    /* Check L2_cos is not supported */
+
+    ops_xp_cls_populate_iacl_data(entry, iaclData);
+}
+
+/*
+ * Set IPv6 address key field. XDK expects the address in reversed byte
+ * order and matches the bits whose mask is zero.
+ */
+static void
+ops_xp_cls_set_ipv6(xpsIaclkeyFieldList_t *field, int fld,
+                    const struct in6_addr *addr, const struct in6_addr *mask)
+{
+    uint8_t *value = field->fldList[fld].value;
+    uint8_t *key_mask = field->fldList[fld].mask;
+    int     size = iacl_key_v6[fld].size;
+
+    for (int i = 0; i < size; i++) {
+        value[i] = addr->s6_addr[size - 1 - i];
+        key_mask[i] = ~mask->s6_addr[size - 1 - i];
+    }
+}
+
+/*
+ * populate IPv6 Iacl Entries
+ */
+void
+ops_xp_cls_populate_iacl_entries_v6(struct ops_cls_list_entry *entry,
+                                    xpsIaclkeyFieldList_t *field,
+                                    xpsIaclData_t *iaclData)
+{
+    VLOG_DBG("%s", __FUNCTION__);
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_SRC_IPADDR_VALID) {
+        ops_xp_cls_set_ipv6(field, OPS_XP_IACL_SIP_V6,
+                            &entry->entry_fields.src_ip_address.v6,
+                            &entry->entry_fields.src_ip_address_mask.v6);
+    }
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_DEST_IPADDR_VALID) {
+        ops_xp_cls_set_ipv6(field, OPS_XP_IACL_DIP_V6,
+                            &entry->entry_fields.dst_ip_address.v6,
+                            &entry->entry_fields.dst_ip_address_mask.v6);
+    }
+
+    /* L4 SRC DST PORT are populated per TCAM row,
+     * see ops_xp_cls_set_l4_port() */
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_PROTOCOL_VALID) {
+
+        memcpy(field->fldList[OPS_XP_IACL_NXT_HDR].value,
                &entry->entry_fields.protocol,
-               iacl_key_v4[OPS_XP_IACL_PROTOCOL].size);
+               iacl_key_v6[OPS_XP_IACL_NXT_HDR].size);
+
+        memset(field->fldList[OPS_XP_IACL_NXT_HDR].mask, 0x0,
+               iacl_key_v6[OPS_XP_IACL_NXT_HDR].size);
+    }
+
+    if (entry->entry_fields.entry_flags & OPS_CLS_ICMP_TYPE_VALID) {
+
+        memcpy(field->fldList[OPS_XP_IACL_ICMP_V6_MSG_TYPE].value,
+               &entry->entry_fields.icmp_type,
+               iacl_key_v6[OPS_XP_IACL_ICMP_V6_MSG_TYPE].size);
+
+        memset(field->fldList[OPS_XP_IACL_ICMP_V6_MSG_TYPE].mask, 0x0,
+               iacl_key_v6[OPS_XP_IACL_ICMP_V6_MSG_TYPE].size);
+    }
+
+    ops_xp_cls_populate_iacl_data(entry, iaclData);
+}
+
+/*
+ * Append the minimal set of prefixes covering ports [lo, hi] to prefixes.
+ * Returns the new number of prefixes.
+ */
+static size_t
+ops_xp_cls_port_range_to_prefixes(uint32_t lo, uint32_t hi,
+                                  struct xp_cls_port_prefix *prefixes,
+                                  size_t n)
+{
+    while (lo <= hi) {
+        /* Largest power of two block aligned at lo within the range */
+        uint32_t size = lo ? (lo & -lo) : UINT16_MAX + 1;
+
+        while (lo + size - 1 > hi) {
+            size >>= 1;
+        }
+
+        prefixes[n].value = lo;
+        prefixes[n].mask = ~(size - 1);
+        n++;
+
+        lo += size;
+    }
+
+    return n;
+}
+
+/*
+ * Expand L4 port match into value/mask prefixes. min and max are the
+ * inclusive bounds of the port range, for NEQ min is the excluded port.
+ * Returns the number of prefixes. Unmatched port is a single wildcard.
+ */
+static size_t
+ops_xp_cls_l4_port_expand(bool valid, int op, uint16_t min, uint16_t max,
+                          struct xp_cls_port_prefix *prefixes)
+{
+    size_t n = 0;
+
+    if (!valid) {
+        prefixes[0].value = 0;
+        prefixes[0].mask = 0;
+        return 1;
+    }
+
+    switch (op) {
+    case OPS_CLS_L4_PORT_OP_NEQ:
+        if (min > 0) {
+            n = ops_xp_cls_port_range_to_prefixes(0, min - 1, prefixes, n);
+        }
+        if (min < UINT16_MAX) {
+            n = ops_xp_cls_port_range_to_prefixes(min + 1, UINT16_MAX,
+                                                  prefixes, n);
+        }
+        return n;
+
+    case OPS_CLS_L4_PORT_OP_LT:
+        return ops_xp_cls_port_range_to_prefixes(0, max, prefixes, 0);
+
+    case OPS_CLS_L4_PORT_OP_GT:
+        return ops_xp_cls_port_range_to_prefixes(min, UINT16_MAX, prefixes, 0);
+
+    case OPS_CLS_L4_PORT_OP_RANGE:
+        return ops_xp_cls_port_range_to_prefixes(min, max, prefixes, 0);
+
+    default:
+        prefixes[0].value = min;
+        prefixes[0].mask = UINT16_MAX;
+        return 1;
+    }
+}
+
+/*
+ * Expand L4 SRC and DST port matches of an entry. The entry takes
+ * n_src * n_dst TCAM rows.
+ */
+static void
+ops_xp_cls_entry_expand(const struct ops_cls_list_entry *entry,
+                        struct xp_cls_port_prefix *src, size_t *n_src,
+                        struct xp_cls_port_prefix *dst, size_t *n_dst)
+{
+    uint32_t flags = entry->entry_fields.entry_flags;
+
+    *n_src = ops_xp_cls_l4_port_expand(flags & OPS_CLS_L4_SRC_PORT_VALID,
+                                       entry->entry_fields.L4_src_port_op,
+                                       entry->entry_fields.L4_src_port_min,
+                                       entry->entry_fields.L4_src_port_max,
+                                       src);
+    *n_dst = ops_xp_cls_l4_port_expand(flags & OPS_CLS_L4_DEST_PORT_VALID,
+                                       entry->entry_fields.L4_dst_port_op,
+                                       entry->entry_fields.L4_dst_port_min,
+                                       entry->entry_fields.L4_dst_port_max,
+                                       dst);
+}
+
+/*
+ * Number of TCAM rows an entry is expanded into
+ */
+static uint32_t
+ops_xp_cls_entry_n_rows(const struct ops_cls_list_entry *entry)
+{
+    struct xp_cls_port_prefix src[XP_CLS_L4_PORT_PREFIX_MAX];
+    struct xp_cls_port_prefix dst[XP_CLS_L4_PORT_PREFIX_MAX];
+    size_t n_src, n_dst;
+
+    ops_xp_cls_entry_expand(entry, src, &n_src, dst, &n_dst);
+
+    return n_src * n_dst;
+}
+
+/*
+ * Set L4 port key field to the prefix
+ */
+static void
+ops_xp_cls_set_l4_port(xpsIaclkeyFieldList_t *field, int fld,
+                       const struct xp_cls_port_prefix *prefix)
+{
+    /* XDK matches the bits whose mask is zero */
+    uint16_t mask = ~prefix->mask;
+
+    memcpy(field->fldList[fld].value, &prefix->value, sizeof(prefix->value));
+    memcpy(field->fldList[fld].mask, &mask, sizeof(mask));
+}
+
+/*
+ * Write key and data of a TCAM row into HW table
+ */
+static void
+ops_xp_cls_write_row(xpDevice_t devId, uint32_t tableId, uint32_t tcamId,
+                     xpsIaclkeyFieldList_t *field, xpsIaclData_t *iaclData)
+{
+    XP_STATUS status = XP_NO_ERR;
+
+    switch (tableId) {
+
+    case XP_ACL_IACL0:
+        status = xpsIaclWritePaclKey(devId, tcamId, field);
+        if (status != XP_NO_ERR) {
+            VLOG_DBG("xpsIaclWritePaclKey failed with error %d", status);
+        }
+
+        status = xpsIaclWritePaclData(devId, tcamId, iaclData);
+        if (status != XP_NO_ERR) {
+            VLOG_DBG("xpsIaclWritePaclData failed with error %d", status);
+        }
+        break;
+
+    case XP_ACL_IACL1:
+        status = xpsIaclWriteBaclKey(devId, tcamId, field);
+        if (status != XP_NO_ERR) {
+            VLOG_DBG("xpsIaclWriteBaclKey failed with error %d", status);
+        }
+
+        status = xpsIaclWriteBaclData(devId, tcamId, iaclData);
+        if (status != XP_NO_ERR) {
+            VLOG_DBG("xpsIaclWriteBaclData failed with error %d", status);
+        }
+        break;
+
+    case XP_ACL_IACL2:
+        status = xpsIaclWriteRaclKey(devId, tcamId, field);
+        if (status != XP_NO_ERR) {
+            VLOG_DBG("xpsIaclWriteRaclKey failed with error %d", status);
+        }
+
+        status = xpsIaclWriteRaclData(devId, tcamId, iaclData);
+        if (status != XP_NO_ERR) {
+            VLOG_DBG("xpsIaclWriteRaclData failed with error %d", status);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*
+ * Make sure the pool holds at least n row descriptors
+ */
+static void
+ops_xp_cls_rule_reserve(size_t n)
+{
+    struct xp_acl_rule *block;
+
+    if (n <= cls_rule_pool_size) {
+        return;
+    }
+
+    n -= cls_rule_pool_size;
+    block = xcalloc(n, sizeof(struct xp_acl_rule));
+    for (size_t i = 0; i < n; i++) {
+        list_push_back(&cls_rule_pool, &block[i].list_node);
+    }
+    cls_rule_pool_size += n;
+}
+
+static struct xp_acl_rule *
+ops_xp_cls_rule_alloc(void)
+{
+    struct xp_acl_rule *rule;
+
+    if (!cls_rule_pool_size) {
+        ops_xp_cls_rule_reserve(XP_CLS_RULE_POOL_GROW);
+    }
+
+    rule = CONTAINER_OF(list_pop_front(&cls_rule_pool), struct xp_acl_rule,
+                        list_node);
+    cls_rule_pool_size--;
+    memset(rule, 0, sizeof(*rule));
+
+    return rule;
+}
+
+static void
+ops_xp_cls_rule_free(struct xp_acl_rule *rule)
+{
+    list_push_back(&cls_rule_pool, &rule->list_node);
+    cls_rule_pool_size++;
+}
+
+static void
+ops_xp_cls_batch_init(struct xp_cls_batch *batch,
+                      struct xp_acl_entry *classifier, uint32_t tableId,
+                      size_t n_rows)
+{
+    batch->classifier = classifier;
+    batch->tableId = tableId;
+    batch->n_rows = 0;
+    batch->allocated_rows = n_rows;
+    batch->rows = n_rows ? xmalloc(n_rows * sizeof(*batch->rows)) : NULL;
+
+    ops_xp_cls_rule_reserve(n_rows);
+}
+
+static void
+ops_xp_cls_batch_destroy(struct xp_cls_batch *batch)
+{
+    free(batch->rows);
+}
+
+/*
+ * Write all queued rows into hw. Key and data are rebuilt in the scratch
+ * buffers only when the entry changes, rows of an entry differ in L4
+ * ports only.
+ */
+static void
+ops_xp_cls_batch_commit(struct xp_cls_batch *batch)
+{
+    const struct ops_cls_list_entry *ace = NULL;
+    xpsIaclkeyFieldList_t           *field;
+    xpsIaclData_t                   *data;
+    uint32_t                        tcamId;
+    xpDevice_t                      devId;
+    bool                            ipv6;
+
+    devId = 0;
+
+    /* IPv6 lists are programmed with IPv6 keys */
+    ipv6 = batch->classifier->acl_set->list_type == OPS_CLS_ACL_V6;
+    field = ipv6 ? cls_field_v6 : cls_field;
+    data = ipv6 ? cls_data_v6 : cls_data;
+
+    for (size_t i = 0; i < batch->n_rows; i++) {
+        struct xp_cls_batch_row *row = &batch->rows[i];
+
+        if (row->ace != ace) {
+            ace = row->ace;
+
+            if (ipv6) {
+                ops_xp_cls_reset_field_data_v6(field, data);
+                field->isValid = 0x1;
+                ops_xp_cls_populate_iacl_entries_v6(
+                                    (struct ops_cls_list_entry *)ace,
+                                    field, data);
+
+                /* Update ACL ID to fields list */
+                memset(field->fldList[OPS_XP_IACL_ID_V6].value,
+                       batch->classifier->acl_id, sizeof(uint8_t));
+                memset(field->fldList[OPS_XP_IACL_ID_V6].mask, 0x0,
+                       sizeof(uint8_t));
+            } else {
+                ops_xp_cls_reset_field_data(field, data);
+                field->isValid = 0x1;
+                ops_xp_cls_populate_iacl_entires((struct ops_cls_list_entry *)ace,
+                                                 field, data);
+
+                /* Update ACL ID to fields list */
+                field->fldList[OPS_XP_IACL_ID].fld.v4Fld = XP_IACL_ID;
+
+                memset(field->fldList[OPS_XP_IACL_ID].value,
+                       batch->classifier->acl_id, sizeof(uint8_t));
+                memset(field->fldList[OPS_XP_IACL_ID].mask, 0x0, sizeof(uint8_t));
+            }
+        }
+
+        if (ipv6) {
+            ops_xp_cls_set_l4_port(field, OPS_XP_IACL_L4_V6_SRC_PORT, &row->src);
+            ops_xp_cls_set_l4_port(field, OPS_XP_IACL_L4_V6_DEST_PORT, &row->dst);
+        } else {
+            ops_xp_cls_set_l4_port(field, OPS_XP_IACL_L4_SRC_PORT, &row->src);
+            ops_xp_cls_set_l4_port(field, OPS_XP_IACL_L4_DEST_PORT, &row->dst);
+        }
+
+        /* Get hw tcamId from rule entry index */
+        xpsTcamMgrTcamIdFromEntryGet(devId, batch->tableId,
+                                     row->rule->rule_id, &tcamId);
 
-        memset(field->fldList[OPS_XP_IACL_PROTOCOL].mask, 0x0,
-               iacl_key_v4[OPS_XP_IACL_PROTOCOL].size);
-    }
+        VLOG_DBG("Installing in HW table %d, RuleId %d, HWID: %d",
+                 batch->tableId, row->rule->rule_id, tcamId);
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_TOS_VALID) {
+        ops_xp_cls_write_row(devId, batch->tableId, tcamId, field, data);
+    }
 
-        field->fldList[OPS_XP_IACL_DSCP_ECN].fld.v4Fld = XP_IACL_DSCP_ECN;
+    batch->n_rows = 0;
+}
 
-        memcpy(field->fldList[OPS_XP_IACL_DSCP_ECN].value, 
-               &entry->entry_fields.tos,
-               iacl_key_v4[OPS_XP_IACL_DSCP_ECN].size);
+/*
+ * Allocate TCAM rows for entry ace_idx of a classifier with the priority,
+ * append them to the rows list and queue them to be written into hw
+ */
+static XP_STATUS
+ops_xp_cls_ace_rows_add(struct xp_cls_batch *batch,
+                        const struct ops_cls_list_entry *ace, uint16_t ace_idx,
+                        uint32_t priority, struct ovs_list *rows)
+{
+    struct xp_cls_port_prefix src[XP_CLS_L4_PORT_PREFIX_MAX];
+    struct xp_cls_port_prefix dst[XP_CLS_L4_PORT_PREFIX_MAX];
+    size_t                   n_src, n_dst;
+    xpDevice_t               devId;
+    XP_STATUS                status = XP_NO_ERR;
 
-        memcpy(field->fldList[OPS_XP_IACL_DSCP_ECN].mask, 
-               &entry->entry_fields.tos_mask,
-               iacl_key_v4[OPS_XP_IACL_DSCP_ECN].size);
-    }
+    devId = 0;
 
-   /* if(entry->entry_fields.entry_flags & OPS_CLS_TCP_FLAGS_VALID) {
+    /* Port ranges and inequalities take a row per SRC x DST prefix.
+     * Rows of an entry are disjoint so they share the priority. */
+    ops_xp_cls_entry_expand(ace, src, &n_src, dst, &n_dst);
 
-        field->fldList[OPS_XP_IACL_TCP_FLAGS].fld.v4Fld = XP_IACL_TCP_FLAGS;
+    for (size_t s = 0; s < n_src && status == XP_NO_ERR; s++) {
+        for (size_t d = 0; d < n_dst; d++) {
+            struct xp_cls_batch_row *row;
+            struct xp_acl_rule      *entry;
+            uint32_t                rule_index;
 
-        memcpy(field->fldList[OPS_XP_IACL_TCP_FLAGS].value, 
-               &entry->entry_fields.tcp_flags, sizeof(uint8_t));
+            /* Get tcam index from tcam manager and add it to the rule list. */
+            status = ops_xp_cls_tcam_entry_alloc(devId, batch->tableId,
+                                                 priority, &rule_index);
+            if (status != XP_NO_ERR) {
+                VLOG_ERR_RL(&rl, "xpsTcamMgrAllocEntry failed with error %d",
+                            status);
+                break;
+            }
 
-        memcpy(field->fldList[OPS_XP_IACL_TCP_FLAGS].mask, 
-               &entry->entry_fields.tcp_flags_mask, sizeof(uint8_t));
-    }*/
+            entry = ops_xp_cls_rule_alloc();
+            entry->rule_id = rule_index;
+            entry->ace_idx = ace_idx;
+            entry->priority = priority;
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_ICMP_CODE_VALID) {
+            /* Update count enable filed */
+            if (ace->entry_actions.action_flags & OPS_CLS_ACTION_COUNT) {
+                entry->counter_en = 1;
+            }
 
-        field->fldList[OPS_XP_IACL_ICMP_CODE].fld.v4Fld = XP_IACL_ICMP_CODE;
+            list_push_back(rows, &entry->list_node);
+            batch->classifier->num_rows++;
 
-        memcpy(field->fldList[OPS_XP_IACL_ICMP_CODE].value, 
-               &entry->entry_fields.icmp_code,
-               iacl_key_v4[OPS_XP_IACL_ICMP_CODE].size);
+            if (batch->n_rows >= batch->allocated_rows) {
+                batch->rows = x2nrealloc(batch->rows, &batch->allocated_rows,
+                                         sizeof(*batch->rows));
+            }
 
-        memset(field->fldList[OPS_XP_IACL_ICMP_CODE].mask, 0x0,
-               iacl_key_v4[OPS_XP_IACL_ICMP_CODE].size);
+            row = &batch->rows[batch->n_rows++];
+            row->rule = entry;
+            row->ace = ace;
+            row->src = src[s];
+            row->dst = dst[d];
+        }
     }
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_ICMP_TYPE_VALID) {
+    return status;
+}
 
-        field->fldList[OPS_XP_IACL_ICMP_MSG_TYPE].fld.v4Fld = XP_IACL_ICMP_MSG_TYPE;
+/*
+ * Clear TCAM rows of a classifier in hw and release them
+ */
+static void
+ops_xp_cls_rows_destroy(struct xp_acl_entry *classifier, uint32_t tableId,
+                        struct ovs_list *rows)
+{
+    uint32_t                tcamId;
+    struct xp_acl_rule      *entry;
+    xpDevice_t              devId;
 
-        memcpy(field->fldList[OPS_XP_IACL_ICMP_MSG_TYPE].value, 
-               &entry->entry_fields.icmp_type,
-               iacl_key_v4[OPS_XP_IACL_ICMP_MSG_TYPE].size);
+    devId = 0;
 
-        memset(field->fldList[OPS_XP_IACL_ICMP_MSG_TYPE].mask, 0x0,
-               iacl_key_v4[OPS_XP_IACL_ICMP_MSG_TYPE].size);
-    }
+    /* Invalid key and empty data to clear the rows */
+    ops_xp_cls_reset_field_data(cls_field, cls_data);
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_VLAN_VALID) {
+    LIST_FOR_EACH_POP (entry, list_node, rows) {
 
-        field->fldList[OPS_XP_IACL_BD].fld.v4Fld = XP_IACL_BD;
+        /* Get hw tcamId from rule entry index */
+        xpsTcamMgrTcamIdFromEntryGet(devId, tableId, entry->rule_id, &tcamId);
 
-        memcpy(field->fldList[OPS_XP_IACL_BD].value, 
-               &entry->entry_fields.vlan, iacl_key_v4[OPS_XP_IACL_BD].size);
+        ops_xp_cls_write_row(devId, tableId, tcamId, cls_field, cls_data);
 
-        memset(field->fldList[OPS_XP_IACL_BD].mask, 0x0,
-               iacl_key_v4[OPS_XP_IACL_BD].size);
+        /* Free entry from tcam manager */
+        ops_xp_cls_tcam_entry_free(devId, tableId, entry->rule_id);
+        classifier->num_rows--;
+        ops_xp_cls_rule_free(entry);
+    }
+}
+
+/*
+ * Number of TCAM rows of the compiled entries [start, end)
+ */
+static size_t
+ops_xp_cls_list_n_rows(const struct xp_cls_compiled *comp,
+                       uint32_t start, uint32_t end)
+{
+    size_t n_rows = 0;
+
+    for (uint32_t i = start; i < end; i++) {
+        n_rows += ops_xp_cls_entry_n_rows(&comp->entries[i]);
     }
 
-    /* Populate SRC MAC and DST MAC */
+    return n_rows;
+}
 
-    if (entry->entry_fields.entry_flags & OPS_CLS_L2_ETHERTYPE_VALID) {
+/*
+ * Keep the programmed entries to diff later updates against. Takes the
+ * entries over from comp.
+ */
+static void
+ops_xp_cls_aces_set(struct xp_acl_entry *classifier,
+                    struct xp_cls_compiled *comp)
+{
+    free(classifier->aces);
+    free(classifier->ace_map);
 
-        field->fldList[OPS_XP_IACL_V4_ETHER_TYPE].fld.v4Fld = XP_IACL_V4_ETHER_TYPE;
+    classifier->aces = comp->entries;
+    classifier->ace_map = comp->ace_idx;
+    classifier->num_aces = comp->n;
+    classifier->num_rules = comp->n_list;
 
-        memcpy(field->fldList[OPS_XP_IACL_V4_ETHER_TYPE].value, 
-               &entry->entry_fields.L2_ethertype,
-               iacl_key_v4[OPS_XP_IACL_V4_ETHER_TYPE].size);
+    comp->entries = NULL;
+    comp->ace_idx = NULL;
+}
 
-        memset(field->fldList[OPS_XP_IACL_V4_ETHER_TYPE].mask, 0x0,
-               iacl_key_v4[OPS_XP_IACL_V4_ETHER_TYPE].size);
-    }
+/*
+ * Compile the list and log what the compiler saved
+ */
+static void
+ops_xp_cls_list_compile(struct ops_cls_list *cls_list,
+                        struct xp_cls_compiled *comp)
+{
+    ops_xp_cls_compile(cls_list, comp);
 
-    /* Check L2_cos is not supported */
+    if (comp->n != comp->n_list) {
+        VLOG_DBG("Compiled %u entries of classifier %s into %u: "
+                 "%u shadowed, %u redundant, %u merged",
+                 comp->n_list, cls_list->list_name, comp->n,
+                 comp->n_shadowed, comp->n_redundant, comp->n_merged);
+    }
+}
 
-    /* Populate data */
-    iaclData->isTerminal = 1;
-    iaclData->enPktCmdUpd = 1;
-    if (entry->entry_actions.action_flags & OPS_CLS_ACTION_PERMIT) {
-        iaclData->pktCmd = XP_PKTCMD_FWD;
-    } else if (entry->entry_actions.action_flags & OPS_CLS_ACTION_DENY) {
-        iaclData->pktCmd = XP_PKTCMD_DROP;
+/*
+ * Move all rows of src to the end of dst
+ */
+static void
+ops_xp_cls_rows_append(struct ovs_list *dst, struct ovs_list *src)
+{
+    if (!list_is_empty(src)) {
+        list_splice(dst, list_front(src), src);
     }
 }
 
 /*
- * create rule id list for a classifier
+ * create rule id list for a classifier. Rows are placed into a newly
+ * reserved block of the table, the caller releases the previous one.
+ * On failure rows written so far and the block are released and the
+ * classifier is left as it was.
  */
-struct ops_cls_pd_status *
+static int
 ops_xp_cls_create_rule_entry_list(struct xp_acl_entry *classifier,
-                                  struct ops_cls_list *cls_list,
+                                  struct xp_cls_compiled *comp,
                                   struct ovs_list *list)
 {
     uint32_t                 tableId;
-    uint32_t                 tcamId;
     xpAclType_e              tableType;
-    xpDevice_t               devId;
-    XP_STATUS                status;
-    struct ops_cls_pd_status *ops_status;
-    xpsIaclData_t            *iaclData;
-    xpsIaclkeyFieldList_t    *field;
-
-    devId = 0;
+    struct xp_cls_batch      batch;
+    struct xp_cls_tcam_block *block;
+    struct ovs_list          rows;
+    size_t                   n_rows;
+    XP_STATUS                status = XP_NO_ERR;
 
     VLOG_DBG("%s", __FUNCTION__);
 
@@ -671,102 +1901,53 @@ ops_xp_cls_create_rule_entry_list(struct xp_acl_entry *classifier,
 
     tableId = tableType;
 
-    /* For each entry in the classifier entries list, create a local copy and
-     * store its link in local list
-     */
-
-    classifier->num_rules = cls_list->num_entries;
-
-    VLOG_DBG("Number of entries needs to be programmed %d", cls_list->num_entries);
-
-    for (int i = 0; i < cls_list->num_entries; i++) {
-        struct xp_acl_rule  *entry;
-        uint32_t            rule_index;
-        uint32_t            priority;
-
-        entry = malloc(sizeof(struct xp_acl_rule));
-        priority = cls_list->num_entries - i;
-
-        /* Get tcam index from tcam manager and add it to the rule list. */
-        status = xpsTcamMgrAllocEntry(devId, tableId, priority, &rule_index);
-
-        entry->rule_id = rule_index;
-        entry->counter_en = 0;
-        
-        /* Update count enable filed */
-        if (cls_list->entries[i].entry_actions.action_flags & OPS_CLS_ACTION_COUNT) {
-            entry->counter_en = 1;
-            entry->count = 0;
-        }
-
-        list_push_back(list, &entry->list_node);
-
-        /* Get hw tcamId from rule entry index */
-        status = xpsTcamMgrTcamIdFromEntryGet(devId, tableId, rule_index, &tcamId);
-        VLOG_DBG("allocated tcam RuleId %d, HW tcam Index %d", rule_index, tcamId);
-
-        /* Populate entry in filed list to program in hw */
-        ops_xp_alloc_reset_field_data(&field, &iaclData);
-        field->numFlds = OPS_XP_IACL_V4_MAX_FIELDS;
-        field->isValid = 0x1;
-        field->type = XP_IACL_V4_TYPE;
-        ops_xp_cls_populate_iacl_entires(&cls_list->entries[i], field, iaclData);
+    n_rows = ops_xp_cls_list_n_rows(comp, 0, comp->n);
 
-        /* Update ACL ID to fields list */
-        field->fldList[OPS_XP_IACL_ID].fld.v4Fld = XP_IACL_ID;
+    block = ops_xp_cls_tcam_block_alloc(tableId, n_rows, XP_CLS_PRIORITY_STEP);
+    if (!block) {
+        VLOG_ERR_RL(&rl, "Could not reserve %"PRIuSIZE" TCAM rows in "
+                    "table %u", n_rows, tableId);
+        return ENOSPC;
+    }
 
-        memset(field->fldList[OPS_XP_IACL_ID].value, classifier->acl_id, sizeof(uint8_t));
-        memset(field->fldList[OPS_XP_IACL_ID].mask, 0x0, sizeof(uint8_t));
+    VLOG_DBG("Number of entries needs to be programmed %u", comp->n);
 
-        VLOG_DBG("Installing in HW table %d, HWID: %d", tableId, tcamId);
+    list_init(&rows);
+    ops_xp_cls_batch_init(&batch, classifier, tableId, n_rows);
 
-        switch (tableId) {
+    for (uint32_t i = 0; i < comp->n && status == XP_NO_ERR; i++) {
+        uint32_t priority;
 
-        case XP_ACL_IACL0:
-            status =  xpsIaclWritePaclKey(devId, tcamId, field);
-            if (status != XP_NO_ERR) {
-                VLOG_DBG("xpsIaclWritePaclKey failed with error %d", status);
-            }
+        priority = block->base + (comp->n - i) * XP_CLS_PRIORITY_STEP;
 
-            status = xpsIaclWritePaclData(devId, tcamId, iaclData);
-            if (status != XP_NO_ERR) {
-                VLOG_DBG("xpsIaclWritePaclData failed with error %d", status);
-            }
-            break;
+        status = ops_xp_cls_ace_rows_add(&batch, &comp->entries[i], i,
+                                         priority, &rows);
+    }
 
-        case XP_ACL_IACL1:
-            status = xpsIaclWriteBaclKey(devId, tcamId, field);
-            if (status != XP_NO_ERR) {
-                VLOG_DBG("xpsIaclWriteBaclKey failed with error %d", status);
-            }
+    if (status == XP_NO_ERR) {
+        ops_xp_cls_batch_commit(&batch);
+    }
+    ops_xp_cls_batch_destroy(&batch);
 
-            status = xpsIaclWriteBaclData(devId, tcamId, iaclData);
-            if (status != XP_NO_ERR) {
-                VLOG_DBG("xpsIaclWriteBaclData failed with error %d", status);
-            }
-            break;
+    if (status != XP_NO_ERR) {
+        VLOG_ERR_RL(&rl, "Could not program %u entries into TCAM table "
+                    "%u, error %d", comp->n, tableId, status);
 
-        case XP_ACL_IACL2:
-            status = xpsIaclWriteRaclKey(devId, tcamId, field);
-            if (status != XP_NO_ERR) {
-                VLOG_DBG("xpsIaclRritePaclKey failed with error %d", status);
-            }
+        ops_xp_cls_rows_destroy(classifier, tableId, &rows);
+        ops_xp_cls_tcam_block_free(tableId, block);
+        return ENOSPC;
+    }
 
-            xpsIaclWriteRaclData(devId, tcamId, iaclData);
-            if (status != XP_NO_ERR) {
-                VLOG_DBG("xpsIaclRritePaclData failed with error %d", status);
-            }
-            break;
+    /* For each entry in the classifier entries list, keep a local copy
+     * the rows refer to by index */
+    ops_xp_cls_rows_append(list, &rows);
+    classifier->block = block;
+    ops_xp_cls_aces_set(classifier, comp);
 
-        default:
-            break;
-        }
+    VLOG_DBG("Programmed %u entries into %u TCAM rows",
+             classifier->num_rules, classifier->num_rows);
 
-        /* memset field and data to zero and release memory allocated
-         * by populate entries
-         */
-        ops_xp_free_field_data(field, iaclData);
-    }
+    return 0;
 }
 
 
@@ -777,296 +1958,494 @@ void
 ops_xp_cls_destroy_rule_entry_list(struct xp_acl_entry *classifier)
 {
     uint32_t                tableId;
-    uint32_t                tcamId;
     xpAclType_e             tableType;
-    struct xp_acl_rule      *entry, *next_entry;
-    struct ovs_list         *list;
-    xpDevice_t              devId;
-    xpsIaclData_t           *iaclData;
-    xpsIaclkeyFieldList_t   *field;
-    XP_STATUS               status;
 
     VLOG_DBG("%s", __FUNCTION__);
 
-    list = &classifier->rule_list;
-    devId = 0;
-
     /* Get type ACL */
     tableType = ops_xp_cls_get_type(&classifier->intf_info, classifier->cls_direction);
 
     /* Get tableId from tableType */
     tableId = tableType;
 
-    LIST_FOR_EACH_SAFE (entry, next_entry, list_node, list) {
-
-        /* Get hw tcamId from rule entry index */
-        status = xpsTcamMgrTcamIdFromEntryGet(devId, tableId, entry->rule_id, &tcamId);
+    ops_xp_cls_rows_destroy(classifier, tableId, &classifier->rule_list);
+    ops_xp_cls_tcam_block_free(tableId, classifier->block);
+    classifier->block = NULL;
+}
 
-        ops_xp_alloc_reset_field_data(&field, &iaclData);
+/*
+ * Rebuild rows of a classifier in a new block. New rows are programmed
+ * before the old ones are released. The reservation of the old block is
+ * handed over to the new one first, so the table only needs room for
+ * the rows themselves, not for two reservations of the classifier.
+ */
+static int
+ops_xp_cls_rebuild_rule_entry_list(struct xp_acl_entry *classifier,
+                                   struct xp_cls_compiled *comp)
+{
+    struct xp_cls_tcam_block    *old_block = classifier->block;
+    struct ovs_list             old_rows;
+    uint32_t                    tableId;
+    uint32_t                    old_reserved;
 
-        switch (tableId) {
-        case XP_ACL_IACL0:
-            xpsIaclWritePaclKey(devId, tcamId, field);
-            xpsIaclWritePaclData(devId, tcamId, iaclData);
-            break;
+    tableId = ops_xp_cls_get_type(&classifier->intf_info,
+                                  classifier->cls_direction);
 
-        case XP_ACL_IACL1:
-            xpsIaclWriteBaclKey(devId, tcamId, field);
-            xpsIaclWriteBaclData(devId, tcamId, iaclData);
-            break;
+    list_init(&old_rows);
+    ops_xp_cls_rows_append(&old_rows, &classifier->rule_list);
 
-        case XP_ACL_IACL2:
-            xpsIaclWriteRaclKey(devId, tcamId, field);
-            xpsIaclWriteRaclData(devId, tcamId, iaclData);
-            break;
+    old_reserved = ops_xp_cls_tcam_block_release(tableId, old_block);
 
-        default:
-            break;
-        }
+    if (ops_xp_cls_create_rule_entry_list(classifier, comp,
+                                          &classifier->rule_list)) {
+        ops_xp_cls_tcam_block_reclaim(tableId, old_block, old_reserved);
+        ops_xp_cls_rows_append(&classifier->rule_list, &old_rows);
+        return ENOSPC;
+    }
 
-        /* Free entry from tcam manager */
-        xpsTcamMgrFreeEntry(devId, tableId, entry->rule_id);
-        list_remove(&entry->list_node);
-        free(entry);
+    ops_xp_cls_rows_destroy(classifier, tableId, &old_rows);
+    ops_xp_cls_tcam_block_free(tableId, old_block);
 
-    }
+    return 0;
 }
 
+/*
+ * Entries are compared by content, so an unchanged entry keeps its rows
+ */
+static bool
+ops_xp_cls_ace_equal(const struct xp_acl_entry *classifier,
+                     const struct ops_cls_list_entry *a,
+                     const struct ops_cls_list_entry *b)
+{
+    return ops_xp_cls_entry_equal(a, b, classifier->acl_set->list_type);
+}
 
 /*
- * Add the acl rules meta data to HMAP
+ * Update rule id list of a classifier to the new list rewriting only
+ * the entries between the longest unchanged head and tail. New rows are
+ * programmed before the replaced ones are released, so the classifier
+ * never stops matching. Falls back to rebuilding the whole list if the
+ * priority gap between head and tail can not hold the new entries.
  */
-struct ops_cls_pd_status *
-ops_xp_cls_acl_add(struct ops_cls_list *cls,
-                   struct xp_acl_entry* acl_entry)
+static int
+ops_xp_cls_update_rule_entry_list(struct xp_acl_entry *classifier,
+                                  struct ops_cls_list *cls_list)
 {
-    uint32_t                    hash_index;
-    uint8_t                     acl_id;
-    struct ops_cls_pd_status    *status; 
-    xpAclType_e                 acl_type;
-    xpsDevice_t                 devId;
-    uint8_t                     allocated=0;
-    uint32_t                    hash_id;
-    struct xp_acl_entry         *classifier;
+    struct ovs_list         old_rows, new_rows, tail_rows;
+    struct xp_acl_rule      *entry, *next_entry;
+    struct xp_cls_batch     batch;
+    struct xp_cls_compiled  comp;
+    uint32_t                tableId;
+    uint32_t                n, m, head, tail, n_new;
+    uint32_t                hi, lo, step, block_end;
+    XP_STATUS               status = XP_NO_ERR;
+    int                     error = 0;
 
-    VLOG_DBG("%s", __FUNCTION__);
+    tableId = ops_xp_cls_get_type(&classifier->intf_info,
+                                  classifier->cls_direction);
 
-    if (cls == NULL) {
-        return NULL;
+    /* Compiled entries are diffed, so entries the compiler drops do not
+     * touch TCAM */
+    ops_xp_cls_list_compile(cls_list, &comp);
+
+    n = classifier->num_aces;
+    m = comp.n;
+
+    for (head = 0; head < n && head < m; head++) {
+        if (!ops_xp_cls_ace_equal(classifier, &classifier->aces[head],
+                                  &comp.entries[head])) {
+            break;
+        }
     }
 
-    /* Set status to default */
-    status = malloc(sizeof(struct ops_cls_pd_status));
-    if (!status) {
-        return NULL;
+    for (tail = 0; tail < n - head && tail < m - head; tail++) {
+        if (!ops_xp_cls_ace_equal(classifier,
+                                  &classifier->aces[n - 1 - tail],
+                                  &comp.entries[m - 1 - tail])) {
+            break;
+        }
     }
 
-    status->status_code = OPS_CLS_STATUS_SUCCESS;
-    status->entry_id = 0;
+    n_new = m - head - tail;
 
-    /* Populate acl entry to store it in HMAP */
-    acl_entry->list_uid = cls->list_id;
+    VLOG_DBG("Updating classifier %s: %u unchanged head, %u unchanged tail, "
+             "%u entries replaced by %u", cls_list->list_name, head, tail,
+             n - head - tail, n_new);
 
-    /* Allocate aclid and maintain it in acl_id this aclid
-     * should not be reallocated if already allocated to
-     * PACL or RACL or BACL for same UUID then reuse it
-     */
-    devId = 0;
+    if (head == n && head == m) {
+        /* List entries the compiled ones stand for may still change */
+        ops_xp_cls_aces_set(classifier, &comp);
+        goto out;
+    }
 
-    /* Get hash id from uid */
-    hash_id = uuid_hash(&cls->list_id);
+    if (ops_xp_cls_list_n_rows(&comp, 0, m) > classifier->block->rows) {
+        VLOG_DBG("Classifier %s outgrows its TCAM block, rebuilding",
+                 cls_list->list_name);
 
-    /* Search in PACL */
-    HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_pacl) {
-        if (uuid_equals(&classifier->list_uid, &cls->list_id)) {
-            allocated =1;
-            acl_id = classifier->acl_id;
-            VLOG_DBG("Allocated ACLID %d in PACL HMAP", acl_id);
-        }
+        error = ops_xp_cls_rebuild_rule_entry_list(classifier, &comp) ?
+                EFAULT : 0;
+        goto out;
     }
 
-    /* Search in BACL*/
-    HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_bacl) {
-        if (uuid_equals(&classifier->list_uid, &cls->list_id)) {
-            allocated = 1;
-            acl_id = classifier->acl_id;
-            VLOG_DBG("Allocated ACLID %d in BACL HMAP", acl_id);
+    /* Detach rows of the replaced entries and of the tail */
+    list_init(&old_rows);
+    list_init(&new_rows);
+    list_init(&tail_rows);
+
+    LIST_FOR_EACH_SAFE (entry, next_entry, list_node, &classifier->rule_list) {
+        if (entry->ace_idx >= n - tail) {
+            list_remove(&entry->list_node);
+            list_push_back(&tail_rows, &entry->list_node);
+        } else if (entry->ace_idx >= head) {
+            list_remove(&entry->list_node);
+            list_push_back(&old_rows, &entry->list_node);
         }
     }
 
-    /* Search in RACL */
-    HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_racl) {
-        if (uuid_equals(&classifier->list_uid, &cls->list_id)) {
-            allocated = 1;
-            acl_id = classifier->acl_id;
-            VLOG_DBG("Allocated ACLID %d in RACL HMAP", acl_id);
-        }
+    /* New entries take priorities strictly between head and tail ones
+     * inside the block of the classifier */
+    block_end = classifier->block->base + classifier->block->span;
+    lo = list_is_empty(&tail_rows) ? classifier->block->base :
+         CONTAINER_OF(list_front(&tail_rows), struct xp_acl_rule,
+                      list_node)->priority;
+    hi = list_is_empty(&classifier->rule_list) ?
+         MIN(lo + (n_new + 1) * XP_CLS_PRIORITY_STEP, block_end) :
+         CONTAINER_OF(list_back(&classifier->rule_list), struct xp_acl_rule,
+                      list_node)->priority;
+    step = (hi - lo) / (n_new + 1);
+
+    if (n_new && !step) {
+        VLOG_DBG("No priority gap for %u entries, rebuilding classifier %s",
+                 n_new, cls_list->list_name);
+
+        ops_xp_cls_rows_append(&classifier->rule_list, &old_rows);
+        ops_xp_cls_rows_append(&classifier->rule_list, &tail_rows);
+
+        error = ops_xp_cls_rebuild_rule_entry_list(classifier, &comp) ?
+                EFAULT : 0;
+        goto out;
     }
 
-    /* From above if allocated is set means we already allocated ACLID reuseit
-     * else allocate it for this UUID
-     */
-    if (allocated) {
-        acl_entry->acl_id = acl_id;
-    } else {
-        if (xpsAclIdAllocEntry(devId, &acl_id) != XP_NO_ERR) {
-            status->status_code = OPS_CLS_STATUS_HW_RESOURCE_ERR;
-        }
-        acl_entry->acl_id = acl_id;
+    /* Make */
+    ops_xp_cls_batch_init(&batch, classifier, tableId,
+                          ops_xp_cls_list_n_rows(&comp, head, head + n_new));
+
+    for (uint32_t i = 0; i < n_new && status == XP_NO_ERR; i++) {
+        status = ops_xp_cls_ace_rows_add(&batch, &comp.entries[head + i],
+                                         head + i, hi - (i + 1) * step,
+                                         &new_rows);
     }
 
-    VLOG_DBG("Allocated ACLID %d", acl_id);
+    if (status == XP_NO_ERR) {
+        ops_xp_cls_batch_commit(&batch);
+    }
+    ops_xp_cls_batch_destroy(&batch);
 
-    list_init(&acl_entry->rule_list);
+    if (status != XP_NO_ERR) {
+        /* Roll back to the old rows */
+        ops_xp_cls_rows_destroy(classifier, tableId, &new_rows);
+
+        ops_xp_cls_rows_append(&classifier->rule_list, &old_rows);
+        ops_xp_cls_rows_append(&classifier->rule_list, &tail_rows);
+        error = EFAULT;
+        goto out;
+    }
 
-    if (cls->entries != NULL) {
-        VLOG_DBG("creating list for rules and interfaces for classifier %s",
-                 cls->list_name);
+    /* Break */
+    ops_xp_cls_rows_destroy(classifier, tableId, &old_rows);
 
-        ops_xp_cls_create_rule_entry_list(acl_entry, cls, &acl_entry->rule_list);
+    LIST_FOR_EACH (entry, list_node, &tail_rows) {
+        entry->ace_idx = entry->ace_idx - n + m;
     }
 
-    VLOG_DBG("Adding metadata of classifier %s to HMAP", cls->list_name);
+    ops_xp_cls_rows_append(&classifier->rule_list, &new_rows);
+    ops_xp_cls_rows_append(&classifier->rule_list, &tail_rows);
 
-    /* Get hash index from UUID */
-    hash_index = uuid_hash(&cls->list_id);
+    ops_xp_cls_aces_set(classifier, &comp);
 
-    acl_type = ops_xp_cls_get_type(&acl_entry->intf_info, acl_entry->cls_direction);
-    if (acl_type == XP_ACL_IACL0) {
+out:
+    ops_xp_cls_compiled_destroy(&comp);
+    return error;
+}
+
+
+/*
+ * Create rows of the rule set in the ACL table of the entry
+ */
+int
+ops_xp_cls_acl_add(struct ops_cls_list *cls, struct xp_acl_set *acl_set,
+                   struct xp_acl_entry *acl_entry,
+                   struct ops_cls_pd_status *status)
+{
+    struct xp_cls_compiled comp;
 
-        hmap_insert(&classifier_hmap_pacl, &acl_entry->hnode, hash_index);
+    VLOG_DBG("%s", __FUNCTION__);
 
-    } else if (acl_type == XP_ACL_IACL1) {
+    if (cls == NULL) {
+        return EINVAL;
+    }
 
-        hmap_insert(&classifier_hmap_bacl, &acl_entry->hnode, hash_index);
+    acl_entry->list_uid = cls->list_id;
 
-    } else if (acl_type == XP_ACL_IACL2) {
+    /* ACL ID is shared by PACL, BACL and RACL of the same rule set */
+    if (ops_xp_cls_acl_bind(acl_set, acl_entry)) {
+        status->status_code = OPS_CLS_STATUS_HW_RESOURCE_ERR;
+        return ENOSPC;
+    }
 
-        hmap_insert(&classifier_hmap_racl, &acl_entry->hnode, hash_index);
+    list_init(&acl_entry->rule_list);
 
+    VLOG_DBG("creating list for rules and interfaces for classifier %s",
+             cls->list_name);
+
+    /* An empty list still gets a block to grow in */
+    ops_xp_cls_list_compile(cls, &comp);
+    if (ops_xp_cls_create_rule_entry_list(acl_entry, &comp,
+                                          &acl_entry->rule_list)) {
+        ops_xp_cls_compiled_destroy(&comp);
+        ops_xp_cls_acl_unbind(acl_entry);
+        status->status_code = OPS_CLS_STATUS_HW_RESOURCE_ERR;
+        return ENOSPC;
     }
+    ops_xp_cls_compiled_destroy(&comp);
 
-    return status;
+    return 0;
 }
 
 void
-ops_xp_cls_acl_delete(struct xp_acl_entry *acl_entry, 
-                      char *list_name,
-                      struct hmap *classifier_hmap)
+ops_xp_cls_acl_delete(struct xp_acl_entry *acl_entry)
 {
-    uint8_t             allocated=0;
-    uint8_t             acl_id;
-    struct xp_acl_entry *classifier;
-    uint32_t            hash_id;
-    struct uuid         list_uid;
-    xpsDevice_t         devId=0;
-
     VLOG_DBG("%s", __FUNCTION__);
     if (acl_entry == NULL) {
         return;
     }
 
-    /* Destroy rule and interface list */
-    VLOG_DBG("deleting rules and interface list for classifier %s", list_name);
+    /* Destroy rule list */
+    VLOG_DBG("deleting rules of ACLID %d", acl_entry->acl_id);
 
     ops_xp_cls_destroy_rule_entry_list(acl_entry);
-
-    /* Keep it for allocator reference */
-    acl_id = acl_entry->acl_id;
-    list_uid = acl_entry->list_uid;
-
-    VLOG_DBG("Deleting HMAP metadata for classifier %s", list_name);
-    hmap_remove(classifier_hmap, &acl_entry->hnode);
+    ops_xp_cls_acl_unbind(acl_entry);
 
     /* Deallocate memory */
+    free(acl_entry->aces);
+    free(acl_entry->ace_map);
     free(acl_entry);
+}
+
+/*
+ * Move the list to the rule set of its new entries. Rows of the new set
+ * are created before the interfaces are switched to its ACL ID.
+ */
+static int
+ops_xp_cls_acl_move(struct xp_acl *acl, struct ops_cls_list *list)
+{
+    struct xp_acl_set           *old_set = acl->acl_set;
+    struct xp_acl_set           *acl_set;
+    struct xp_acl_entry         *acl_entry;
+    struct xp_acl_interface     *intf;
+    struct ops_cls_pd_status    pd_status;
 
-    /* Deleting ACLID allocation if not being used by any of the tables */
+    acl_set = ops_xp_cls_acl_set_get(list);
+    if (!acl_set) {
+        return ENOSPC;
+    }
 
-    /* Get hash id from uid */
-    hash_id = uuid_hash(&list_uid);
+    memset(&pd_status, 0, sizeof(pd_status));
 
-    /* Search in PACL */
-    HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_pacl) {
-        if (uuid_equals(&classifier->list_uid, &list_uid)) {
-            if (acl_id == classifier->acl_id) {
-                allocated = 1;
-                VLOG_DBG("Allocated ACLID %d in PACL HMAP, hence not deleting",
-                         acl_id);
-            }
+    for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+        if (!acl->num_intfs[i] || acl_set->tables[i]) {
+            continue;
+        }
+
+        acl_entry = xzalloc(sizeof(struct xp_acl_entry));
+        acl_entry->intf_info = old_set->tables[i]->intf_info;
+        acl_entry->cls_direction = old_set->tables[i]->cls_direction;
+
+        if (ops_xp_cls_acl_add(list, acl_set, acl_entry, &pd_status)) {
+            free(acl_entry);
+            ops_xp_cls_acl_set_trim(acl_set);
+            ops_xp_cls_acl_set_put(acl_set);
+            return EFAULT;
         }
     }
 
-    /* Search in BACL*/
-    HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_bacl) {
-        if (uuid_equals(&classifier->list_uid, &list_uid)) {
-            if (acl_id == classifier->acl_id) {
-                allocated = 1;
-                VLOG_DBG("Allocated ACLID %d in BACL HMAP, hence not deleting",
-                         acl_id);
-            }
+    for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+        if (!acl->num_intfs[i]) {
+            continue;
+        }
+
+        LIST_FOR_EACH (intf, list_node, &acl->intfs[i]) {
+            ops_xp_cls_intf_set(intf, acl_set->acl_id, true);
+        }
+
+        acl_set->tables[i]->num_intfs += acl->num_intfs[i];
+        old_set->tables[i]->num_intfs -= acl->num_intfs[i];
+    }
+
+    VLOG_DBG("Moved classifier "UUID_FMT" from ACLID %d to ACLID %d",
+             UUID_ARGS(&acl->list_uid), old_set->acl_id, acl_set->acl_id);
+
+    acl->acl_set = acl_set;
+    ops_xp_cls_acl_set_trim(old_set);
+    ops_xp_cls_acl_set_put(old_set);
+
+    return 0;
+}
+
+/*
+ * Rows of a classifier are fragmented once an entry can not be inserted
+ * between some of its adjacent entries without rebuilding the list
+ */
+static bool
+ops_xp_cls_rows_fragmented(const struct xp_acl_entry *classifier)
+{
+    const struct xp_acl_rule *entry;
+    uint32_t prev = 0;
+
+    LIST_FOR_EACH (entry, list_node, &classifier->rule_list) {
+        if (prev && entry->priority != prev && prev - entry->priority < 2) {
+            return true;
         }
+        prev = entry->priority;
     }
 
-    /* Search in RACL */
-    HMAP_FOR_EACH_WITH_HASH(classifier, hnode, hash_id, &classifier_hmap_racl) {
-        if (uuid_equals(&classifier->list_uid, &list_uid)) {
-            if (acl_id == classifier->acl_id) {
-                allocated = 1;
-                VLOG_DBG("Allocated ACLID %d in RACL HMAP, hence not deleting",
-                         acl_id);
+    return false;
+}
+
+/*
+ * Repack rows of fragmented classifiers into new blocks, so further
+ * updates are incremental again. Returns number of repacked classifiers.
+ */
+static uint32_t
+ops_xp_cls_defrag(void)
+    OVS_REQUIRES(cls_mutex)
+{
+    struct xp_acl_set       *acl_set;
+    struct xp_acl_entry     *acl_entry;
+    struct xp_cls_compiled  comp;
+    uint32_t                n = 0;
+
+    HMAP_FOR_EACH (acl_set, hnode, &cls_acl_sets) {
+        for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+            acl_entry = acl_set->tables[i];
+            if (!acl_entry || !ops_xp_cls_rows_fragmented(acl_entry)) {
+                continue;
+            }
+
+            /* Rebuild replaces the entries of the classifier */
+            memset(&comp, 0, sizeof(comp));
+            comp.n = acl_entry->num_aces;
+            comp.n_list = acl_entry->num_rules;
+            if (comp.n) {
+                comp.entries = xmemdup(acl_entry->aces, comp.n *
+                                       sizeof(struct ops_cls_list_entry));
+                comp.ace_idx = xmemdup(acl_entry->ace_map,
+                                       comp.n * sizeof(uint16_t));
+            }
+
+            if (!ops_xp_cls_rebuild_rule_entry_list(acl_entry, &comp)) {
+                VLOG_DBG("Repacked ACLID %d in table %d",
+                         acl_entry->acl_id, i);
+                ops_xp_cls_tcam_defragmented(i);
+                n++;
             }
+
+            ops_xp_cls_compiled_destroy(&comp);
         }
     }
 
-    if (!allocated) {
-        xpsAclIdFreeEntry(devId, acl_id);
+    return n;
+}
+
+/*
+ * Periodic classifier work of the main thread. Defragmentation reprograms
+ * TCAM rows, so it runs along with the other programming and not on the
+ * counters harvesting thread.
+ */
+void
+ops_xp_cls_run(void)
+{
+    if (time_msec() < cls_defrag_time) {
+        return;
     }
 
+    ovs_mutex_lock(&cls_mutex);
+    ops_xp_cls_defrag();
+    ovs_mutex_unlock(&cls_mutex);
+
+    cls_defrag_time = time_msec() + XP_CLS_DEFRAG_INTERVAL;
 }
 
 void
+ops_xp_cls_wait(void)
+{
+    poll_timer_wait_until(cls_defrag_time);
+}
+
+/*
+ * Check that IACL tables have keys for the list type and that all entries
+ * of the list fit into TCAM once their L4 port ranges are expanded.
+ * Returns false and updates pd_status otherwise.
+ */
+bool
 ops_xp_cls_validate_entries(struct ops_cls_list *list,
                             struct ops_cls_pd_status **pd_status)
 {
+    struct xp_cls_compiled comp;
+    uint32_t n_rows = 0;
+
+    if (list->list_type == OPS_CLS_ACL_V6 && !cls_v6_supported) {
+        VLOG_WARN("Classifier %s is IPv6, which IACL tables have no key for",
+                  list->list_name);
+        (*pd_status)->status_code = OPS_CLS_STATUS_HW_CONFIG_ERR;
+        return false;
+    }
+
     for (int i = 0; i < list->num_entries; i++) {
-        struct ops_cls_list_entry *entry;
+        n_rows += ops_xp_cls_entry_n_rows(&list->entries[i]);
+    }
+
+    if (n_rows <= XP_CLS_TCAM_TABLE_SIZE) {
+        return true;
+    }
 
-        entry = &list->entries[i];
-        if ((entry->entry_fields.L4_src_port_op == OPS_CLS_L4_PORT_OP_NEQ) ||
-            (entry->entry_fields.L4_src_port_op == OPS_CLS_L4_PORT_OP_LT) ||
-            (entry->entry_fields.L4_src_port_op == OPS_CLS_L4_PORT_OP_GT) ||
-            (entry->entry_fields.L4_src_port_op == OPS_CLS_L4_PORT_OP_RANGE)) {
+    /* Compiling is only worth it for lists which do not fit as they are */
+    ops_xp_cls_compile(list, &comp);
 
-            (*pd_status)->status_code = OPS_CLS_STATUS_HW_UNSUPPORTED_ERR;
-            (*pd_status)->entry_id = i;
-        }
+    n_rows = 0;
+    for (uint32_t i = 0; i < comp.n; i++) {
+        n_rows += ops_xp_cls_entry_n_rows(&comp.entries[i]);
 
-        if ((entry->entry_fields.L4_dst_port_op == OPS_CLS_L4_PORT_OP_NEQ) ||
-            (entry->entry_fields.L4_dst_port_op  == OPS_CLS_L4_PORT_OP_LT) ||
-            (entry->entry_fields.L4_dst_port_op  == OPS_CLS_L4_PORT_OP_GT) ||
-            (entry->entry_fields.L4_dst_port_op  == OPS_CLS_L4_PORT_OP_RANGE)) {
+        if (n_rows > XP_CLS_TCAM_TABLE_SIZE) {
+            VLOG_WARN("Classifier %s takes more than %u TCAM rows",
+                      list->list_name, XP_CLS_TCAM_TABLE_SIZE);
 
-            (*pd_status)->status_code = OPS_CLS_STATUS_HW_UNSUPPORTED_ERR;
-            (*pd_status)->entry_id = i;
+            (*pd_status)->status_code = OPS_CLS_STATUS_HW_RESOURCE_ERR;
+            (*pd_status)->entry_id = comp.ace_idx[i];
+            ops_xp_cls_compiled_destroy(&comp);
+            return false;
         }
     }
+
+    ops_xp_cls_compiled_destroy(&comp);
+
+    return true;
 }
 
-int
-ops_xp_cls_apply(struct ops_cls_list *list, struct ofproto *ofproto,
-                 void *aux, struct ops_cls_interface_info *interface_info,
-                 enum ops_cls_direction direction,
-                 struct ops_cls_pd_status *pd_status)
+static int
+ops_xp_cls_apply__(struct ops_cls_list *list, struct ofproto *ofproto,
+                   void *aux, struct ops_cls_interface_info *interface_info,
+                   enum ops_cls_direction direction,
+                   struct ops_cls_pd_status *pd_status)
+    OVS_REQUIRES(cls_mutex)
 {
+    struct xp_acl               *acl;
     struct xp_acl_entry         *acl_entry;
     struct ofproto_xpliant      *ofproto_xp;
     struct bundle_xpliant       *bundle;
     struct xp_acl_rule          *entry, *next_entry;
     struct ovs_list             *ovslist;
-    struct ofport_xpliant       *port = NULL;
-    struct ofport_xpliant       *next_port = NULL;
-    xpsInterfaceId_t            intf;
+    xpAclType_e                 acl_type;
     uint32_t                    tcamId;
 
     VLOG_DBG("%s", __FUNCTION__);
@@ -1080,10 +2459,14 @@ ops_xp_cls_apply(struct ops_cls_list *list, struct ofproto *ofproto,
         return EPERM;
     }
 
-    /* Validate unsupported parameters */
-    ops_xp_cls_validate_entries(list, &pd_status);
+    acl_type = ops_xp_cls_get_type(interface_info, direction);
+    if (acl_type >= XP_ACML_TOTAL_TYPE) {
+        pd_status->status_code = OPS_CLS_STATUS_HW_RESOURCE_ERR;
+        return 0;
+    }
 
-    if (pd_status->status_code == OPS_CLS_STATUS_HW_UNSUPPORTED_ERR) {
+    /* Validate TCAM resources */
+    if (!ops_xp_cls_validate_entries(list, &pd_status)) {
         return 0;
     }
 
@@ -1098,35 +2481,45 @@ ops_xp_cls_apply(struct ops_cls_list *list, struct ofproto *ofproto,
     VLOG_DBG("key_failed_pacl = %d     key_failed_racl = %d",
              key_failed_pacl, key_failed_racl);
 
-    acl_entry = ops_xp_cls_hmap_lookup(&list->list_id, interface_info, direction);
-    if (!acl_entry) {
-        acl_entry = malloc(sizeof(struct xp_acl_entry));
-        memset(acl_entry, 0x0, sizeof(struct xp_acl_entry));
-        if (!acl_entry) {
-            VLOG_ERR("%s: Could not allocate memory for the uuid %u, "
-                     "to store it in HMAP", __FUNCTION__, list->list_id);
-
+    acl = ops_xp_cls_acl_lookup(&list->list_id);
+    if (!acl) {
+        acl = ops_xp_cls_acl_create(list);
+        if (!acl) {
+            VLOG_ERR("%s: Could not allocate ACLID for classifier %s",
+                     __FUNCTION__, list->list_name);
             pd_status->status_code = OPS_CLS_STATUS_HW_RESOURCE_ERR;
             return 0;
         }
+    }
+
+    /* Rows are shared by all lists of the rule set applied in the table */
+    acl_entry = acl->acl_set->tables[acl_type];
+    if (!acl_entry) {
+        acl_entry = xzalloc(sizeof(struct xp_acl_entry));
 
         memcpy(&acl_entry->intf_info, interface_info,
                sizeof(struct ops_cls_interface_info));
         acl_entry->cls_direction = direction;
 
-        pd_status = ops_xp_cls_acl_add(list, acl_entry);
+        if (ops_xp_cls_acl_add(list, acl->acl_set, acl_entry, pd_status)) {
+            VLOG_ERR("%s: Could not add classifier %s", __FUNCTION__,
+                     list->list_name);
+            free(acl_entry);
+            ops_xp_cls_acl_release(acl);
+            return 0;
+        }
 
     } else {
         int i = 0;
 
-        VLOG_DBG("acl_id %d exists in HMAP for this UUID %d",
-                 acl_entry->acl_id, list->list_id);
+        VLOG_DBG("acl_id %d exists in registry for this UUID "UUID_FMT,
+                 acl_entry->acl_id, UUID_ARGS(&list->list_id));
 
         ovslist = &acl_entry->rule_list;
 
         /* Print TCAM manager rule ids for debugging purpose */
         LIST_FOR_EACH_SAFE (entry, next_entry, list_node, ovslist) {
-            xpsTcamMgrTcamIdFromEntryGet(0, 0, entry->rule_id, &tcamId);
+            xpsTcamMgrTcamIdFromEntryGet(0, acl_type, entry->rule_id, &tcamId);
             VLOG_DBG("rule entry %d, tcam manger rule id :%d, HWTCAM id :%d ",
                      i, entry->rule_id, tcamId);
             i++;
@@ -1134,31 +2527,27 @@ ops_xp_cls_apply(struct ops_cls_list *list, struct ofproto *ofproto,
     }
 
     /* Update ingress ACLID for port and enable ACL on port */
-    if (interface_info->interface == OPS_CLS_INTERFACE_VLAN) {
-        if (interface_info->flags & OPS_CLS_INTERFACE_L3ONLY) {
-            xpsL3SetRouterAclId(ofproto_xp->xpdev->id, 
-                                bundle->l3_intf->l3_intf_id, acl_entry->acl_id);
-            xpsL3SetRouterAclEnable(ofproto_xp->xpdev->id,
-                                    bundle->l3_intf->l3_intf_id, 0x1);
-        }
-    } else if (interface_info->interface == OPS_CLS_INTERFACE_PORT) {
-
-        LIST_FOR_EACH_SAFE (port, next_port, bundle_node, &bundle->ports) {
-            intf = ops_xp_get_ofport_intf_id(port);
-            xpsPortSetField(ofproto_xp->xpdev->id, 
-                            intf, XPS_PORT_ACL_EN, 1);
-            xpsPortSetField(ofproto_xp->xpdev->id, 
-                            intf, XPS_PORT_ACL_ID, acl_entry->acl_id);
-            VLOG_DBG("Interface value on which acl %d, applied is%d",
-                     acl_entry->acl_id, intf);
-        }
-    }
+    ops_xp_cls_acl_attach(acl, acl_type, ofproto_xp, bundle, interface_info);
 
-    /* Keep track of acl enabled interface count */
-    acl_entry->num_intfs++;
     return 0;
 }
 
+int
+ops_xp_cls_apply(struct ops_cls_list *list, struct ofproto *ofproto,
+                 void *aux, struct ops_cls_interface_info *interface_info,
+                 enum ops_cls_direction direction,
+                 struct ops_cls_pd_status *pd_status)
+{
+    int error;
+
+    ovs_mutex_lock(&cls_mutex);
+    error = ops_xp_cls_apply__(list, ofproto, aux, interface_info, direction,
+                               pd_status);
+    ovs_mutex_unlock(&cls_mutex);
+
+    return error;
+}
+
 int
 ops_xp_cls_remove(const struct uuid *list_id, const char *list_name,
                   enum ops_cls_type list_type, struct ofproto *ofproto,
@@ -1166,14 +2555,10 @@ ops_xp_cls_remove(const struct uuid *list_id, const char *list_name,
                   enum ops_cls_direction direction,
                   struct ops_cls_pd_status *pd_status)
 {
-    struct xp_acl_entry     *acl_entry;
+    struct xp_acl           *acl;
     struct ofproto_xpliant  *ofproto_xp;
     struct bundle_xpliant   *bundle;
-    struct hmap             *classifier_hmap;
-    xpAclType_e             tableType;
-    struct ofport_xpliant   *port = NULL;
-    struct ofport_xpliant   *next_port = NULL;
-    xpsInterfaceId_t        intf;
+    xpAclType_e             acl_type;
 
     VLOG_DBG("%s", __FUNCTION__);
 
@@ -1186,53 +2571,21 @@ ops_xp_cls_remove(const struct uuid *list_id, const char *list_name,
         return EPERM;
     }
 
-    acl_entry = ops_xp_cls_hmap_lookup(list_id, interface_info, direction);
-
-    if (acl_entry) {
-
-        /* Update ingress ACLID for port and disble ACL on port */
-        if (interface_info->interface == OPS_CLS_INTERFACE_VLAN) {
-            if (interface_info->flags & OPS_CLS_INTERFACE_L3ONLY) {
-                xpsL3SetRouterAclId(ofproto_xp->xpdev->id, 
-                                    bundle->l3_intf->l3_intf_id, 0x0);
-                xpsL3SetRouterAclEnable(ofproto_xp->xpdev->id,
-                                    bundle->l3_intf->l3_intf_id, 0x0);
-            }
-        } else if (interface_info->interface == OPS_CLS_INTERFACE_PORT) {
-
-            LIST_FOR_EACH_SAFE (port, next_port, bundle_node, &bundle->ports) {
-                intf = ops_xp_get_ofport_intf_id(port);
-                xpsPortSetField(ofproto_xp->xpdev->id, 
-                                intf, XPS_PORT_ACL_EN, 0);
-                xpsPortSetField(ofproto_xp->xpdev->id, 
-                                intf, XPS_PORT_ACL_ID, 0x0);
-            }
-        }
-        acl_entry->num_intfs--;
-
-        tableType = ops_xp_cls_get_type(interface_info, direction);
-        switch (tableType) {
-        case XP_ACL_IACL0:
-            classifier_hmap = &classifier_hmap_pacl;
-            break;
-
-        case XP_ACL_IACL1:
-            classifier_hmap = &classifier_hmap_bacl;
-            break;
+    acl_type = ops_xp_cls_get_type(interface_info, direction);
 
-        case XP_ACL_IACL2:
-            classifier_hmap = &classifier_hmap_racl;
-            break;
+    ovs_mutex_lock(&cls_mutex);
+    acl = ops_xp_cls_acl_lookup(list_id);
 
-        default:
-            break;
+    if (acl && acl_type < XP_ACML_TOTAL_TYPE && acl->num_intfs[acl_type]) {
 
-        }
+        /* Update ingress ACLID for port and disble ACL on port */
+        ops_xp_cls_acl_detach(acl, acl_type, bundle, interface_info);
 
-        if (!acl_entry->num_intfs) {
-            ops_xp_cls_acl_delete(acl_entry, (char *)list_name, classifier_hmap);
-        }
+        VLOG_DBG("Detached classifier %s", list_name);
+        ops_xp_cls_acl_release(acl);
     }
+    ovs_mutex_unlock(&cls_mutex);
+
     return 0;
 }
 
@@ -1243,14 +2596,10 @@ ops_xp_cls_replace(const struct uuid *list_id_orig, const char *list_name_orig,
                    enum ops_cls_direction direction,
                    struct ops_cls_pd_status *pd_status)
 {
-    struct xp_acl_entry     *acl_entry;
+    struct xp_acl           *acl;
     struct ofproto_xpliant  *ofproto_xp;
     struct bundle_xpliant   *bundle;
-    struct hmap             *classifier_hmap;
-    struct ofport_xpliant   *port = NULL;
-    struct ofport_xpliant   *next_port = NULL;
-    xpAclType_e             tableType;
-    xpsInterfaceId_t        intf;
+    xpAclType_e             acl_type;
 
     VLOG_DBG("%s", __FUNCTION__);
 
@@ -1263,79 +2612,31 @@ ops_xp_cls_replace(const struct uuid *list_id_orig, const char *list_name_orig,
         return EPERM;
     }
 
-    acl_entry = ops_xp_cls_hmap_lookup(list_id_orig, interface_info, direction);
-
-    if (acl_entry) {
-
-        /* Update ingress ACLID for port and disble ACL on port*/
-        if (interface_info->interface == OPS_CLS_INTERFACE_VLAN) {
-            if (interface_info->flags & OPS_CLS_INTERFACE_L3ONLY) {
-                xpsL3SetRouterAclId(ofproto_xp->xpdev->id, 
-                                    bundle->l3_intf->l3_intf_id, 0x0);
-                xpsL3SetRouterAclEnable(ofproto_xp->xpdev->id,
-                                    bundle->l3_intf->l3_intf_id, 0x0);
-            }
-        } else if (interface_info->interface == OPS_CLS_INTERFACE_PORT) {
-            LIST_FOR_EACH_SAFE (port, next_port, bundle_node, &bundle->ports) {
-                intf = ops_xp_get_ofport_intf_id(port);
-                xpsPortSetField(ofproto_xp->xpdev->id, 
-                                intf, XPS_PORT_ACL_EN, 0);
-                xpsPortSetField(ofproto_xp->xpdev->id, 
-                                intf, XPS_PORT_ACL_ID, 0x0);
-            }
-        }
-        acl_entry->num_intfs--;
-
-        ops_xp_cls_apply(list_new, ofproto, aux, interface_info, direction, pd_status);
-
-        if (pd_status->status_code == OPS_CLS_STATUS_SUCCESS) {
-
-            tableType = ops_xp_cls_get_type(interface_info, direction);
-            switch(tableType) {
-            case XP_ACL_IACL0:
-                classifier_hmap = &classifier_hmap_pacl;
-                break;
-
-            case XP_ACL_IACL1:
-                classifier_hmap = &classifier_hmap_bacl;
-                break;
+    acl_type = ops_xp_cls_get_type(interface_info, direction);
 
-            case XP_ACL_IACL2:
-                classifier_hmap = &classifier_hmap_racl;
-                break;
+    ovs_mutex_lock(&cls_mutex);
+    acl = ops_xp_cls_acl_lookup(list_id_orig);
 
-            default:
-                break;
+    if (acl && acl_type < XP_ACML_TOTAL_TYPE && acl->num_intfs[acl_type]) {
 
-            }
+        /* Update ingress ACLID for port and disble ACL on port. Rows of
+         * the original list are kept in case the new list shares them */
+        ops_xp_cls_acl_detach(acl, acl_type, bundle, interface_info);
 
-            if (!acl_entry->num_intfs) {
-                ops_xp_cls_acl_delete(acl_entry, (char *)list_name_orig, classifier_hmap);
-            }
+        ops_xp_cls_apply__(list_new, ofproto, aux, interface_info, direction,
+                           pd_status);
 
-        } else {
+        if (pd_status->status_code != OPS_CLS_STATUS_SUCCESS) {
             /* Revert ingress ACLID for port and enable ACL on port */
-            if (interface_info->interface == OPS_CLS_INTERFACE_VLAN) {
-                if (interface_info->flags & OPS_CLS_INTERFACE_L3ONLY) {
-                    xpsL3SetRouterAclId(ofproto_xp->xpdev->id, 
-                                        bundle->l3_intf->l3_intf_id, acl_entry->acl_id);
-                    xpsL3SetRouterAclEnable(ofproto_xp->xpdev->id,
-                                        bundle->l3_intf->l3_intf_id, 0x1);
-                }
-            } else if (interface_info->interface == OPS_CLS_INTERFACE_PORT) {
-
-                LIST_FOR_EACH_SAFE (port, next_port, bundle_node, &bundle->ports) {
-                    intf = ops_xp_get_ofport_intf_id(port);
-                    xpsPortSetField(ofproto_xp->xpdev->id, 
-                                    intf, XPS_PORT_ACL_EN, 1);
-                    xpsPortSetField(ofproto_xp->xpdev->id, 
-                                    intf, XPS_PORT_ACL_ID, acl_entry->acl_id);
-                }
-            }
-            acl_entry->num_intfs++;
-
+            ops_xp_cls_acl_attach(acl, acl_type, ofproto_xp, bundle,
+                                  interface_info);
         }
+
+        VLOG_DBG("Replaced classifier %s", list_name_orig);
+        ops_xp_cls_acl_release(acl);
     }
+    ovs_mutex_unlock(&cls_mutex);
+
     return 0;
 }
 
@@ -1343,141 +2644,68 @@ int
 ops_xp_cls_list_update(struct ops_cls_list *list,
                        struct ops_cls_pd_list_status *status)
 {
-    struct xp_acl_entry         *acl_entry_pacl, *acl_entry_racl;
-    uint8_t                     updated_pacl, updated_racl;
-    uint8_t                     failed_pacl, failed_racl;
-    struct ovs_list             pacl_new_list, racl_new_list;
-    struct ovs_list             pacl_old_list, racl_old_list;
-    struct ops_cls_pd_status    *pd_status;
+    struct xp_acl               *acl;
+    struct xp_acl_set           *acl_set;
+    struct xp_acl_entry         *acl_entry;
+    struct ops_cls_pd_status    pd_status, *pd_status_p;
+    uint8_t                     failed;
 
     VLOG_DBG("%s", __FUNCTION__);
 
-    updated_pacl = 0;
-    updated_racl = 0; 
+    failed = 0;
 
-    failed_pacl = 0;
-    failed_racl = 0;
+    memset(&pd_status, 0, sizeof(pd_status));
+    pd_status_p = &pd_status;
 
-    pd_status = malloc(sizeof(struct ops_cls_pd_status));
-
-    /* Validate unsupported parameters */
-    ops_xp_cls_validate_entries(list, &pd_status);
-
-    if (pd_status->status_code == OPS_CLS_STATUS_HW_UNSUPPORTED_ERR) {
-        status->status_code = OPS_CLS_STATUS_HW_UNSUPPORTED_ERR;
+    /* Validate TCAM resources */
+    if (!ops_xp_cls_validate_entries(list, &pd_status_p)) {
+        status->status_code = pd_status.status_code;
+        status->entry_id = pd_status.entry_id;
         return 0;
     }
 
-    /* Check if PACL needs to be updated and update if needed */
-    acl_entry_pacl = ops_xp_cls_lookup_from_hmap_type(&list->list_id, &classifier_hmap_pacl);
-
-    if (acl_entry_pacl) {
-
-        pacl_old_list = acl_entry_pacl->rule_list;
-        list_init(&pacl_new_list);
-
-        if (list->entries != NULL) {
-
-            pd_status = ops_xp_cls_create_rule_entry_list(acl_entry_pacl,
-                                                          list, &pacl_new_list);
-
-            acl_entry_pacl->rule_list = pacl_new_list;
-            updated_pacl = 1;
-
-            if (pd_status != OPS_CLS_STATUS_SUCCESS) {
-                failed_pacl = 1;
-            }
-        }
-    }
-
-    /* Check if RACL needs to be updated and update if needed */
-    acl_entry_racl = ops_xp_cls_lookup_from_hmap_type(&list->list_id,
-                                                      &classifier_hmap_racl);
-    
-    if (acl_entry_racl) {
-
-        racl_old_list = acl_entry_racl->rule_list;
-        list_init(&racl_new_list);
-
-        if (list->entries != NULL) {
-
-            pd_status = ops_xp_cls_create_rule_entry_list(acl_entry_racl, list,
-                                                          &racl_new_list);
-                
-            acl_entry_racl->rule_list = racl_new_list;
-            updated_racl = 1;
+    ovs_mutex_lock(&cls_mutex);
 
-            if (pd_status != OPS_CLS_STATUS_SUCCESS) {
-                failed_racl = 1;
-            }
-        }
-    }
-
-    if (!updated_pacl && !updated_racl) {
+    acl = ops_xp_cls_acl_lookup(&list->list_id);
+    if (!acl) {
         /* We are trying to update a  non existing Classifier
          * hence returning invalid configuration
          */
 
         status->status_code = OPS_CLS_STATUS_HW_CONFIG_ERR;
-        return 0;
-    }
-
-    if (failed_pacl || failed_racl) {
-
-        if (updated_pacl) {
-            /* Destroy new ACLlist and add old list to ACL */
-            ops_xp_cls_destroy_rule_entry_list(acl_entry_pacl);
 
-            /* Update it to old value */
-            acl_entry_pacl->rule_list = pacl_old_list;
-        }
-
-        if (updated_racl) {
-            /* Destroy new ACLlist and add old list to ACL */
-            ops_xp_cls_destroy_rule_entry_list(acl_entry_racl);
+    } else if ((acl_set = ops_xp_cls_acl_set_lookup(list)) == acl->acl_set) {
+        /* Entries have not changed */
 
-            /* Update it to old value */
-            acl_entry_racl->rule_list = racl_old_list;
+    } else if (acl_set || acl->acl_set->ref_cnt > 1) {
+        /* Either another list already has the new entries or the rule
+         * set is shared. Switch the list to the set of the new entries */
+        if (ops_xp_cls_acl_move(acl, list)) {
+            status->status_code = OPS_CLS_STATUS_HW_CONFIG_ERR;
         }
 
-        status->status_code = OPS_CLS_STATUS_HW_CONFIG_ERR;
-
     } else {
-    
-        if (updated_pacl) {
-            /* The API to destroy expects all the info in ACL entry
-             * so first assign old list to the entry, destroy the list and
-             * then update the new list to ACL entry
-             */
-            acl_entry_pacl->rule_list = pacl_old_list;
-            ops_xp_cls_destroy_rule_entry_list(acl_entry_pacl);
-
-            acl_entry_pacl->rule_list = pacl_new_list;
-            
-            /* updating new lists first node and last node propely with base
-             * list pointer, so that circular linked list is updated properly
-             */
-            pacl_new_list.next->prev = &acl_entry_pacl->rule_list;
-            pacl_new_list.prev->next = &acl_entry_pacl->rule_list;
+        /* Update the rule set in every table it is applied in */
+        for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+            acl_entry = acl->acl_set->tables[i];
+            if (!acl_entry) {
+                continue;
+            }
+
+            if (ops_xp_cls_update_rule_entry_list(acl_entry, list)) {
+                failed = 1;
+            }
         }
 
-        if (updated_racl) {
-            /* The API to destroy expects all the info in ACL entry so
-             * first assign old list to the entry, destroy the list and
-             * then update the new list to ACL entry
-             */
-            acl_entry_racl->rule_list = racl_old_list;
-            ops_xp_cls_destroy_rule_entry_list(acl_entry_racl);
-
-            acl_entry_racl->rule_list = racl_new_list;
-
-            /* updating new lists first node and last node propely with base
-             * list pointer, so that circular linked list is updated properly
-             */
-            racl_new_list.next->prev = &acl_entry_racl->rule_list;
-            racl_new_list.prev->next = &acl_entry_racl->rule_list;
+        if (failed) {
+            status->status_code = OPS_CLS_STATUS_HW_CONFIG_ERR;
+        } else {
+            ops_xp_cls_acl_set_rekey(acl->acl_set, list);
         }
     }
+
+    ovs_mutex_unlock(&cls_mutex);
+
     return 0;
 }
 
@@ -1489,17 +2717,10 @@ ops_xp_cls_stats_get(const struct uuid *list_id, const char *list_name,
                      struct ops_cls_statistics *statistics,
                      int num_entries, struct ops_cls_pd_list_status *status)
 {
-    
     xpAclType_e         acl_type;
     xpAcmClient_e       client;
-    xpsDevice_t         devId;
-    struct hmap         *classifier_hmap;
-    uint8_t             invalid_iacl_type;
     struct xp_acl_entry *acl_entry;
-    struct ovs_list     *ovslist;
-    struct xp_acl_rule  *entry, *next_entry;
-    uint32_t            tcamId;
-    uint64_t            count_pkts, count_bytes;
+    struct xp_acl_rule  *entry;
 
     VLOG_DBG("%s", __FUNCTION__);
     
@@ -1509,78 +2730,46 @@ ops_xp_cls_stats_get(const struct uuid *list_id, const char *list_name,
      * limitation
      */
 
-    devId = 0;
-    invalid_iacl_type = 0;
-
     acl_type = ops_xp_cls_get_type(interface_info, direction);
 
-    switch(acl_type) {
-    case XP_ACL_IACL0:
-        classifier_hmap = &classifier_hmap_pacl;
-        client = XP_ACM_IPACL_COUNTER;
-        break;
-
-    case XP_ACL_IACL1:
-        classifier_hmap = &classifier_hmap_bacl;
-        client = XP_ACM_IBACL_COUNTER;
-        break;
-
-    case XP_ACL_IACL2:
-        classifier_hmap = &classifier_hmap_racl;
-        client = XP_ACM_IRACL_COUNTER;
-        break;
-
-    default:
-        invalid_iacl_type = 1;
-        break;
-
-    }
-    
-    if (invalid_iacl_type) {
+    if (!ops_xp_cls_counter_client(acl_type, &client)) {
         /* update status and return */
         return 0;
     }
 
-    acl_entry = ops_xp_cls_lookup_from_hmap_type(list_id,
-                                                 classifier_hmap);
+    /* HW counters are harvested by ops_xp_cls_stats_handler(), so only
+     * SW counters are read here */
+    ovs_mutex_lock(&cls_mutex);
+
+    acl_entry = ops_xp_cls_lookup(list_id, acl_type);
     
-    if (acl_entry) {
+    if (acl_entry && (num_entries + 1 == acl_entry->num_rules)) {
         
-        int i = 0;
-        ovslist = &acl_entry->rule_list;
-        
-        if (num_entries+1 != acl_entry->num_rules) {
-            /* update status and return */
-            return 0;
-        }
+        int prev_idx = -1;
 
-        VLOG_DBG("acl_id %d exists in HMAP for this UUID %d",
-                 acl_entry->acl_id, *list_id);
+        VLOG_DBG("acl_id %d exists in registry for this UUID "UUID_FMT,
+                 acl_entry->acl_id, UUID_ARGS(list_id));
 
-        /* Print TCAM manager rule ids for debugging purpose */
-        LIST_FOR_EACH_SAFE (entry, next_entry, list_node, ovslist) {
-            
-            xpsTcamMgrTcamIdFromEntryGet(0, 0, entry->rule_id, &tcamId);
-            count_pkts = 0;
-            count_bytes = 0;
-            
-            if ((i != num_entries) && entry->counter_en) {
-
-                xpsAcmGetCounterValue(devId, client, tcamId, &count_pkts, &count_bytes);
-                entry->count += count_pkts;
-                statistics[i].stats_enabled = 1;
-                statistics[i].hitcounts = entry->count;
+        LIST_FOR_EACH (entry, list_node, &acl_entry->rule_list) {
+            int i = acl_entry->ace_map[entry->ace_idx];
 
-                VLOG_DBG("count for rule entry %d, tcam manger rule id :%d, HWTCAM id :%d is %d",
-                         i, entry->rule_id, tcamId, entry->count);
+            if ((i < num_entries) && entry->counter_en) {
+                /* Hit count of an entry is the sum of its rows */
+                if (i != prev_idx) {
+                    statistics[i].hitcounts = 0;
+                    prev_idx = i;
+                }
+                statistics[i].stats_enabled = 1;
+                statistics[i].hitcounts += entry->count;
 
+                VLOG_DBG("count for rule entry %d, tcam manger rule id :%d is %"PRIu64,
+                         i, entry->rule_id, entry->count);
             }
-
-            i++;
         }
-
     }
 
+    ovs_mutex_unlock(&cls_mutex);
+
     return 0;
 }
 
@@ -1593,14 +2782,8 @@ ops_xp_cls_stats_clear(const struct uuid *list_id, const char *list_name,
 {
     xpAclType_e         acl_type;
     xpAcmClient_e       client;
-    xpsDevice_t         devId;
-    struct hmap         *classifier_hmap;
-    uint8_t             invalid_iacl_type;
     struct xp_acl_entry *acl_entry;
-    struct ovs_list     *ovslist;
-    struct xp_acl_rule  *entry, *next_entry;
-    uint32_t            tcamId;
-    uint64_t            count_pkts, count_bytes;
+    struct xp_acl_rule  *entry;
 
     VLOG_DBG("%s", __FUNCTION__);
 
@@ -1610,71 +2793,29 @@ ops_xp_cls_stats_clear(const struct uuid *list_id, const char *list_name,
      * limitation
      */
 
-    devId = 0;
-    invalid_iacl_type = 0;
-
     acl_type = ops_xp_cls_get_type(interface_info, direction);
 
-    switch(acl_type) {
-    case XP_ACL_IACL0:
-        classifier_hmap = &classifier_hmap_pacl;
-        client = XP_ACM_IPACL_COUNTER;
-        break;
-
-    case XP_ACL_IACL1:
-        classifier_hmap = &classifier_hmap_bacl;
-        client = XP_ACM_IBACL_COUNTER;
-        break;
-
-    case XP_ACL_IACL2:
-        classifier_hmap = &classifier_hmap_racl;
-        client = XP_ACM_IRACL_COUNTER;
-        break;
-
-    default:
-        invalid_iacl_type = 1;
-        break;
-
-    }
-
-    if (invalid_iacl_type) {
+    if (!ops_xp_cls_counter_client(acl_type, &client)) {
         /* update status and return */
         return 0;
     }
 
-    acl_entry = ops_xp_cls_lookup_from_hmap_type(list_id,
-                                                 classifier_hmap);
-
-    if (acl_entry) {
-
-        int i = 0;
-        ovslist = &acl_entry->rule_list;
-
-        VLOG_DBG("acl_id %d exists in HMAP for this UUID %d",
-                 acl_entry->acl_id, *list_id);
-
-        /* Print TCAM manager rule ids for debugging purpose */
-        LIST_FOR_EACH_SAFE (entry, next_entry, list_node, ovslist) {
-
-            xpsTcamMgrTcamIdFromEntryGet(0, 0, entry->rule_id, &tcamId);
-            count_pkts = 0;
-            count_bytes = 0;
+    ovs_mutex_lock(&cls_mutex);
 
-            if (entry->counter_en) {
+    acl_entry = ops_xp_cls_lookup(list_id, acl_type);
 
-                /* HW counters work on clear on read basis and hence the below call clears the counter value */
-                xpsAcmGetCounterValue(devId, client, tcamId, &count_pkts, &count_bytes);
-                entry->count = 0;
+    if (acl_entry) {
 
-                VLOG_DBG("count for rule entry %d, tcam manger rule id :%d, HWTCAM id :%d is %d",
-                         i, entry->rule_id, tcamId, entry->count);
-            }
+        VLOG_DBG("acl_id %d exists in registry for this UUID "UUID_FMT,
+                 acl_entry->acl_id, UUID_ARGS(list_id));
 
-            i++;
+        LIST_FOR_EACH (entry, list_node, &acl_entry->rule_list) {
+            entry->count = 0;
         }
-
     }
 
+    ovs_mutex_unlock(&cls_mutex);
+
     return 0;
 }
 
@@ -1693,3 +2834,140 @@ ops_xp_cls_acl_log_pkt_register_cb(void (*callback_handler)(struct acl_log_info
 
     return 0;
 }
+
+static const char *
+ops_xp_cls_type_name(xpAclType_e acl_type)
+{
+    switch (acl_type) {
+    case XP_ACL_IACL0:
+        return "PACL";
+    case XP_ACL_IACL1:
+        return "BACL";
+    case XP_ACL_IACL2:
+        return "RACL";
+    case XP_ACL_EACL:
+        return "EACL";
+    default:
+        return "unknown";
+    }
+}
+
+static void
+unixctl_acl_show_sharing(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                         const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds d_str = DS_EMPTY_INITIALIZER;
+    struct xp_acl_set *acl_set;
+    struct xp_acl *acl;
+    uint32_t rows = 0;
+    uint32_t rows_v6 = 0;
+    uint32_t unshared_rows = 0;
+
+    ovs_mutex_lock(&cls_mutex);
+
+    ds_put_cstr(&d_str, "====================================================\n");
+    HMAP_FOR_EACH (acl_set, hnode, &cls_acl_sets) {
+        bool ipv6 = acl_set->list_type == OPS_CLS_ACL_V6;
+
+        ds_put_format(&d_str, "ACLID %-3d: %s, %u lists, %d entries\n",
+                      acl_set->acl_id, ipv6 ? "IPv6" : "IPv4",
+                      acl_set->ref_cnt, acl_set->num_entries);
+
+        for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+            if (!acl_set->tables[i]) {
+                continue;
+            }
+            ds_put_format(&d_str, "    %-4s : %u TCAM rows, %u interfaces\n",
+                          ops_xp_cls_type_name(i),
+                          acl_set->tables[i]->num_rows,
+                          acl_set->tables[i]->num_intfs);
+            rows += acl_set->tables[i]->num_rows;
+            if (ipv6) {
+                rows_v6 += acl_set->tables[i]->num_rows;
+            }
+        }
+    }
+
+    /* Each list would have its own rows if sets were not shared */
+    HMAP_FOR_EACH (acl, hnode, &cls_acl_registry) {
+        for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+            if (acl->num_intfs[i] && acl->acl_set->tables[i]) {
+                unshared_rows += acl->acl_set->tables[i]->num_rows;
+            }
+        }
+    }
+
+    ds_put_cstr(&d_str, "====================================================\n");
+    ds_put_format(&d_str, "Classifier lists     : %"PRIuSIZE"\n",
+                  hmap_count(&cls_acl_registry));
+    ds_put_format(&d_str, "Rule sets            : %"PRIuSIZE"\n",
+                  hmap_count(&cls_acl_sets));
+    ovs_mutex_unlock(&cls_mutex);
+
+    ds_put_format(&d_str, "TCAM rows in use     : %u\n", rows);
+    ds_put_format(&d_str, "  IPv4 keys          : %u\n", rows - rows_v6);
+    ds_put_format(&d_str, "  IPv6 keys          : %u\n", rows_v6);
+    ds_put_format(&d_str, "TCAM rows unshared   : %u\n", unshared_rows);
+    ds_put_format(&d_str, "TCAM rows saved      : %u\n",
+                  unshared_rows - rows);
+    ds_put_cstr(&d_str, "====================================================\n");
+
+    unixctl_command_reply(conn, ds_cstr(&d_str));
+    ds_destroy(&d_str);
+}
+
+static void
+unixctl_acl_tcam_usage(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                       const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds d_str = DS_EMPTY_INITIALIZER;
+
+    ds_put_cstr(&d_str, "====================================================\n");
+    for (int i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+        ds_put_format(&d_str, "Table %d : %s\n", i, ops_xp_cls_type_name(i));
+    }
+    ds_put_cstr(&d_str, "====================================================\n");
+
+    ovs_mutex_lock(&cls_mutex);
+    ops_xp_cls_tcam_format(&d_str);
+    ovs_mutex_unlock(&cls_mutex);
+
+    ds_put_cstr(&d_str, "====================================================\n");
+
+    unixctl_command_reply(conn, ds_cstr(&d_str));
+    ds_destroy(&d_str);
+}
+
+static void
+unixctl_acl_tcam_defrag(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                        const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds d_str = DS_EMPTY_INITIALIZER;
+    uint32_t n;
+
+    ovs_mutex_lock(&cls_mutex);
+    n = ops_xp_cls_defrag();
+    ovs_mutex_unlock(&cls_mutex);
+
+    ds_put_format(&d_str, "Repacked %u ACLs\n", n);
+
+    unixctl_command_reply(conn, ds_cstr(&d_str));
+    ds_destroy(&d_str);
+}
+
+void
+ops_xp_cls_unixctl_init(void)
+{
+    static bool registered;
+    if (registered) {
+        return;
+    }
+    registered = true;
+
+    unixctl_command_register("xp/acl/show-sharing", "", 0, 0,
+                             unixctl_acl_show_sharing, NULL);
+    unixctl_command_register("xp/acl/tcam-usage", "", 0, 0,
+                             unixctl_acl_tcam_usage, NULL);
+    unixctl_command_register("xp/acl/tcam-defrag", "", 0, 0,
+                             unixctl_acl_tcam_defrag, NULL);
+}
@@ -0,0 +1,589 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-cls-compile.c
+ *
+ * Purpose: This file contains compilation of OpenSwitch classifier lists
+ *          into TCAM entries for the Cavium/XPliant SDK.
+ */
+
+#include <string.h>
+#include <netinet/in.h>
+
+#include "hash.h"
+#include "util.h"
+#include "ops-xp-cls-compile.h"
+
+
+/* Match fields the compiler knows. An entry matching on any other field
+ * never covers another one and is assumed to overlap with all others. */
+#define XP_CLS_COMPILE_FIELDS   (OPS_CLS_SRC_IPADDR_VALID | \
+                                 OPS_CLS_DEST_IPADDR_VALID | \
+                                 OPS_CLS_PROTOCOL_VALID | \
+                                 OPS_CLS_TOS_VALID | \
+                                 OPS_CLS_TCP_FLAGS_VALID | \
+                                 OPS_CLS_ICMP_CODE_VALID | \
+                                 OPS_CLS_ICMP_TYPE_VALID | \
+                                 OPS_CLS_L4_SRC_PORT_VALID | \
+                                 OPS_CLS_L4_DEST_PORT_VALID | \
+                                 OPS_CLS_VLAN_VALID | \
+                                 OPS_CLS_L2_ETHERTYPE_VALID)
+
+enum xp_cls_relation {
+    XP_CLS_COVERS,              /* a matches all packets b matches */
+    XP_CLS_OVERLAPS             /* a and b match some packet in common */
+};
+
+struct xp_cls_port_range {
+    uint32_t lo;
+    uint32_t hi;
+};
+
+
+/* Relation of value/mask fields of @len bytes. Exact match fields pass
+ * NULL masks. */
+static bool
+cls_ternary_relates(enum xp_cls_relation rel,
+                    const void *a_value, const void *a_mask,
+                    const void *b_value, const void *b_mask, size_t len)
+{
+    const uint8_t *av = a_value, *am = a_mask;
+    const uint8_t *bv = b_value, *bm = b_mask;
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t a_m = am ? am[i] : 0xff;
+        uint8_t b_m = bm ? bm[i] : 0xff;
+
+        if (rel == XP_CLS_COVERS) {
+            if ((a_m & ~b_m) || ((av[i] ^ bv[i]) & a_m)) {
+                return false;
+            }
+        } else if ((av[i] ^ bv[i]) & a_m & b_m) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Relation of a single field @flag given the relation of its values
+ * when both entries match on it. */
+static bool
+cls_field_relates(enum xp_cls_relation rel, uint32_t a_flags,
+                  uint32_t b_flags, uint32_t flag, bool related)
+{
+    if (rel == XP_CLS_COVERS) {
+        return !(a_flags & flag) || ((b_flags & flag) && related);
+    }
+
+    return !(a_flags & b_flags & flag) || related;
+}
+
+/* Port ranges an L4 port match stands for, following
+ * ops_xp_cls_l4_port_expand(). */
+static size_t
+cls_port_ranges(bool valid, int op, uint16_t min, uint16_t max,
+                struct xp_cls_port_range *ranges)
+{
+    size_t n = 0;
+
+    if (!valid) {
+        ranges[n++] = (struct xp_cls_port_range) { 0, UINT16_MAX };
+        return n;
+    }
+
+    switch (op) {
+    case OPS_CLS_L4_PORT_OP_NEQ:
+        if (min > 0) {
+            ranges[n++] = (struct xp_cls_port_range) { 0, min - 1 };
+        }
+        if (min < UINT16_MAX) {
+            ranges[n++] = (struct xp_cls_port_range) { min + 1, UINT16_MAX };
+        }
+        break;
+
+    case OPS_CLS_L4_PORT_OP_LT:
+        ranges[n++] = (struct xp_cls_port_range) { 0, max };
+        break;
+
+    case OPS_CLS_L4_PORT_OP_GT:
+        ranges[n++] = (struct xp_cls_port_range) { min, UINT16_MAX };
+        break;
+
+    case OPS_CLS_L4_PORT_OP_RANGE:
+        ranges[n++] = (struct xp_cls_port_range) { min, max };
+        break;
+
+    default:
+        ranges[n++] = (struct xp_cls_port_range) { min, min };
+        break;
+    }
+
+    return n;
+}
+
+static bool
+cls_ports_relate(enum xp_cls_relation rel,
+                 const struct xp_cls_port_range *a, size_t n_a,
+                 const struct xp_cls_port_range *b, size_t n_b)
+{
+    for (size_t j = 0; j < n_b; j++) {
+        bool found = false;
+
+        for (size_t i = 0; i < n_a && !found; i++) {
+            if (rel == XP_CLS_COVERS) {
+                found = a[i].lo <= b[j].lo && b[j].hi <= a[i].hi;
+            } else {
+                found = a[i].lo <= b[j].hi && b[j].lo <= a[i].hi;
+            }
+        }
+
+        if (rel == XP_CLS_COVERS && !found) {
+            return false;
+        } else if (rel == XP_CLS_OVERLAPS && found) {
+            return true;
+        }
+    }
+
+    return rel == XP_CLS_COVERS;
+}
+
+/* Checks whether match of entry @a relates to the match of entry @b as
+ * @rel says. @addr_len is the length of IP addresses of the list. */
+static bool
+cls_entry_relates(enum xp_cls_relation rel,
+                  const struct ops_cls_list_entry *a,
+                  const struct ops_cls_list_entry *b, size_t addr_len)
+{
+    uint32_t fa = a->entry_fields.entry_flags;
+    uint32_t fb = b->entry_fields.entry_flags;
+    struct xp_cls_port_range a_ports[2], b_ports[2];
+    size_t n_a, n_b;
+
+    if ((fa | (rel == XP_CLS_OVERLAPS ? fb : 0)) & ~XP_CLS_COMPILE_FIELDS) {
+        return rel == XP_CLS_OVERLAPS;
+    }
+
+    if (!cls_field_relates(rel, fa, fb, OPS_CLS_SRC_IPADDR_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.src_ip_address,
+                                &a->entry_fields.src_ip_address_mask,
+                                &b->entry_fields.src_ip_address,
+                                &b->entry_fields.src_ip_address_mask,
+                                addr_len)) ||
+        !cls_field_relates(rel, fa, fb, OPS_CLS_DEST_IPADDR_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.dst_ip_address,
+                                &a->entry_fields.dst_ip_address_mask,
+                                &b->entry_fields.dst_ip_address,
+                                &b->entry_fields.dst_ip_address_mask,
+                                addr_len)) ||
+        !cls_field_relates(rel, fa, fb, OPS_CLS_PROTOCOL_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.protocol, NULL,
+                                &b->entry_fields.protocol, NULL,
+                                sizeof(a->entry_fields.protocol))) ||
+        !cls_field_relates(rel, fa, fb, OPS_CLS_TOS_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.tos,
+                                &a->entry_fields.tos_mask,
+                                &b->entry_fields.tos,
+                                &b->entry_fields.tos_mask,
+                                sizeof(a->entry_fields.tos))) ||
+        !cls_field_relates(rel, fa, fb, OPS_CLS_TCP_FLAGS_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.tcp_flags,
+                                &a->entry_fields.tcp_flags_mask,
+                                &b->entry_fields.tcp_flags,
+                                &b->entry_fields.tcp_flags_mask,
+                                sizeof(a->entry_fields.tcp_flags))) ||
+        !cls_field_relates(rel, fa, fb, OPS_CLS_ICMP_CODE_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.icmp_code, NULL,
+                                &b->entry_fields.icmp_code, NULL,
+                                sizeof(a->entry_fields.icmp_code))) ||
+        !cls_field_relates(rel, fa, fb, OPS_CLS_ICMP_TYPE_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.icmp_type, NULL,
+                                &b->entry_fields.icmp_type, NULL,
+                                sizeof(a->entry_fields.icmp_type))) ||
+        !cls_field_relates(rel, fa, fb, OPS_CLS_VLAN_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.vlan, NULL,
+                                &b->entry_fields.vlan, NULL,
+                                sizeof(a->entry_fields.vlan))) ||
+        !cls_field_relates(rel, fa, fb, OPS_CLS_L2_ETHERTYPE_VALID,
+            cls_ternary_relates(rel, &a->entry_fields.L2_ethertype, NULL,
+                                &b->entry_fields.L2_ethertype, NULL,
+                                sizeof(a->entry_fields.L2_ethertype)))) {
+        return false;
+    }
+
+    n_a = cls_port_ranges(fa & OPS_CLS_L4_SRC_PORT_VALID,
+                          a->entry_fields.L4_src_port_op,
+                          a->entry_fields.L4_src_port_min,
+                          a->entry_fields.L4_src_port_max, a_ports);
+    n_b = cls_port_ranges(fb & OPS_CLS_L4_SRC_PORT_VALID,
+                          b->entry_fields.L4_src_port_op,
+                          b->entry_fields.L4_src_port_min,
+                          b->entry_fields.L4_src_port_max, b_ports);
+    if (!cls_ports_relate(rel, a_ports, n_a, b_ports, n_b)) {
+        return false;
+    }
+
+    n_a = cls_port_ranges(fa & OPS_CLS_L4_DEST_PORT_VALID,
+                          a->entry_fields.L4_dst_port_op,
+                          a->entry_fields.L4_dst_port_min,
+                          a->entry_fields.L4_dst_port_max, a_ports);
+    n_b = cls_port_ranges(fb & OPS_CLS_L4_DEST_PORT_VALID,
+                          b->entry_fields.L4_dst_port_op,
+                          b->entry_fields.L4_dst_port_min,
+                          b->entry_fields.L4_dst_port_max, b_ports);
+
+    return cls_ports_relate(rel, a_ports, n_a, b_ports, n_b);
+}
+
+static bool
+cls_entry_counted(const struct ops_cls_list_entry *entry)
+{
+    return entry->entry_actions.action_flags & OPS_CLS_ACTION_COUNT;
+}
+
+static bool
+cls_actions_equal(const struct ops_cls_list_entry *a,
+                  const struct ops_cls_list_entry *b)
+{
+    return !memcmp(&a->entry_actions, &b->entry_actions,
+                   sizeof(a->entry_actions));
+}
+
+/* Merges @b into @a if @a and @b only differ in a single bit of the
+ * masked SRC or DST IP address. Returns true if merged. */
+static bool
+cls_entry_merge(struct ops_cls_list_entry *a,
+                const struct ops_cls_list_entry *b, size_t addr_len)
+{
+    struct ops_cls_list_entry tmp;
+    uint32_t flags = a->entry_fields.entry_flags;
+
+    if (cls_entry_counted(a) || cls_entry_counted(b)) {
+        return false;
+    }
+
+    for (int src = 1; src >= 0; src--) {
+        uint8_t *av, *am;
+        const uint8_t *bv, *bm;
+        size_t bit_byte = 0;
+        uint8_t bit = 0;
+        int n_bits = 0;
+
+        if (!(flags & (src ? OPS_CLS_SRC_IPADDR_VALID
+                           : OPS_CLS_DEST_IPADDR_VALID))) {
+            continue;
+        }
+
+        av = src ? (uint8_t *) &a->entry_fields.src_ip_address
+                 : (uint8_t *) &a->entry_fields.dst_ip_address;
+        am = src ? (uint8_t *) &a->entry_fields.src_ip_address_mask
+                 : (uint8_t *) &a->entry_fields.dst_ip_address_mask;
+        bv = src ? (const uint8_t *) &b->entry_fields.src_ip_address
+                 : (const uint8_t *) &b->entry_fields.dst_ip_address;
+        bm = src ? (const uint8_t *) &b->entry_fields.src_ip_address_mask
+                 : (const uint8_t *) &b->entry_fields.dst_ip_address_mask;
+
+        if (memcmp(am, bm, addr_len)) {
+            continue;
+        }
+
+        for (size_t i = 0; i < addr_len && n_bits < 2; i++) {
+            uint8_t diff = (av[i] ^ bv[i]) & am[i];
+
+            if (diff) {
+                n_bits += (diff & (diff - 1)) ? 2 : 1;
+                bit_byte = i;
+                bit = diff;
+            }
+        }
+
+        if (n_bits != 1) {
+            continue;
+        }
+
+        /* Everything else, including unmasked bits, must be equal */
+        memcpy(&tmp, b, sizeof(tmp));
+        memcpy(src ? (uint8_t *) &tmp.entry_fields.src_ip_address
+                   : (uint8_t *) &tmp.entry_fields.dst_ip_address,
+               av, addr_len);
+        if (memcmp(&tmp, a, sizeof(tmp))) {
+            continue;
+        }
+
+        av[bit_byte] &= ~bit;
+        am[bit_byte] &= ~bit;
+        return true;
+    }
+
+    return false;
+}
+
+static void
+cls_compiled_copy(struct xp_cls_compiled *comp, uint32_t dst, uint32_t src)
+{
+    if (dst != src) {
+        memcpy(&comp->entries[dst], &comp->entries[src],
+               sizeof(comp->entries[dst]));
+        comp->ace_idx[dst] = comp->ace_idx[src];
+    }
+}
+
+/* Drops entries covered by an earlier entry. Those never match. */
+static void
+cls_compile_shadowed(struct xp_cls_compiled *comp, size_t addr_len)
+{
+    uint32_t i, j, k;
+
+    for (j = 0, k = 0; j < comp->n; j++) {
+        bool shadowed = false;
+
+        for (i = 0; i < k && !cls_entry_counted(&comp->entries[j]); i++) {
+            if (cls_entry_relates(XP_CLS_COVERS, &comp->entries[i],
+                                  &comp->entries[j], addr_len)) {
+                shadowed = true;
+                break;
+            }
+        }
+
+        if (shadowed) {
+            comp->n_shadowed++;
+            continue;
+        }
+
+        cls_compiled_copy(comp, k++, j);
+    }
+
+    comp->n = k;
+}
+
+/* Drops entries with the action of a trailing match-all entry, if no
+ * entry with another action overlaps them before the match-all one. */
+static void
+cls_compile_redundant(struct xp_cls_compiled *comp, size_t addr_len)
+{
+    const struct ops_cls_list_entry *last;
+    uint32_t n = comp->n;
+    uint32_t i, j, k;
+    bool *drop;
+
+    if (n < 2) {
+        return;
+    }
+
+    last = &comp->entries[n - 1];
+    if (last->entry_fields.entry_flags) {
+        return;
+    }
+
+    drop = xcalloc(n, sizeof(*drop));
+
+    for (j = 0; j < n - 1; j++) {
+        const struct ops_cls_list_entry *entry = &comp->entries[j];
+
+        if (cls_entry_counted(entry) || !cls_actions_equal(entry, last)) {
+            continue;
+        }
+
+        drop[j] = true;
+        for (i = j + 1; i < n - 1; i++) {
+            if (!cls_actions_equal(&comp->entries[i], last) &&
+                cls_entry_relates(XP_CLS_OVERLAPS, entry,
+                                  &comp->entries[i], addr_len)) {
+                drop[j] = false;
+                break;
+            }
+        }
+    }
+
+    for (j = 0, k = 0; j < n; j++) {
+        if (drop[j]) {
+            comp->n_redundant++;
+            continue;
+        }
+        cls_compiled_copy(comp, k++, j);
+    }
+    comp->n = k;
+
+    free(drop);
+}
+
+/* Merges adjacent entries which differ in a single address bit until
+ * no more entries can be merged. */
+static void
+cls_compile_merge(struct xp_cls_compiled *comp, size_t addr_len)
+{
+    uint32_t j, k;
+    bool merged;
+
+    do {
+        merged = false;
+
+        for (j = 0, k = 0; j < comp->n; j++) {
+            if (k && cls_entry_merge(&comp->entries[k - 1],
+                                     &comp->entries[j], addr_len)) {
+                comp->n_merged++;
+                merged = true;
+                continue;
+            }
+            cls_compiled_copy(comp, k++, j);
+        }
+
+        comp->n = k;
+    } while (merged);
+}
+
+/* Appends @len bytes of @value to the entry key at @ofs */
+static size_t
+cls_key_put(uint8_t *key, size_t ofs, const void *value, size_t len)
+{
+    memcpy(&key[ofs], value, len);
+    return ofs + len;
+}
+
+/* Packs entry flags, actions and the fields @entry matches on into @key,
+ * which is at least as large as the entry. Fields the entry does not
+ * match on and padding are left out, so entries programmed the same way
+ * have the same key. Returns the length of the key. */
+static size_t
+cls_entry_key(const struct ops_cls_list_entry *entry,
+              enum ops_cls_type list_type, uint8_t *key)
+{
+    const struct ops_cls_list_entry_match_fields *f = &entry->entry_fields;
+    size_t addr_len = list_type == OPS_CLS_ACL_V6
+                      ? sizeof(struct in6_addr) : sizeof(struct in_addr);
+    uint32_t flags = f->entry_flags;
+    size_t n = 0;
+
+    n = cls_key_put(key, n, &f->entry_flags, sizeof f->entry_flags);
+    n = cls_key_put(key, n, &entry->entry_actions.action_flags,
+                    sizeof entry->entry_actions.action_flags);
+
+    if (flags & OPS_CLS_SRC_IPADDR_VALID) {
+        n = cls_key_put(key, n, &f->src_ip_address, addr_len);
+        n = cls_key_put(key, n, &f->src_ip_address_mask, addr_len);
+    }
+    if (flags & OPS_CLS_DEST_IPADDR_VALID) {
+        n = cls_key_put(key, n, &f->dst_ip_address, addr_len);
+        n = cls_key_put(key, n, &f->dst_ip_address_mask, addr_len);
+    }
+    if (flags & OPS_CLS_PROTOCOL_VALID) {
+        n = cls_key_put(key, n, &f->protocol, sizeof f->protocol);
+    }
+    if (flags & OPS_CLS_TOS_VALID) {
+        n = cls_key_put(key, n, &f->tos, sizeof f->tos);
+        n = cls_key_put(key, n, &f->tos_mask, sizeof f->tos_mask);
+    }
+    if (flags & OPS_CLS_TCP_FLAGS_VALID) {
+        n = cls_key_put(key, n, &f->tcp_flags, sizeof f->tcp_flags);
+        n = cls_key_put(key, n, &f->tcp_flags_mask, sizeof f->tcp_flags_mask);
+    }
+    if (flags & OPS_CLS_ICMP_CODE_VALID) {
+        n = cls_key_put(key, n, &f->icmp_code, sizeof f->icmp_code);
+    }
+    if (flags & OPS_CLS_ICMP_TYPE_VALID) {
+        n = cls_key_put(key, n, &f->icmp_type, sizeof f->icmp_type);
+    }
+    if (flags & OPS_CLS_L4_SRC_PORT_VALID) {
+        n = cls_key_put(key, n, &f->L4_src_port_op, sizeof f->L4_src_port_op);
+        n = cls_key_put(key, n, &f->L4_src_port_min,
+                        sizeof f->L4_src_port_min);
+        n = cls_key_put(key, n, &f->L4_src_port_max,
+                        sizeof f->L4_src_port_max);
+    }
+    if (flags & OPS_CLS_L4_DEST_PORT_VALID) {
+        n = cls_key_put(key, n, &f->L4_dst_port_op, sizeof f->L4_dst_port_op);
+        n = cls_key_put(key, n, &f->L4_dst_port_min,
+                        sizeof f->L4_dst_port_min);
+        n = cls_key_put(key, n, &f->L4_dst_port_max,
+                        sizeof f->L4_dst_port_max);
+    }
+    if (flags & OPS_CLS_VLAN_VALID) {
+        n = cls_key_put(key, n, &f->vlan, sizeof f->vlan);
+    }
+    if (flags & OPS_CLS_L2_ETHERTYPE_VALID) {
+        n = cls_key_put(key, n, &f->L2_ethertype, sizeof f->L2_ethertype);
+    }
+
+    return n;
+}
+
+/* Hash of @entry of a list of @list_type, field by field */
+uint32_t
+ops_xp_cls_entry_hash(const struct ops_cls_list_entry *entry,
+                      enum ops_cls_type list_type, uint32_t basis)
+{
+    uint8_t key[sizeof *entry];
+    size_t len;
+
+    len = cls_entry_key(entry, list_type, key);
+
+    return hash_bytes(key, len, basis);
+}
+
+/* Whether @a and @b of a list of @list_type are programmed the same way,
+ * compared field by field */
+bool
+ops_xp_cls_entry_equal(const struct ops_cls_list_entry *a,
+                       const struct ops_cls_list_entry *b,
+                       enum ops_cls_type list_type)
+{
+    uint8_t a_key[sizeof *a], b_key[sizeof *b];
+    size_t a_len, b_len;
+
+    a_len = cls_entry_key(a, list_type, a_key);
+    b_len = cls_entry_key(b, list_type, b_key);
+
+    return a_len == b_len && !memcmp(a_key, b_key, a_len);
+}
+
+/* Compiles entries of @list into @comp. Release @comp with
+ * ops_xp_cls_compiled_destroy(). */
+void
+ops_xp_cls_compile(const struct ops_cls_list *list,
+                   struct xp_cls_compiled *comp)
+{
+    size_t addr_len = list->list_type == OPS_CLS_ACL_V6
+                      ? sizeof(struct in6_addr) : sizeof(struct in_addr);
+
+    memset(comp, 0, sizeof(*comp));
+    comp->n = list->num_entries;
+    comp->n_list = list->num_entries;
+
+    if (!comp->n) {
+        return;
+    }
+
+    comp->entries = xmemdup(list->entries,
+                            comp->n * sizeof(struct ops_cls_list_entry));
+    comp->ace_idx = xmalloc(comp->n * sizeof(*comp->ace_idx));
+    for (uint32_t i = 0; i < comp->n; i++) {
+        comp->ace_idx[i] = i;
+    }
+
+    cls_compile_shadowed(comp, addr_len);
+    cls_compile_redundant(comp, addr_len);
+    cls_compile_merge(comp, addr_len);
+}
+
+void
+ops_xp_cls_compiled_destroy(struct xp_cls_compiled *comp)
+{
+    free(comp->entries);
+    free(comp->ace_idx);
+    comp->entries = NULL;
+    comp->ace_idx = NULL;
+    comp->n = 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-cls-tcam.c
+ *
+ * Purpose: This file contains TCAM space management of OpenSwitch
+ *          classifier tables for the Cavium/XPliant SDK.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "openvswitch/vlog.h"
+#include "util.h"
+#include "openXpsTcamMgr.h"
+#include "ops-xp-cls-tcam.h"
+
+
+VLOG_DEFINE_THIS_MODULE(xp_cls_tcam);
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+/* Priorities blocks are carved from */
+#define XP_CLS_TCAM_PRIORITY_MAX    0x40000000
+
+/* Rows reserved on top of the rows an ACL needs, so it can grow without
+ * being moved to another block */
+#define XP_CLS_TCAM_HEADROOM_MIN    4
+
+/* Space accounting of an ACL table */
+struct xp_cls_tcam_table {
+    uint32_t        size;       /* Rows in the table. 0 if not configured */
+    uint32_t        used;       /* Rows allocated from TCAM manager */
+    uint32_t        peak;       /* Highest number of used rows */
+    uint32_t        reserved;   /* Rows reserved by blocks */
+    struct ovs_list blocks;     /* Reserved blocks by base priority */
+    uint32_t        n_blocks;
+    uint64_t        moves;      /* Rows moved by TCAM manager */
+    uint64_t        failures;   /* Failed row allocations */
+    uint64_t        defrags;    /* ACLs repacked into new blocks */
+};
+
+static struct xp_cls_tcam_table cls_tcam_tables[XP_ACML_TOTAL_TYPE];
+
+
+static struct xp_cls_tcam_table *
+cls_tcam_table(uint32_t tableId)
+{
+    if (tableId >= XP_ACML_TOTAL_TYPE || !cls_tcam_tables[tableId].size) {
+        return NULL;
+    }
+    return &cls_tcam_tables[tableId];
+}
+
+/* Rule move callback of TCAM manager. Counts the moves. */
+static XP_STATUS
+cls_tcam_rule_move(xpsDevice_t devId, uint32_t tableId,
+                   uint32_t currentIndex, uint32_t newIndex)
+{
+    struct xp_cls_tcam_table *table = cls_tcam_table(tableId);
+
+    if (table) {
+        table->moves++;
+    }
+
+    return xpsTcamMgrRuleMoveAcl(devId, tableId, currentIndex, newIndex);
+}
+
+/* Adds ACL table @tableId of @size rows into TCAM manager. */
+void
+ops_xp_cls_tcam_table_init(xpsDevice_t devId, uint32_t tableId,
+                           uint32_t size)
+{
+    struct xp_cls_tcam_table *table;
+    XP_STATUS status;
+
+    ovs_assert(tableId < XP_ACML_TOTAL_TYPE);
+
+    status = xpsTcamMgrAddTable(devId, tableId, XPS_TCAM_LIST_ALGORITHM);
+    if (status != XP_NO_ERR) {
+        VLOG_INFO("xpsTcamMgrAddTable failed with error code %d, "
+                  "for table type %u", status, tableId);
+    }
+
+    status = xpsTcamMgrConfigTable(devId, tableId, &cls_tcam_rule_move,
+                                   size, 16);
+    if (status != XP_NO_ERR) {
+        VLOG_INFO("xpsTcamMgrConfigTable failed with error code %d, "
+                  "for table type %u", status, tableId);
+    }
+
+    table = &cls_tcam_tables[tableId];
+    memset(table, 0, sizeof(*table));
+    table->size = size;
+    list_init(&table->blocks);
+}
+
+/* Reserves a block for an ACL of @n_rows rows whose entries are @step
+ * priorities apart. Some headroom is reserved on top if the table has
+ * room for it. Returns NULL if the table can not hold @n_rows more. */
+struct xp_cls_tcam_block *
+ops_xp_cls_tcam_block_alloc(uint32_t tableId, uint32_t n_rows, uint32_t step)
+{
+    struct xp_cls_tcam_table *table = cls_tcam_table(tableId);
+    struct xp_cls_tcam_block *block, *next;
+    uint32_t avail, rows, span, base;
+
+    if (!table) {
+        return NULL;
+    }
+
+    avail = table->size - table->reserved;
+    if (n_rows > avail) {
+        VLOG_WARN_RL(&rl, "Table %u has %u free rows, %u requested",
+                     tableId, avail, n_rows);
+        return NULL;
+    }
+
+    rows = MIN(n_rows + MAX(n_rows / 4, XP_CLS_TCAM_HEADROOM_MIN), avail);
+    span = (rows + 1) * step;
+
+    /* First fit */
+    base = 1;
+    LIST_FOR_EACH (next, list_node, &table->blocks) {
+        if (next->base - base >= span) {
+            break;
+        }
+        base = next->base + next->span;
+    }
+
+    if (base + span > XP_CLS_TCAM_PRIORITY_MAX) {
+        VLOG_WARN_RL(&rl, "No priority block of %u for table %u",
+                     span, tableId);
+        return NULL;
+    }
+
+    block = xzalloc(sizeof(*block));
+    block->base = base;
+    block->span = span;
+    block->rows = rows;
+    list_insert(&next->list_node, &block->list_node);
+
+    table->reserved += rows;
+    table->n_blocks++;
+
+    return block;
+}
+
+void
+ops_xp_cls_tcam_block_free(uint32_t tableId, struct xp_cls_tcam_block *block)
+{
+    struct xp_cls_tcam_table *table = cls_tcam_table(tableId);
+
+    if (!table || !block) {
+        return;
+    }
+
+    list_remove(&block->list_node);
+    table->reserved -= block->rows;
+    table->n_blocks--;
+    free(block);
+}
+
+/* Hands rows reserved by @block back to table @tableId while its
+ * priorities stay taken, so an ACL being moved to a new block holds a
+ * single reservation. Returns the number of released rows. */
+uint32_t
+ops_xp_cls_tcam_block_release(uint32_t tableId,
+                              struct xp_cls_tcam_block *block)
+{
+    struct xp_cls_tcam_table *table = cls_tcam_table(tableId);
+    uint32_t rows;
+
+    if (!table || !block) {
+        return 0;
+    }
+
+    rows = block->rows;
+    table->reserved -= rows;
+    block->rows = 0;
+
+    return rows;
+}
+
+/* Reserves @rows released by ops_xp_cls_tcam_block_release() for @block
+ * again. */
+void
+ops_xp_cls_tcam_block_reclaim(uint32_t tableId,
+                              struct xp_cls_tcam_block *block, uint32_t rows)
+{
+    struct xp_cls_tcam_table *table = cls_tcam_table(tableId);
+
+    if (!table || !block) {
+        return;
+    }
+
+    table->reserved += rows;
+    block->rows += rows;
+}
+
+XP_STATUS
+ops_xp_cls_tcam_entry_alloc(xpsDevice_t devId, uint32_t tableId,
+                            uint32_t priority, uint32_t *rule_id)
+{
+    struct xp_cls_tcam_table *table = cls_tcam_table(tableId);
+    XP_STATUS status;
+
+    status = xpsTcamMgrAllocEntry(devId, tableId, priority, rule_id);
+
+    if (table) {
+        if (status == XP_NO_ERR) {
+            table->used++;
+            table->peak = MAX(table->peak, table->used);
+        } else {
+            table->failures++;
+        }
+    }
+
+    return status;
+}
+
+void
+ops_xp_cls_tcam_entry_free(xpsDevice_t devId, uint32_t tableId,
+                           uint32_t rule_id)
+{
+    struct xp_cls_tcam_table *table = cls_tcam_table(tableId);
+
+    if (xpsTcamMgrFreeEntry(devId, tableId, rule_id) == XP_NO_ERR && table) {
+        table->used--;
+    }
+}
+
+/* Accounts an ACL repacked into a new block of table @tableId. */
+void
+ops_xp_cls_tcam_defragmented(uint32_t tableId)
+{
+    struct xp_cls_tcam_table *table = cls_tcam_table(tableId);
+
+    if (table) {
+        table->defrags++;
+    }
+}
+
+void
+ops_xp_cls_tcam_format(struct ds *ds)
+{
+    ds_put_format(ds, "%-6s%-6s%-6s%-6s%-10s%-6s%-8s%-10s%-10s%-8s\n",
+                  "Table", "Size", "Used", "Peak", "Reserved", "Free",
+                  "Blocks", "Moves", "Failures", "Defrags");
+
+    for (uint32_t i = 0; i < XP_ACML_TOTAL_TYPE; i++) {
+        struct xp_cls_tcam_table *table = cls_tcam_table(i);
+
+        if (!table) {
+            continue;
+        }
+
+        ds_put_format(ds, "%-6u%-6u%-6u%-6u%-10u%-6u%-8u%-10"PRIu64
+                      "%-10"PRIu64"%-8"PRIu64"\n",
+                      i, table->size, table->used, table->peak,
+                      table->reserved, table->size - table->used,
+                      table->n_blocks, table->moves, table->failures,
+                      table->defrags);
+    }
+}
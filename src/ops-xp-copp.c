@@ -20,18 +20,264 @@
  *          application code for the Cavium/XPliant SDK.
  */
 
+#include <config.h>
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
+#include <string.h>
 #include <unistd.h>
+#include <netinet/in.h>
 #include "openvswitch/vlog.h"
+#include "dynamic-string.h"
+#include "ovs-thread.h"
+#include "packets.h"
+#include "token-bucket.h"
+#include "unixctl.h"
+#include "util.h"
 #include "ops-xp-copp.h"
+#include "ops-xp-dev.h"
+#include "ops-xp-util.h"
 
 /*
  * Logging module for CoPP.
  */
 VLOG_DEFINE_THIS_MODULE(xp_copp);
 
+/* Buckets count packets in thousandths, so a rate in packets per second
+ * is the number of tokens added per millisecond. */
+#define XP_COPP_TOKENS_PER_PKT      1000
+
+/* Default limit of packets trapped from a single port */
+#define XP_COPP_PORT_RATE           5000
+#define XP_COPP_PORT_BURST          500
+
+#define XP_COPP_ETH_TYPE_LLDP       0x88CC
+#define XP_COPP_IPPROTO_OSPF        89
+#define XP_COPP_BGP_PORT            179
+#define XP_COPP_DHCP_SERVER_PORT    67
+#define XP_COPP_DHCP_CLIENT_PORT    68
+#define XP_COPP_DHCPV6_CLIENT_PORT  546
+#define XP_COPP_DHCPV6_SERVER_PORT  547
+
+/* Rate in packets per second and burst in packets of a policer. */
+struct xp_copp_rate {
+    const char *name;
+    unsigned int rate;
+    unsigned int burst;
+};
+
+/* Policers of classes told apart in software. Trapped packets do not
+ * carry the reason code, so sFlow samples, logged packets and snooped
+ * ARP fall into the classes of their headers. */
+static struct xp_copp_rate copp_rates[COPP_NUM_CLASSES] = {
+    [COPP_STP_BPDU]             = { "stp",          1000,   100 },
+    [COPP_LACP]                 = { "lacp",         1000,   100 },
+    [COPP_LLDP]                 = { "lldp",         500,    50 },
+    [COPP_ARP_BROADCAST]        = { "arp-bcast",    1000,   200 },
+    [COPP_ARP_MY_UNICAST]       = { "arp-ucast",    1000,   200 },
+    [COPP_BGP]                  = { "bgp",          5000,   500 },
+    [COPP_OSPFv2_MULTICAST]     = { "ospf-mcast",   5000,   500 },
+    [COPP_OSPFv2_UNICAST]       = { "ospf-ucast",   5000,   500 },
+    [COPP_DHCPv4]               = { "dhcp",         500,    100 },
+    [COPP_DHCPv6]               = { "dhcpv6",       500,    100 },
+    [COPP_ICMPv4_MULTIDEST]     = { "icmp-mcast",   1000,   100 },
+    [COPP_ICMPv4_UNICAST]       = { "icmp-ucast",   1000,   100 },
+    [COPP_ICMPv6_MULTICAST]     = { "icmpv6-mcast", 1000,   200 },
+    [COPP_ICMPv6_UNICAST]       = { "icmpv6-ucast", 1000,   100 },
+    [COPP_IPv4_OPTIONS]         = { "ipv4-options", 250,    50 },
+    [COPP_IPv6_OPTIONS]         = { "ipv6-options", 250,    50 },
+    [COPP_UNKNOWN_IP_UNICAST]   = { "ip-ucast",     1000,   200 },
+    [COPP_DEFAULT_UNKNOWN]      = { "default",      500,    100 },
+};
+
+static struct xp_copp_rate copp_port_rate = {
+    "port", XP_COPP_PORT_RATE, XP_COPP_PORT_BURST
+};
+
+/* Software policers of packets trapped to CPU by a device. */
+struct xp_copp_dev {
+    struct token_bucket class_tb[COPP_NUM_CLASSES];
+    struct copp_protocol_stats stats[COPP_NUM_CLASSES];
+    struct token_bucket port_tb[XP_MAX_TOTAL_PORTS];
+    uint64_t port_drops[XP_MAX_TOTAL_PORTS];
+};
+
+static struct ovs_mutex copp_mutex = OVS_MUTEX_INITIALIZER;
+
+/* Policers by device, allocated on the first trapped packet. */
+static struct xp_copp_dev *copp_devs[XP_MAX_DEVICES] OVS_GUARDED_BY(copp_mutex);
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+static void
+xp_copp_tb_set(struct token_bucket *tb, const struct xp_copp_rate *rate)
+{
+    token_bucket_set(tb, rate->rate, rate->burst * XP_COPP_TOKENS_PER_PKT);
+}
+
+static struct xp_copp_dev *
+xp_copp_dev_get(xpsDevice_t dev_id)
+    OVS_REQUIRES(copp_mutex)
+{
+    struct xp_copp_dev *dev = copp_devs[dev_id];
+    int i;
+
+    if (!dev) {
+        dev = xzalloc(sizeof *dev);
+        for (i = 0; i < COPP_NUM_CLASSES; i++) {
+            token_bucket_init(&dev->class_tb[i], 0, 0);
+            xp_copp_tb_set(&dev->class_tb[i], &copp_rates[i]);
+        }
+        for (i = 0; i < XP_MAX_TOTAL_PORTS; i++) {
+            token_bucket_init(&dev->port_tb[i], 0, 0);
+            xp_copp_tb_set(&dev->port_tb[i], &copp_port_rate);
+        }
+        copp_devs[dev_id] = dev;
+    }
+
+    return dev;
+}
+
+/* Returns CoPP class of the Ethernet frame of @size bytes at @pkt. */
+static enum copp_protocol_class
+xp_copp_classify(const uint8_t *pkt, size_t size)
+{
+    struct xp_pkt_hdrs hdrs;
+    bool mcast;
+
+    if (!ops_xp_pkt_parse(pkt, size, &hdrs)) {
+        return COPP_DEFAULT_UNKNOWN;
+    }
+
+    if (hdrs.link_local) {
+        switch (hdrs.eth_dst[5]) {
+        case 0x00:
+            return COPP_STP_BPDU;
+        case 0x02:
+            return COPP_LACP;
+        case 0x0E:
+            return COPP_LLDP;
+        }
+    }
+
+    switch (hdrs.eth_type) {
+    case ETH_TYPE_LACP:
+        return COPP_LACP;
+    case XP_COPP_ETH_TYPE_LLDP:
+        return COPP_LLDP;
+    case ETH_TYPE_ARP:
+        return !memcmp(hdrs.eth_dst, eth_addr_broadcast.ea, ETH_ADDR_LEN)
+               ? COPP_ARP_BROADCAST : COPP_ARP_MY_UNICAST;
+    case ETH_TYPE_IP:
+    case ETH_TYPE_IPV6:
+        break;
+    default:
+        return COPP_DEFAULT_UNKNOWN;
+    }
+
+    if (!hdrs.ip) {
+        return COPP_DEFAULT_UNKNOWN;
+    }
+
+    if (hdrs.ip_options) {
+        return hdrs.eth_type == ETH_TYPE_IP ? COPP_IPv4_OPTIONS
+                                            : COPP_IPv6_OPTIONS;
+    }
+
+    mcast = hdrs.ip_mcast;
+
+    switch (hdrs.ip_proto) {
+    case IPPROTO_ICMP:
+        return mcast ? COPP_ICMPv4_MULTIDEST : COPP_ICMPv4_UNICAST;
+    case IPPROTO_ICMPV6:
+        return mcast ? COPP_ICMPv6_MULTICAST : COPP_ICMPv6_UNICAST;
+    case XP_COPP_IPPROTO_OSPF:
+        if (hdrs.eth_type == ETH_TYPE_IP) {
+            return mcast ? COPP_OSPFv2_MULTICAST : COPP_OSPFv2_UNICAST;
+        }
+        break;
+    case IPPROTO_TCP:
+        if (hdrs.l4_ports && (hdrs.src_port == XP_COPP_BGP_PORT ||
+                              hdrs.dst_port == XP_COPP_BGP_PORT)) {
+            return COPP_BGP;
+        }
+        break;
+    case IPPROTO_UDP:
+        if (!hdrs.l4_ports) {
+            break;
+        }
+        if (hdrs.eth_type == ETH_TYPE_IP &&
+            (hdrs.dst_port == XP_COPP_DHCP_SERVER_PORT ||
+             hdrs.dst_port == XP_COPP_DHCP_CLIENT_PORT)) {
+            return COPP_DHCPv4;
+        }
+        if (hdrs.eth_type == ETH_TYPE_IPV6 &&
+            (hdrs.dst_port == XP_COPP_DHCPV6_SERVER_PORT ||
+             hdrs.dst_port == XP_COPP_DHCPV6_CLIENT_PORT)) {
+            return COPP_DHCPv6;
+        }
+        break;
+    }
+
+    return mcast ? COPP_DEFAULT_UNKNOWN : COPP_UNKNOWN_IP_UNICAST;
+}
+
+/*
+ * ops_xp_copp_police
+ *
+ * Checks packet of @size bytes at @pkt, trapped to CPU from @port of
+ * device @dev_id, against the policers of its ingress port and its class.
+ * Returns true if the packet may be passed to host interfaces. Called
+ * from the receive path once a receive queue has room for the packet, so
+ * queue drops do not consume tokens.
+ */
+bool
+ops_xp_copp_police(xpsDevice_t dev_id, xpsPort_t port,
+                   const void *pkt, uint16_t size)
+{
+    enum copp_protocol_class class;
+    struct copp_protocol_stats *stats;
+    struct xp_copp_dev *dev;
+    bool pass;
+
+    ovs_assert(dev_id < XP_MAX_DEVICES);
+
+    class = xp_copp_classify(pkt, size);
+
+    ovs_mutex_lock(&copp_mutex);
+    dev = xp_copp_dev_get(dev_id);
+    stats = &dev->stats[class];
+
+    /* Port is checked first, so a storm on one port does not use up the
+     * class budget of the others. */
+    if (port < XP_MAX_TOTAL_PORTS &&
+        !token_bucket_withdraw(&dev->port_tb[port], XP_COPP_TOKENS_PER_PKT)) {
+        dev->port_drops[port]++;
+        pass = false;
+    } else {
+        pass = token_bucket_withdraw(&dev->class_tb[class],
+                                     XP_COPP_TOKENS_PER_PKT);
+    }
+
+    if (pass) {
+        stats->packets_passed++;
+        stats->bytes_passed += size;
+    } else {
+        stats->packets_dropped++;
+        stats->bytes_dropped += size;
+    }
+    ovs_mutex_unlock(&copp_mutex);
+
+    if (!pass) {
+        VLOG_DBG_RL(&rl, "Dropping %s packet from port %u on device #%u",
+                    copp_rates[class].name, port, dev_id);
+    }
+
+    return pass;
+}
+
 /*
  * ops_xp_copp_stats_get
  *
@@ -46,6 +292,22 @@ ops_xp_copp_stats_get(const unsigned int hw_asic_id,
 {
     VLOG_DBG("%s", __FUNCTION__);
 
+    if (hw_asic_id >= XP_MAX_DEVICES || !stats) {
+        return EINVAL;
+    }
+
+    if (class >= COPP_NUM_CLASSES || !copp_rates[class].name) {
+        return EOPNOTSUPP;
+    }
+
+    memset(stats, 0, sizeof *stats);
+
+    ovs_mutex_lock(&copp_mutex);
+    if (copp_devs[hw_asic_id]) {
+        *stats = copp_devs[hw_asic_id]->stats[class];
+    }
+    ovs_mutex_unlock(&copp_mutex);
+
     return 0;
 }
 
@@ -64,5 +326,150 @@ ops_xp_copp_hw_status_get(const unsigned int hw_asic_id,
 {
     VLOG_DBG("%s", __FUNCTION__);
 
+    if (hw_asic_id >= XP_MAX_DEVICES || !hw_status) {
+        return EINVAL;
+    }
+
+    if (class >= COPP_NUM_CLASSES || !copp_rates[class].name) {
+        return EOPNOTSUPP;
+    }
+
+    /* Policing is done in software, all classes share CPU queues. */
+    memset(hw_status, 0, sizeof *hw_status);
+
+    ovs_mutex_lock(&copp_mutex);
+    hw_status->rate = copp_rates[class].rate;
+    hw_status->burst = copp_rates[class].burst;
+    ovs_mutex_unlock(&copp_mutex);
+
     return 0;
 }
+
+/* XPNET host interfaces get trapped packets in the kernel driver, which
+ * bypasses the receive path, so none of them is policed. */
+static bool
+xp_copp_unixctl_supported(struct unixctl_conn *conn)
+{
+    if (ops_xp_host_if_type_get() == XP_HOST_IF_XPNET) {
+        unixctl_command_reply_error(conn, "CPU policing is not supported "
+                                    "with XPNET host interfaces");
+        return false;
+    }
+
+    return true;
+}
+
+static void
+xp_copp_unixctl_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                     const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds d_str = DS_EMPTY_INITIALIZER;
+    int id, i;
+
+    if (!xp_copp_unixctl_supported(conn)) {
+        return;
+    }
+
+    ovs_mutex_lock(&copp_mutex);
+    for (id = 0; id < XP_MAX_DEVICES; id++) {
+        struct xp_copp_dev *dev = copp_devs[id];
+
+        if (!dev) {
+            continue;
+        }
+
+        ds_put_format(&d_str, "Device #%d\n", id);
+        ds_put_format(&d_str, "  %-14s%-8s%-7s%-16s%-16s\n", "Class",
+                      "Rate", "Burst", "Passed", "Dropped");
+        for (i = 0; i < COPP_NUM_CLASSES; i++) {
+            if (!copp_rates[i].name) {
+                continue;
+            }
+            ds_put_format(&d_str, "  %-14s%-8u%-7u%-16"PRIu64"%-16"PRIu64
+                          "\n", copp_rates[i].name, copp_rates[i].rate,
+                          copp_rates[i].burst, dev->stats[i].packets_passed,
+                          dev->stats[i].packets_dropped);
+        }
+
+        ds_put_format(&d_str, "  Port rate %u, burst %u\n",
+                      copp_port_rate.rate, copp_port_rate.burst);
+        for (i = 0; i < XP_MAX_TOTAL_PORTS; i++) {
+            if (dev->port_drops[i]) {
+                ds_put_format(&d_str, "  Port %-5d dropped %"PRIu64"\n",
+                              i, dev->port_drops[i]);
+            }
+        }
+    }
+    ovs_mutex_unlock(&copp_mutex);
+
+    unixctl_command_reply(conn, ds_cstr(&d_str));
+    ds_destroy(&d_str);
+}
+
+static void
+xp_copp_unixctl_rate(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                     const char *argv[], void *aux OVS_UNUSED)
+{
+    struct xp_copp_rate *rate = NULL;
+    unsigned int pps, burst;
+    int id, i;
+
+    if (!xp_copp_unixctl_supported(conn)) {
+        return;
+    }
+
+    if (!strcmp(argv[1], copp_port_rate.name)) {
+        rate = &copp_port_rate;
+    }
+    for (i = 0; !rate && i < COPP_NUM_CLASSES; i++) {
+        if (copp_rates[i].name && !strcmp(argv[1], copp_rates[i].name)) {
+            rate = &copp_rates[i];
+        }
+    }
+    if (!rate) {
+        unixctl_command_reply_error(conn, "Unknown class");
+        return;
+    }
+
+    if (!str_to_uint(argv[2], 10, &pps) || !str_to_uint(argv[3], 10, &burst)
+        || !burst || burst > UINT_MAX / XP_COPP_TOKENS_PER_PKT) {
+        unixctl_command_reply_error(conn, "Invalid rate or burst");
+        return;
+    }
+
+    ovs_mutex_lock(&copp_mutex);
+    rate->rate = pps;
+    rate->burst = burst;
+    for (id = 0; id < XP_MAX_DEVICES; id++) {
+        struct xp_copp_dev *dev = copp_devs[id];
+
+        if (!dev) {
+            continue;
+        }
+        if (rate == &copp_port_rate) {
+            for (i = 0; i < XP_MAX_TOTAL_PORTS; i++) {
+                xp_copp_tb_set(&dev->port_tb[i], rate);
+            }
+        } else {
+            xp_copp_tb_set(&dev->class_tb[rate - copp_rates], rate);
+        }
+    }
+    ovs_mutex_unlock(&copp_mutex);
+
+    unixctl_command_reply(conn, NULL);
+}
+
+void
+ops_xp_copp_unixctl_init(void)
+{
+    static bool registered;
+    if (registered) {
+        return;
+    }
+    registered = true;
+
+    unixctl_command_register("xp/copp/show", "", 0, 0,
+                             xp_copp_unixctl_show, NULL);
+    unixctl_command_register("xp/copp/rate", "class|port pps burst", 3, 3,
+                             xp_copp_unixctl_rate, NULL);
+}
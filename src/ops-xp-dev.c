@@ -25,6 +25,9 @@
 #endif
 
 #include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <netinet/in.h>
 
 #include "ops-xp-dev.h"
 #include "ops-xp-mac-learning.h"
@@ -44,14 +47,52 @@
 #include "openXpsMac.h"
 #include "openXpsPort.h"
 #include "openXpsVlan.h"
+#include "packets.h"
 #include "ofproto/ofproto.h"
 #include "ovs-rcu.h"
 #include "dummy.h"
+#include "dynamic-string.h"
+#include "unixctl.h"
 
 VLOG_DEFINE_THIS_MODULE(xp_dev);
 
 #define XP_CPU_PORT_NUM                 135
 
+/* Number of preallocated CPU Tx buffers per device */
+#define XP_TX_POOL_SIZE                 64
+
+/* Minimal size of a packet sent from CPU, shorter ones are zero padded */
+#define XP_TX_MIN_PKT_SIZE              64
+
+/* Number of CPU Tx queues (packet priorities). Higher queues are more
+ * urgent. */
+#define XP_TX_QUEUES                    64
+
+/* Packets waiting in a queue of the asynchronous Tx ring of a device
+ * before new ones are dropped, and packets sent per SDK lock hold */
+#define XP_TX_RING_SIZE                 256
+#define XP_TX_BATCH                     32
+
+/* Packets received from CPU port per SDK lock hold */
+#define XP_RX_BURST                     32
+
+/* Empty receive polls the Rx thread only yields the CPU for, before it
+ * starts sleeping. Sleeps double from the minimal to the maximal time
+ * while the CPU port stays idle. */
+#define XP_RX_SPIN_POLLS                64
+#define XP_RX_SLEEP_MIN_US              20
+#define XP_RX_SLEEP_MAX_US              1000
+
+/* Bursts received in a row before the Rx thread reports a quiescent
+ * state, so RCU protected data of Rx handlers can be freed */
+#define XP_RX_QUIESCE_BURSTS            64
+
+/* L4 ports of control protocols sent from CPU */
+#define XP_TX_BGP_PORT                  179
+#define XP_TX_BFD_PORT                  3784
+#define XP_TX_BFD_ECHO_PORT             3785
+#define XP_TX_BFD_MHOP_PORT             4784
+
 struct xp_if_id_to_name_entry {
     struct hmap_node hmap_node;       /* Node in if_id_to_name_map hmap. */
     char *intf_name;
@@ -79,6 +120,75 @@ XP_STATUS xpWmIpcSrvDeviceDeInitRegister(xpSimulatorDeInitFuncPtr_t);
 
 static struct ovs_mutex xpdev_mutex = OVS_MUTEX_INITIALIZER;
 
+/* CPU Tx buffers of a device along with the values every Tx header is
+ * built from. Those are cached at init, so sending needs no lookups. */
+struct xp_tx_pool {
+    struct ovs_mutex mutex;
+    struct ovs_list free OVS_GUARDED;   /* Contains "struct xp_tx_buf"s. */
+    struct xp_tx_buf *bufs;             /* Pooled buffers. */
+    uint8_t *mem;                       /* Memory of pooled buffers. */
+    xpsInterfaceId_t cpu_if_id;         /* CPU port interface ID. */
+    size_t hdr_size;                    /* Tx header size. */
+    uint64_t n_allocated OVS_GUARDED;   /* Buffers allocated while empty. */
+    bool init_done;
+};
+
+static struct xp_tx_pool xp_tx_pools[XP_MAX_DEVICES];
+
+struct xp_tx_queue_stats {
+    uint64_t sent;                      /* Packets handed to the driver. */
+    uint64_t errors;                    /* Packets the driver failed. */
+    uint64_t drops;                     /* Packets dropped on full ring. */
+};
+
+/* Asynchronous CPU Tx ring of a device. Senders queue packets and
+ * return, the Tx thread sends them in batches per SDK lock hold, most
+ * urgent queue first. */
+struct xp_tx_ring {
+    struct ovs_mutex mutex;
+    struct ovs_list pending[XP_TX_QUEUES] OVS_GUARDED;
+                                            /* Contains "struct xp_tx_buf"s. */
+    size_t n_pending[XP_TX_QUEUES] OVS_GUARDED;
+    uint64_t busy OVS_GUARDED;              /* Bitmap of non-empty queues. */
+    struct latch latch;                     /* Kicks the Tx thread. */
+    struct xp_tx_queue_stats stats[XP_TX_QUEUES] OVS_GUARDED;
+    bool enabled;
+};
+
+static struct xp_tx_ring xp_tx_rings[XP_MAX_DEVICES];
+BUILD_ASSERT_DECL(XP_TX_QUEUES <= 64);
+
+/* Classes of packets sent from CPU */
+enum xp_tx_class {
+    XP_TX_CLASS_BPDU,
+    XP_TX_CLASS_LACP,
+    XP_TX_CLASS_BFD,
+    XP_TX_CLASS_BGP,
+    XP_TX_CLASS_ARP,
+    XP_TX_CLASS_ICMP,
+    XP_TX_CLASS_DEFAULT,
+    XP_TX_CLASS_MAX
+};
+
+static const char *const xp_tx_class_names[XP_TX_CLASS_MAX] = {
+    "bpdu", "lacp", "bfd", "bgp", "arp", "icmp", "default"
+};
+
+/* Tx queue of each class. Set by "xp/dev/tx-queue-map", read on send
+ * without locking. */
+static uint8_t xp_tx_class_queue[XP_TX_CLASS_MAX] = {
+    [XP_TX_CLASS_BPDU] = 7,
+    [XP_TX_CLASS_LACP] = 7,
+    [XP_TX_CLASS_BFD] = 7,
+    [XP_TX_CLASS_BGP] = 6,
+    [XP_TX_CLASS_ARP] = 4,
+    [XP_TX_CLASS_ICMP] = 2,
+    [XP_TX_CLASS_DEFAULT] = 0,
+};
+
+/* CPU packets are sent by a Tx thread if set */
+static bool tx_async = false;
+
 
 /* This is set pretty low because we probably won't learn anything from the
  * additional log messages. */
@@ -93,6 +203,10 @@ static const struct eth_addr eth_addr_lldp OVS_UNUSED
     = { { { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x0E } } };
 
 static void *xp_dev_recv_handler(void *arg);
+static int xp_dev_tx_pool_init(xpsDevice_t id);
+static void xp_dev_tx_pool_destroy(xpsDevice_t id);
+static void xp_dev_tx_ring_init(struct xpliant_dev *dev);
+static void xp_dev_tx_ring_destroy(struct xpliant_dev *dev);
 static pthread_t xp_dev_event_handler_create(struct xpliant_dev *dev);
 static void *xp_dev_event_handler(void *arg);
 static void pkt_available_handle(xpsDevice_t intrSrcDev);
@@ -118,8 +232,9 @@ ops_xp_dev_by_id(xpsDevice_t id)
     XP_LOCK();
     dev = _xp_dev_by_id(id);
 
-    if (dev) {
-        ovs_refcount_ref(&dev->ref_cnt);
+    /* Device being freed stays registered while its threads stop. */
+    if (dev && !ovs_refcount_try_ref_rcu(&dev->ref_cnt)) {
+        dev = NULL;
     }
     XP_UNLOCK();
 
@@ -320,6 +435,11 @@ ops_xp_dev_init(struct xpliant_dev *dev)
         VLOG_INFO("XPliant device polling RX mode");
     }
 
+    if (xp_dev_tx_pool_init(dev->id)) {
+        goto error;
+    }
+    xp_dev_tx_ring_init(dev);
+
     /* Initialize host interface. */
     ops_xp_host_init(dev, ops_xp_host_if_type_get());
 
@@ -412,21 +532,27 @@ ops_xp_dev_free(struct xpliant_dev * const dev)
         ops_xp_mac_learning_unref(dev->ml);
         ops_xp_vlan_mgr_unref(dev->vlan_mgr);
 
-        /* Stop rxq thread */
+        /* Stop rxq, txq and event threads. All of them take the SDK lock,
+         * so they are joined without holding it. Rxq thread checks the exit
+         * latch at least once per backoff sleep. */
         latch_set(&dev->exit_latch);
-        if (dev->rx_mode == POLL) {
-            pthread_cancel(dev->rxq_thread);
-        }
+        XP_UNLOCK();
+
         xpthread_join(dev->rxq_thread, NULL);
+        xp_dev_tx_ring_destroy(dev);
 
         pthread_cancel(dev->event_thread);
         xpthread_join(dev->event_thread, NULL);
 
+        XP_LOCK();
+
         latch_poll(&dev->exit_latch);
         latch_destroy(&dev->exit_latch);
         latch_poll(&dev->rxq_latch);
         latch_destroy(&dev->rxq_latch);
 
+        xp_dev_tx_pool_destroy(dev->id);
+
         ovs_rwlock_destroy(&dev->odp_to_ofport_lock);
         hmap_destroy(&dev->odp_to_ofport_map);
 
@@ -441,63 +567,272 @@ ops_xp_dev_free(struct xpliant_dev * const dev)
     XP_UNLOCK();
 }
 
-/* Sends a packet to interface. */
-int
-ops_xp_dev_send(xpsDevice_t xp_dev_id, xpsInterfaceId_t dst_if_id,
-                void *buff, uint16_t buff_size)
+/* Caches CPU interface ID and Tx header size of device @id and
+ * preallocates its Tx buffers. */
+static int
+xp_dev_tx_pool_init(xpsDevice_t id)
 {
-    xpPacketInfo pktInfo;
-    static uint8_t priority;
-    int ret;
-    xpsInterfaceId_t cpu_if_id;
-    xpVif_t src_vif;
-    xpVif_t dst_vif;
+    struct xp_tx_pool *pool = &xp_tx_pools[id];
+    size_t buf_size;
+    XP_STATUS ret;
+    int i;
+
+    ret = xpsPortGetCPUPortIntfId(id, &pool->cpu_if_id);
+    if (ret != XP_NO_ERR) {
+        VLOG_ERR("Unable to get CPU interface ID of device #%d. RC = %u",
+                 id, ret);
+        return EPERM;
+    }
+
+    xpsPacketDriverGetTxHdrSize(&pool->hdr_size);
+
+    ovs_mutex_init(&pool->mutex);
+    list_init(&pool->free);
+    pool->n_allocated = 0;
+
+    buf_size = pool->hdr_size + RX_MAX_FRM_LEN_MAX_VAL;
+    pool->mem = xmalloc(XP_TX_POOL_SIZE * buf_size);
+    pool->bufs = xcalloc(XP_TX_POOL_SIZE, sizeof *pool->bufs);
+
+    for (i = 0; i < XP_TX_POOL_SIZE; i++) {
+        struct xp_tx_buf *tx_buf = &pool->bufs[i];
+
+        tx_buf->data = pool->mem + i * buf_size + pool->hdr_size;
+        tx_buf->room = RX_MAX_FRM_LEN_MAX_VAL;
+        tx_buf->pooled = true;
+        list_push_back(&pool->free, &tx_buf->list_node);
+    }
+
+    pool->init_done = true;
+
+    return 0;
+}
+
+static void
+xp_dev_tx_pool_destroy(xpsDevice_t id)
+{
+    struct xp_tx_pool *pool = &xp_tx_pools[id];
+
+    if (!pool->init_done) {
+        return;
+    }
+
+    pool->init_done = false;
+    ovs_mutex_destroy(&pool->mutex);
+    free(pool->bufs);
+    free(pool->mem);
+    pool->bufs = NULL;
+    pool->mem = NULL;
+}
+
+/* Returns a buffer to build a packet sent from CPU of device @xp_dev_id
+ * in or NULL if the device is not initialized. The buffer is released
+ * by ops_xp_dev_send_buf() or ops_xp_dev_tx_buf_put(). */
+struct xp_tx_buf *
+ops_xp_dev_tx_buf_get(xpsDevice_t xp_dev_id)
+{
+    struct xp_tx_pool *pool;
+    struct xp_tx_buf *tx_buf = NULL;
+
+    if (xp_dev_id >= XP_MAX_DEVICES || !xp_tx_pools[xp_dev_id].init_done) {
+        return NULL;
+    }
+    pool = &xp_tx_pools[xp_dev_id];
+
+    ovs_mutex_lock(&pool->mutex);
+    if (!list_is_empty(&pool->free)) {
+        tx_buf = CONTAINER_OF(list_pop_front(&pool->free),
+                              struct xp_tx_buf, list_node);
+    } else {
+        pool->n_allocated++;
+    }
+    ovs_mutex_unlock(&pool->mutex);
+
+    if (!tx_buf) {
+        /* Pool is exhausted. Buffer and headroom are allocated at once,
+         * so releasing the buffer frees both. */
+        tx_buf = xmalloc(sizeof *tx_buf + pool->hdr_size +
+                         RX_MAX_FRM_LEN_MAX_VAL);
+        tx_buf->data = (uint8_t *)(tx_buf + 1) + pool->hdr_size;
+        tx_buf->room = RX_MAX_FRM_LEN_MAX_VAL;
+        tx_buf->pooled = false;
+    }
+
+    tx_buf->size = 0;
+    tx_buf->queue = 0;
+
+    return tx_buf;
+}
+
+void
+ops_xp_dev_tx_buf_put(xpsDevice_t xp_dev_id, struct xp_tx_buf *tx_buf)
+{
+    struct xp_tx_pool *pool;
+
+    if (!tx_buf) {
+        return;
+    }
+
+    if (!tx_buf->pooled) {
+        free(tx_buf);
+        return;
+    }
+
+    pool = &xp_tx_pools[xp_dev_id];
+    ovs_mutex_lock(&pool->mutex);
+    list_push_front(&pool->free, &tx_buf->list_node);
+    ovs_mutex_unlock(&pool->mutex);
+}
+
+/* Builds Tx header of the packet in @tx_buf into its headroom and
+ * describes the packet in @pktInfo. */
+static void
+xp_dev_tx_hdr_build(xpsDevice_t xp_dev_id, xpsInterfaceId_t dst_if_id,
+                    struct xp_tx_buf *tx_buf, xpPacketInfo *pktInfo)
+{
+    struct xp_tx_pool *pool = &xp_tx_pools[xp_dev_id];
     uint16_t pkt_size;
-    size_t xp_tx_hdr_size;
 
-    if (!buff) {
-        VLOG_ERR("%s, Invalid packet buffer.", __FUNCTION__);
-        return EINVAL;
+    /* Pad the packet with zeroes to the minimal length */
+    pkt_size = tx_buf->size;
+    if (pkt_size < XP_TX_MIN_PKT_SIZE) {
+        memset(tx_buf->data + pkt_size, 0, XP_TX_MIN_PKT_SIZE - pkt_size);
+        pkt_size = XP_TX_MIN_PKT_SIZE;
     }
 
-    ret = xpsPortGetCPUPortIntfId(xp_dev_id, &cpu_if_id);
-    if (ret) {
-        VLOG_ERR("%s, Unable to get CPU interface ID. ERR%u",
-                 __FUNCTION__, ret);
-        return EPERM;
+    /* Tx header goes into the headroom in front of the packet. */
+    pktInfo->buf = tx_buf->data - pool->hdr_size;
+    pktInfo->bufSize = pkt_size + pool->hdr_size;
+    pktInfo->priority = tx_buf->queue;
+
+    xpsPacketDriverCreateHeader(xp_dev_id, pktInfo,
+                                XPS_INTF_MAP_INTFID_TO_VIF(pool->cpu_if_id),
+                                XPS_INTF_MAP_INTFID_TO_VIF(dst_if_id), true);
+}
+
+/* Returns class of the Ethernet frame of @size bytes at @pkt. */
+static enum xp_tx_class
+xp_dev_tx_classify(const uint8_t *pkt, size_t size)
+{
+    struct xp_pkt_hdrs hdrs;
+
+    if (!ops_xp_pkt_parse(pkt, size, &hdrs)) {
+        return XP_TX_CLASS_DEFAULT;
     }
 
-    xpsPacketDriverGetTxHdrSize(&xp_tx_hdr_size);
-    pkt_size = (buff_size < 64) ? 64 : buff_size;
-    pkt_size += xp_tx_hdr_size;
+    if (hdrs.eth_type == ETH_TYPE_LACP) {
+        return XP_TX_CLASS_LACP;
+    }
 
-    pktInfo.buf = xmalloc(pkt_size);
-    pktInfo.bufSize = pkt_size;
+    if (hdrs.link_local) {
+        return XP_TX_CLASS_BPDU;
+    }
 
-    src_vif = XPS_INTF_MAP_INTFID_TO_VIF(cpu_if_id);
-    dst_vif = XPS_INTF_MAP_INTFID_TO_VIF(dst_if_id);
+    if (hdrs.eth_type == ETH_TYPE_ARP) {
+        return XP_TX_CLASS_ARP;
+    }
 
-    pktInfo.priority = priority = 0;
-    priority = (priority + 1) % 64;     /* 64 - MAX_TX_QUEUES */
+    if (!hdrs.ip) {
+        return XP_TX_CLASS_DEFAULT;
+    }
 
-    /* Add Tx header to the packet. */
-    xpsPacketDriverCreateHeader(xp_dev_id, &pktInfo, src_vif, dst_vif, true);
+    if (hdrs.ip_proto == IPPROTO_ICMP || hdrs.ip_proto == IPPROTO_ICMPV6) {
+        return XP_TX_CLASS_ICMP;
+    }
 
-    /* Copy payload of the packet. */
-    memcpy(pktInfo.buf + xp_tx_hdr_size , buff, buff_size);
+    if (!hdrs.l4_ports) {
+        return XP_TX_CLASS_DEFAULT;
+    }
+
+    if (hdrs.ip_proto == IPPROTO_TCP) {
+        if (hdrs.src_port == XP_TX_BGP_PORT ||
+            hdrs.dst_port == XP_TX_BGP_PORT) {
+            return XP_TX_CLASS_BGP;
+        }
+    } else if (hdrs.dst_port == XP_TX_BFD_PORT ||
+               hdrs.dst_port == XP_TX_BFD_ECHO_PORT ||
+               hdrs.dst_port == XP_TX_BFD_MHOP_PORT) {
+        return XP_TX_CLASS_BFD;
+    }
+
+    return XP_TX_CLASS_DEFAULT;
+}
+
+/* Queues @tx_buf to the Tx thread. Returns false if its queue is full. */
+static bool
+xp_dev_tx_enqueue(struct xp_tx_ring *ring, xpsInterfaceId_t dst_if_id,
+                  struct xp_tx_buf *tx_buf)
+{
+    uint8_t q = tx_buf->queue;
+    bool queued = false;
+
+    tx_buf->dst_if_id = dst_if_id;
+
+    ovs_mutex_lock(&ring->mutex);
+    if (ring->n_pending[q] < XP_TX_RING_SIZE) {
+        list_push_back(&ring->pending[q], &tx_buf->list_node);
+        ring->n_pending[q]++;
+        ring->busy |= UINT64_C(1) << q;
+        queued = true;
+    } else {
+        ring->stats[q].drops++;
+    }
+    ovs_mutex_unlock(&ring->mutex);
+
+    if (queued) {
+        latch_set(&ring->latch);
+    }
+
+    return queued;
+}
+
+/* Sends packet built in @tx_buf to interface. Releases @tx_buf. In
+ * asynchronous Tx mode the packet is only queued to the Tx thread. */
+int
+ops_xp_dev_send_buf(xpsDevice_t xp_dev_id, xpsInterfaceId_t dst_if_id,
+                    struct xp_tx_buf *tx_buf)
+{
+    struct xp_tx_ring *ring;
+    xpPacketInfo pktInfo;
+    int ret;
+
+    if (!tx_buf) {
+        VLOG_ERR("%s, Invalid packet buffer.", __FUNCTION__);
+        return EINVAL;
+    }
 
-    /* Pad the packet with zeroes to 64 byte length */
-    if (buff_size < 64) {
-        memset(pktInfo.buf + xp_tx_hdr_size + buff_size, 0, (64 - buff_size));
+    /* Control packets go to their own queues, so bulk traffic does not
+     * delay them. */
+    tx_buf->queue = xp_tx_class_queue[xp_dev_tx_classify(tx_buf->data,
+                                                         tx_buf->size)];
+
+    ring = &xp_tx_rings[xp_dev_id];
+    if (ring->enabled) {
+        if (!xp_dev_tx_enqueue(ring, dst_if_id, tx_buf)) {
+            VLOG_WARN_RL(&rl, "Tx ring full, dropping packet on %u",
+                         dst_if_id);
+            ops_xp_dev_tx_buf_put(xp_dev_id, tx_buf);
+            return ENOBUFS;
+        }
+        return 0;
     }
 
+    xp_dev_tx_hdr_build(xp_dev_id, dst_if_id, tx_buf, &pktInfo);
+
     XP_LOCK();
     /* Send packet */
     ret = xpsPacketDriverSend(xp_dev_id, &pktInfo, SYNC_TX);
     XP_UNLOCK();
 
-    /* Release packet buffer */
-    free(pktInfo.buf);
+    ovs_mutex_lock(&ring->mutex);
+    if (ret == XP_NO_ERR) {
+        ring->stats[tx_buf->queue].sent++;
+    } else {
+        ring->stats[tx_buf->queue].errors++;
+    }
+    ovs_mutex_unlock(&ring->mutex);
+
+    ops_xp_dev_tx_buf_put(xp_dev_id, tx_buf);
 
     if (ret != XP_NO_ERR) {
         VLOG_WARN_RL(&rl, "error sending packet on %u. ERR%u", dst_if_id, ret);
@@ -507,6 +842,195 @@ ops_xp_dev_send(xpsDevice_t xp_dev_id, xpsInterfaceId_t dst_if_id,
     return 0;
 }
 
+/* Sends packets queued by ops_xp_dev_send_buf() in batches, so the SDK
+ * lock is taken once per batch. Sent buffers go back to the pool. */
+static void *
+xp_dev_tx_handler(void *arg)
+{
+    struct xpliant_dev *dev = arg;
+    struct xp_tx_ring *ring = &xp_tx_rings[dev->id];
+    struct xp_tx_buf *batch[XP_TX_BATCH];
+    xpPacketInfo pkt_info[XP_TX_BATCH];
+    XP_STATUS ret[XP_TX_BATCH];
+
+    while (!latch_is_set(&dev->exit_latch)) {
+        size_t n = 0;
+        size_t i;
+
+        ovs_mutex_lock(&ring->mutex);
+        while (n < XP_TX_BATCH && ring->busy) {
+            int q = log_2_floor(ring->busy);
+
+            batch[n++] = CONTAINER_OF(list_pop_front(&ring->pending[q]),
+                                      struct xp_tx_buf, list_node);
+            if (!--ring->n_pending[q]) {
+                ring->busy &= ~(UINT64_C(1) << q);
+            }
+        }
+        ovs_mutex_unlock(&ring->mutex);
+
+        if (!n) {
+            latch_wait(&dev->exit_latch);
+            latch_wait(&ring->latch);
+            poll_block();
+            latch_poll(&ring->latch);
+            continue;
+        }
+
+        /* Headers are built without holding the SDK lock */
+        for (i = 0; i < n; i++) {
+            xp_dev_tx_hdr_build(dev->id, batch[i]->dst_if_id, batch[i],
+                                &pkt_info[i]);
+        }
+
+        XP_LOCK();
+        for (i = 0; i < n; i++) {
+            ret[i] = xpsPacketDriverSend(dev->id, &pkt_info[i], SYNC_TX);
+        }
+        XP_UNLOCK();
+
+        ovs_mutex_lock(&ring->mutex);
+        for (i = 0; i < n; i++) {
+            struct xp_tx_queue_stats *stats = &ring->stats[batch[i]->queue];
+
+            if (ret[i] == XP_NO_ERR) {
+                stats->sent++;
+            } else {
+                stats->errors++;
+            }
+        }
+        ovs_mutex_unlock(&ring->mutex);
+
+        for (i = 0; i < n; i++) {
+            if (ret[i] != XP_NO_ERR) {
+                VLOG_WARN_RL(&rl, "error sending packet on %u. ERR%u",
+                             batch[i]->dst_if_id, ret[i]);
+            }
+            ops_xp_dev_tx_buf_put(dev->id, batch[i]);
+        }
+    }
+
+    return NULL;
+}
+
+/* Starts the Tx thread of @dev in asynchronous Tx mode. */
+static void
+xp_dev_tx_ring_init(struct xpliant_dev *dev)
+{
+    struct xp_tx_ring *ring = &xp_tx_rings[dev->id];
+    int q;
+
+    ovs_mutex_init(&ring->mutex);
+    for (q = 0; q < XP_TX_QUEUES; q++) {
+        list_init(&ring->pending[q]);
+        ring->n_pending[q] = 0;
+    }
+    ring->busy = 0;
+    memset(ring->stats, 0, sizeof ring->stats);
+
+    if (!tx_async) {
+        return;
+    }
+
+    latch_init(&ring->latch);
+    dev->txq_thread = ovs_thread_create("ops-xp-dev-tx", xp_dev_tx_handler,
+                                        (void *)dev);
+    ring->enabled = true;
+    VLOG_INFO("XPliant device's asynchronous TXQ thread started");
+}
+
+/* Stops the Tx thread of @dev. Expects exit latch of @dev to be set.
+ * Packets still queued are dropped. */
+static void
+xp_dev_tx_ring_destroy(struct xpliant_dev *dev)
+{
+    struct xp_tx_ring *ring = &xp_tx_rings[dev->id];
+    struct xp_tx_buf *tx_buf;
+    int q;
+
+    /* Ring is only set up along with the pool */
+    if (!xp_tx_pools[dev->id].init_done) {
+        return;
+    }
+
+    if (ring->enabled) {
+        ring->enabled = false;
+        xpthread_join(dev->txq_thread, NULL);
+        latch_destroy(&ring->latch);
+    }
+
+    ovs_mutex_lock(&ring->mutex);
+    for (q = 0; q < XP_TX_QUEUES; q++) {
+        LIST_FOR_EACH_POP (tx_buf, list_node, &ring->pending[q]) {
+            ops_xp_dev_tx_buf_put(dev->id, tx_buf);
+        }
+        ring->n_pending[q] = 0;
+    }
+    ring->busy = 0;
+    ovs_mutex_unlock(&ring->mutex);
+
+    ovs_mutex_destroy(&ring->mutex);
+}
+
+/* Sends a packet to interface. Callers which can build the packet in a
+ * Tx buffer should use ops_xp_dev_send_buf() to avoid the copy. */
+int
+ops_xp_dev_send(xpsDevice_t xp_dev_id, xpsInterfaceId_t dst_if_id,
+                void *buff, uint16_t buff_size)
+{
+    struct xp_tx_buf *tx_buf;
+
+    if (!buff) {
+        VLOG_ERR("%s, Invalid packet buffer.", __FUNCTION__);
+        return EINVAL;
+    }
+
+    tx_buf = ops_xp_dev_tx_buf_get(xp_dev_id);
+    if (!tx_buf) {
+        VLOG_ERR("%s, Device #%u is not ready to send.",
+                 __FUNCTION__, xp_dev_id);
+        return EPERM;
+    }
+
+    if (buff_size > tx_buf->room) {
+        ops_xp_dev_tx_buf_put(xp_dev_id, tx_buf);
+        return EMSGSIZE;
+    }
+
+    /* Copy payload of the packet. */
+    memcpy(tx_buf->data, buff, buff_size);
+    tx_buf->size = buff_size;
+
+    return ops_xp_dev_send_buf(xp_dev_id, dst_if_id, tx_buf);
+}
+
+/* Backs the Rx thread off after an empty receive poll. Yields first,
+ * then sleeps for exponentially longer times up to the maximum.
+ * @idle counts empty polls in a row. */
+static void
+xp_dev_rx_backoff(unsigned int idle)
+{
+    struct timespec ts;
+    unsigned int usec;
+
+    if (idle < XP_RX_SPIN_POLLS) {
+        if (!idle) {
+            ovsrcu_quiesce();
+        }
+        sched_yield();
+        return;
+    }
+
+    idle = MIN(idle - XP_RX_SPIN_POLLS, 31);
+    usec = MIN((uint64_t)XP_RX_SLEEP_MIN_US << idle, XP_RX_SLEEP_MAX_US);
+
+    ts.tv_sec = 0;
+    ts.tv_nsec = usec * 1000;
+    ovsrcu_quiesce_start();
+    nanosleep(&ts, NULL);
+    ovsrcu_quiesce_end();
+}
+
 /* This handler thread receives mcpu/scpu incoming packets and
  * de-multiplex them into the appropriate UDS sockets. Each single UDS socket
  * corresponds to the single XP device's traffic port. Finally, the packet
@@ -519,17 +1043,21 @@ xp_dev_recv_handler(void *arg)
     XP_STATUS ret = XP_NO_ERR;
     uint16_t pkts_received = 0;
     struct xpPacketInfo *pkt_info;
+    struct xpPacketInfo *pkts[XP_RX_BURST];
+    uint8_t *bufs;
+    unsigned int idle = 0;
+    unsigned int n_bursts = 0;
+    int i;
 
     XP_TRACE();
 
-    if (dev->rx_mode == POLL) {
-        pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
+    VLOG_INFO("Allocate buffers for CPU interface");
+    pkt_info = xzalloc(XP_RX_BURST * sizeof *pkt_info);
+    bufs = xmalloc(XP_RX_BURST * XP_MAX_PACKET_SIZE);
+    for (i = 0; i < XP_RX_BURST; i++) {
+        pkt_info[i].buf = bufs + i * XP_MAX_PACKET_SIZE;
+        pkts[i] = &pkt_info[i];
     }
-    pkt_info = xzalloc(sizeof *pkt_info);
-    pkt_info->buf = NULL;
-
-    VLOG_INFO("Allocate buffer for CPU interface");
-    pkt_info->buf = xmalloc(XP_MAX_PACKET_SIZE);
 
     while (!latch_is_set(&dev->exit_latch)) {
 
@@ -545,34 +1073,48 @@ xp_dev_recv_handler(void *arg)
         }
 
         do {
-            pkts_received = 1;
-            pkt_info->bufSize = XP_MAX_PACKET_SIZE;
+            pkts_received = XP_RX_BURST;
+            for (i = 0; i < XP_RX_BURST; i++) {
+                pkt_info[i].bufSize = XP_MAX_PACKET_SIZE;
+            }
 
             if (XP_NETDEV_DMA != dev->cpu_port_type) {
                 XP_LOCK();
             }
 
-            ret = xpsPacketDriverReceive(dev->id, &pkt_info, &pkts_received);
+            ret = xpsPacketDriverReceive(dev->id, pkts, &pkts_received);
 
             if (XP_NETDEV_DMA != dev->cpu_port_type) {
                 XP_UNLOCK();
             }
 
             if ((ret == XP_ERR_PKT_NOT_AVAILABLE) || (ret == XP_ERR_TIMEOUT)) {
-                /* Sleep for a while to release CPU for other tasks.. */
-                /* TODO: How about async notification from WM through IPC? */
-                poll(NULL, 0, 1 /* ms */);
-            } else if ((ret != XP_NO_ERR) && (dev->rx_mode == POLL)) {
-                VLOG_ERR_RL(&rl, "unable to receive packet. RC = %u", ret);
+                pkts_received = 0;
+            } else if (ret != XP_NO_ERR) {
+                if (dev->rx_mode == POLL) {
+                    VLOG_ERR_RL(&rl, "unable to receive packet. RC = %u", ret);
+                }
+                pkts_received = 0;
             }
-        }
-        while(pkts_received);
+
+            if (pkts_received) {
+                idle = 0;
+                if (!(++n_bursts % XP_RX_QUIESCE_BURSTS)) {
+                    ovsrcu_quiesce();
+                }
+            } else if (dev->rx_mode == POLL) {
+                /* Release CPU for other tasks, for longer the longer
+                 * the CPU port stays idle. */
+                xp_dev_rx_backoff(idle);
+                idle = MIN(idle + 1, XP_RX_SPIN_POLLS + 32);
+            }
+        } while (pkts_received && !latch_is_set(&dev->exit_latch));
 
     } /* while (!latch_is_set(&dev->exit_latch)) */
 
     XP_TRACE();
 
-    free(pkt_info->buf);
+    free(bufs);
     free(pkt_info);
     return NULL;
 }
@@ -593,6 +1135,9 @@ ipc_handler(void *arg)
 {
     XP_STATUS status = XP_NO_ERR;
 
+    /* The thread never touches RCU protected data. */
+    ovsrcu_quiesce_start();
+
     for (;;) {
         /* Handle HW/WM incoming requests. */
         status = xpWmIpcSrvUpdate(arg);
@@ -642,6 +1187,9 @@ host_if_type_init(void)
         } else if (strcmp("TAP_NETDEV", p_mode) == 0) {
             host_if_type = XP_HOST_IF_TAP;
             packet_if_type = XP_NETDEV_DMA;
+        } else if (strcmp("PACKET_MMAP", p_mode) == 0) {
+            host_if_type = XP_HOST_IF_PACKET;
+            packet_if_type = XP_NETDEV_DMA;
         }
     }
 
@@ -649,6 +1197,18 @@ host_if_type_init(void)
     VLOG_INFO("Packet interface type: %u.", packet_if_type);
 }
 
+static void
+tx_mode_init(void)
+{
+    const char *p_mode = getenv("CPU_PACKET_TX_MODE");
+
+    if (p_mode != NULL && strcmp("ASYNC", p_mode) == 0) {
+        tx_async = true;
+    }
+
+    VLOG_INFO("CPU packet Tx mode: %s.", tx_async ? "async" : "sync");
+}
+
 xp_host_if_type_t
 ops_xp_host_if_type_get(void)
 {
@@ -678,6 +1238,7 @@ ops_xp_dev_srv_init(void)
 
         /* Init host and packet interfaces working mode. */
         host_if_type_init();
+        tx_mode_init();
 
         /* Perform XDK-specific initialization */
         status = ops_xp_sdk_init(initType);
@@ -827,3 +1388,98 @@ ops_xp_dev_get_intf_name(struct xpliant_dev *xpdev, xpsInterfaceId_t intfId,
 
     return name;
 }
+
+static void
+xp_unixctl_tx_stats(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                    const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds d_str = DS_EMPTY_INITIALIZER;
+    int id, q;
+
+    for (id = 0; id < XP_MAX_DEVICES; id++) {
+        struct xp_tx_pool *pool = &xp_tx_pools[id];
+        struct xp_tx_ring *ring = &xp_tx_rings[id];
+
+        if (!pool->init_done) {
+            continue;
+        }
+
+        ds_put_format(&d_str, "Device #%d, %s Tx mode\n", id,
+                      ring->enabled ? "async" : "sync");
+
+        ovs_mutex_lock(&pool->mutex);
+        ds_put_format(&d_str, "  Buffers allocated on empty pool: %"PRIu64"\n",
+                      pool->n_allocated);
+        ovs_mutex_unlock(&pool->mutex);
+
+        ovs_mutex_lock(&ring->mutex);
+        ds_put_format(&d_str, "  %-6s%-8s%-16s%-16s%-16s\n",
+                      "Queue", "Queued", "Sent", "Errors", "Drops");
+        for (q = 0; q < XP_TX_QUEUES; q++) {
+            const struct xp_tx_queue_stats *stats = &ring->stats[q];
+
+            if (!stats->sent && !stats->errors && !stats->drops &&
+                !ring->n_pending[q]) {
+                continue;
+            }
+            ds_put_format(&d_str, "  %-6d%-8"PRIuSIZE"%-16"PRIu64"%-16"PRIu64
+                          "%-16"PRIu64"\n", q, ring->n_pending[q],
+                          stats->sent, stats->errors, stats->drops);
+        }
+        ovs_mutex_unlock(&ring->mutex);
+    }
+
+    unixctl_command_reply(conn, ds_cstr(&d_str));
+    ds_destroy(&d_str);
+}
+
+static void
+xp_unixctl_tx_queue_map(struct unixctl_conn *conn, int argc,
+                        const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds d_str = DS_EMPTY_INITIALIZER;
+    unsigned int queue;
+    int class;
+
+    if (argc > 1) {
+        for (class = 0; class < XP_TX_CLASS_MAX; class++) {
+            if (!strcmp(argv[1], xp_tx_class_names[class])) {
+                break;
+            }
+        }
+        if (class == XP_TX_CLASS_MAX) {
+            unixctl_command_reply_error(conn, "Unknown packet class");
+            return;
+        }
+        if (argc < 3 || !str_to_uint(argv[2], 10, &queue)
+            || queue >= XP_TX_QUEUES) {
+            unixctl_command_reply_error(conn, "Invalid Tx queue");
+            return;
+        }
+        xp_tx_class_queue[class] = queue;
+    }
+
+    ds_put_format(&d_str, "%-10s%-6s\n", "Class", "Queue");
+    for (class = 0; class < XP_TX_CLASS_MAX; class++) {
+        ds_put_format(&d_str, "%-10s%-6u\n", xp_tx_class_names[class],
+                      xp_tx_class_queue[class]);
+    }
+
+    unixctl_command_reply(conn, ds_cstr(&d_str));
+    ds_destroy(&d_str);
+}
+
+void
+ops_xp_dev_unixctl_init(void)
+{
+    static bool registered;
+    if (registered) {
+        return;
+    }
+    registered = true;
+
+    unixctl_command_register("xp/dev/tx-stats", "", 0, 0,
+                             xp_unixctl_tx_stats, NULL);
+    unixctl_command_register("xp/dev/tx-queue-map", "[class queue]", 0, 2,
+                             xp_unixctl_tx_queue_map, NULL);
+}
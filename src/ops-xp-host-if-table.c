@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-host-if-table.c
+ *
+ * Purpose: This file contains the table of host interfaces shared by the
+ *          TAP and AF_PACKET host interface backends for the
+ *          Cavium/XPliant SDK. It keeps interface entries by fd and by
+ *          XPS interface ID, their filters and the port map the receive
+ *          path looks interfaces up in.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <openvswitch/vlog.h>
+
+#include "util.h"
+#include "ops-xp-host-if-table.h"
+#include "openXpsPort.h"
+
+
+VLOG_DEFINE_THIS_MODULE(xp_host_if_table);
+
+static void host_if_filter_delete(struct xp_host_if_table *table,
+                                  struct xp_host_if_entry *entry);
+
+void
+ops_xp_host_if_table_init(struct xp_host_if_table *table)
+{
+    ovs_mutex_init(&table->mutex);
+    hmap_init(&table->if_id_map);
+    hmap_init(&table->fd_map);
+    ovsrcu_init(&table->port_map, xzalloc(sizeof(struct xp_host_if_port_map)));
+}
+
+/* Destroys @table. All entries must have been removed. */
+void
+ops_xp_host_if_table_destroy(struct xp_host_if_table *table)
+{
+    hmap_destroy(&table->if_id_map);
+    hmap_destroy(&table->fd_map);
+    ovsrcu_postpone(free, ovsrcu_get_protected(struct xp_host_if_port_map *,
+                                               &table->port_map));
+    ovs_mutex_destroy(&table->mutex);
+}
+
+void
+ops_xp_host_if_entry_init(struct xp_host_if_entry *entry,
+                          xpsInterfaceId_t if_id, int fd, const char *name)
+{
+    entry->if_id = if_id;
+    atomic_init(&entry->send_if_id, if_id);
+    entry->fd = fd;
+    entry->name = xstrdup(name);
+    atomic_init(&entry->filter_created, false);
+    entry->port = XP_MAX_TOTAL_PORTS;
+}
+
+/* Closes fd of @entry and frees its members. Memory of @entry itself
+ * belongs to the backend. */
+void
+ops_xp_host_if_entry_destroy(struct xp_host_if_entry *entry)
+{
+    close(entry->fd);
+    free(entry->name);
+}
+
+/* Maps @port to @entry, or unmaps it if @entry is NULL. Readers keep
+ * using the previous map until they quiesce. */
+static void
+host_if_port_map_set(struct xp_host_if_table *table, xpsPort_t port,
+                     struct xp_host_if_entry *entry)
+    OVS_REQUIRES(table->mutex)
+{
+    struct xp_host_if_port_map *old_map, *new_map;
+
+    old_map = ovsrcu_get_protected(struct xp_host_if_port_map *,
+                                   &table->port_map);
+    new_map = xmemdup(old_map, sizeof *old_map);
+    new_map->entries[port] = entry;
+
+    ovsrcu_set(&table->port_map, new_map);
+    ovsrcu_postpone(free, old_map);
+}
+
+/* Finds xp_host_if_entry using fd. */
+static struct xp_host_if_entry *
+host_if_get_entry_by_fd(struct xp_host_if_table *table, int fd)
+    OVS_REQUIRES(table->mutex)
+{
+    struct hmap_node *e;
+
+    e = hmap_first_with_hash(&table->fd_map, fd);
+    if (e) {
+        return CONTAINER_OF(e, struct xp_host_if_entry, fd_node);
+    }
+
+    return NULL;
+}
+
+/* Finds xp_host_if_entry using xps interface id. */
+static struct xp_host_if_entry *
+host_if_get_entry_by_if_id(struct xp_host_if_table *table,
+                           xpsInterfaceId_t if_id)
+    OVS_REQUIRES(table->mutex)
+{
+    struct hmap_node *e;
+
+    e = hmap_first_with_hash(&table->if_id_map, if_id);
+    if (e) {
+        return CONTAINER_OF(e, struct xp_host_if_entry, if_id_node);
+    }
+
+    return NULL;
+}
+
+void
+ops_xp_host_if_table_insert(struct xp_host_if_table *table,
+                            struct xp_host_if_entry *entry)
+{
+    ovs_mutex_lock(&table->mutex);
+    hmap_insert(&table->fd_map, &entry->fd_node, entry->fd);
+    ovs_mutex_unlock(&table->mutex);
+}
+
+/* Removes entry of host interface @fd from @table along with its filter.
+ * Returns the entry, which the caller frees after an RCU grace period,
+ * or NULL if there is none. */
+struct xp_host_if_entry *
+ops_xp_host_if_table_remove(struct xp_host_if_table *table, int fd)
+{
+    struct xp_host_if_entry *entry;
+
+    ovs_mutex_lock(&table->mutex);
+
+    entry = host_if_get_entry_by_fd(table, fd);
+    if (entry) {
+        host_if_filter_delete(table, entry);
+        hmap_remove(&table->fd_map, &entry->fd_node);
+    }
+
+    ovs_mutex_unlock(&table->mutex);
+
+    return entry;
+}
+
+int
+ops_xp_host_if_table_filter_create(struct xp_host_if_table *table,
+                                   xpsInterfaceId_t xps_if_id, int fd,
+                                   int *filter_id)
+{
+    struct xp_host_if_entry *entry;
+    xpsInterfaceType_e if_type;
+    xpsDevice_t dev_id;
+    xpsPort_t port;
+    bool filter_created;
+
+    if (fd <= 0) {
+        VLOG_ERR("Invalid host interface ID %d specified.", fd);
+        return EINVAL;
+    }
+
+    ovs_mutex_lock(&table->mutex);
+
+    entry = host_if_get_entry_by_fd(table, fd);
+    if (!entry) {
+        ovs_mutex_unlock(&table->mutex);
+        return ENOENT;
+    }
+
+    atomic_read_relaxed(&entry->filter_created, &filter_created);
+    if (filter_created) {
+        /* Filter already present */
+        ovs_mutex_unlock(&table->mutex);
+        return 0;
+    }
+
+    *filter_id = xps_if_id + 1;
+    atomic_store_relaxed(&entry->filter_created, true);
+
+    hmap_insert(&table->if_id_map, &entry->if_id_node, entry->if_id);
+
+    /* Packets are trapped per port, so port interfaces are mapped for
+     * the receive path. */
+    if (xpsInterfaceGetType(entry->if_id, &if_type) == XP_NO_ERR &&
+        if_type == XPS_PORT &&
+        xpsPortGetDevAndPortNumFromIntf(entry->if_id, &dev_id,
+                                        &port) == XP_NO_ERR &&
+        port < XP_MAX_TOTAL_PORTS) {
+        entry->port = port;
+        host_if_port_map_set(table, port, entry);
+    }
+
+    ovs_mutex_unlock(&table->mutex);
+
+    return 0;
+}
+
+static void
+host_if_filter_delete(struct xp_host_if_table *table,
+                      struct xp_host_if_entry *entry)
+    OVS_REQUIRES(table->mutex)
+{
+    bool filter_created;
+
+    atomic_read_relaxed(&entry->filter_created, &filter_created);
+    if (!filter_created) {
+        return;
+    }
+
+    hmap_remove(&table->if_id_map, &entry->if_id_node);
+
+    if (entry->port < XP_MAX_TOTAL_PORTS) {
+        host_if_port_map_set(table, entry->port, NULL);
+        entry->port = XP_MAX_TOTAL_PORTS;
+    }
+
+    atomic_store_relaxed(&entry->filter_created, false);
+}
+
+int
+ops_xp_host_if_table_filter_delete(struct xp_host_if_table *table,
+                                   int filter_id)
+{
+    struct xp_host_if_entry *entry;
+
+    if (filter_id <= 0) {
+        VLOG_ERR("Invalid host interface filter ID %d specified.",
+                 filter_id);
+        return EINVAL;
+    }
+
+    ovs_mutex_lock(&table->mutex);
+
+    entry = host_if_get_entry_by_if_id(table, filter_id - 1);
+    if (!entry) {
+        ovs_mutex_unlock(&table->mutex);
+        return ENOENT;
+    }
+
+    host_if_filter_delete(table, entry);
+
+    ovs_mutex_unlock(&table->mutex);
+
+    return 0;
+}
+
+/* Makes host interface @fd send through port control interface of
+ * @xps_if_id if @set, or through @xps_if_id itself otherwise. */
+int
+ops_xp_host_if_table_control_id_set(struct xp_host_if_table *table,
+                                    xpsDevice_t dev_id,
+                                    xpsInterfaceId_t xps_if_id, int fd,
+                                    bool set)
+{
+    xpsInterfaceType_e if_type;
+    xpsInterfaceId_t send_if_id;
+    XP_STATUS status = XP_NO_ERR;
+    struct xp_host_if_entry *entry;
+
+    if (fd <= 0) {
+        VLOG_ERR("Invalid host interface ID %d specified.", fd);
+        return EINVAL;
+    }
+
+    ovs_mutex_lock(&table->mutex);
+
+    entry = host_if_get_entry_by_fd(table, fd);
+    if (!entry) {
+        ovs_mutex_unlock(&table->mutex);
+        return ENOENT;
+    }
+
+    if (set) {
+        status = xpsInterfaceGetType(xps_if_id, &if_type);
+        if (status != XP_NO_ERR) {
+            ovs_mutex_unlock(&table->mutex);
+            VLOG_ERR("%s, Failed to get interface type. Error: %d",
+                     __FUNCTION__, status);
+            return EPERM;
+        }
+
+        if (if_type != XPS_PORT) {
+            ovs_mutex_unlock(&table->mutex);
+            return 0;
+        }
+
+        status = xpsPortGetPortControlIntfId(dev_id, xps_if_id, &send_if_id);
+        if (status) {
+            ovs_mutex_unlock(&table->mutex);
+            VLOG_ERR("%s, Unable to get port control interface ID for "
+                     "interface: %u. Error: %d",
+                     __FUNCTION__, xps_if_id, status);
+            return EPERM;
+        }
+        atomic_store_relaxed(&entry->send_if_id, send_if_id);
+    } else {
+        atomic_store_relaxed(&entry->send_if_id, xps_if_id);
+    }
+
+    ovs_mutex_unlock(&table->mutex);
+
+    return 0;
+}
@@ -0,0 +1,813 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-host-packet.c
+ *
+ * Purpose: This file contains OpenSwitch CPU host interfaces based on
+ *          memory mapped AF_PACKET rings for the Cavium/XPliant SDK.
+ *          Each host interface is a veth pair. The kernel stack uses one
+ *          end, the plugin reads and writes the other one through
+ *          TPACKET_V3 Rx and Tx rings. Kernels without Tx ring support
+ *          for TPACKET_V3 get packets through plain sends.
+ */
+
+#if !defined(OPS_AS7512) && !defined(OPS_XP_SIM)
+#define OPS_XP_SIM
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openvswitch/vlog.h>
+#include <netinet/ether.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+
+#include "ovs-atomic.h"
+#include "ovs-rcu.h"
+#include "socket-util.h"
+#include "ops-xp-util.h"
+#include "ops-xp-netlink.h"
+#include "ops-xp-host.h"
+#include "ops-xp-host-if-table.h"
+#include "ops-xp-host-rxq.h"
+#include "ops-xp-dev.h"
+#include "ops-xp-dev-init.h"
+#include "openXpsPacketDrv.h"
+#include "openXpsPort.h"
+
+
+VLOG_DEFINE_THIS_MODULE(xp_host_packet);
+
+/* Suffix of the veth end the plugin uses */
+#define PKT_PEER_SUFFIX         "-cpu"
+
+/* Rx ring of an interface. Blocks are handed to the plugin when full or
+ * after the retire timeout, which bounds the latency of a lone packet. */
+#define PKT_RX_BLOCK_SIZE       (1 << 16)
+#define PKT_RX_BLOCK_NR         4
+#define PKT_RX_RETIRE_TOV_MS    1
+
+/* Tx ring of an interface. A frame holds a packet of maximal size. */
+#define PKT_TX_BLOCK_SIZE       (1 << 17)
+#define PKT_TX_BLOCK_NR         2
+#define PKT_TX_FRAME_SIZE       TPACKET_ALIGN(TPACKET3_HDRLEN + \
+                                              RX_MAX_FRM_LEN_MAX_VAL)
+#define PKT_TX_FRAMES_PER_BLOCK (PKT_TX_BLOCK_SIZE / PKT_TX_FRAME_SIZE)
+#define PKT_TX_FRAME_NR         (PKT_TX_FRAMES_PER_BLOCK * PKT_TX_BLOCK_NR)
+
+#define PKT_RX_RING_SIZE        (PKT_RX_BLOCK_SIZE * PKT_RX_BLOCK_NR)
+#define PKT_TX_RING_SIZE        (PKT_TX_BLOCK_SIZE * PKT_TX_BLOCK_NR)
+
+/* Readiness events handled per wakeup of the listener */
+#define PKT_EPOLL_EVENTS        64
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+struct pkt_if_entry {
+    /* Common part. Its fd is AF_PACKET socket bound to the peer. */
+    struct xp_host_if_entry up;
+    char *peer_name;
+    /* Rx ring followed by Tx ring, if the socket has one. */
+    uint8_t *ring;
+    bool tx_ring;
+    /* Next Rx block to look at. Used by the listener only. */
+    unsigned int rx_block;
+    /* Serializes receive queue workers filling the Tx ring. */
+    struct ovs_mutex tx_mutex;
+    unsigned int tx_frame OVS_GUARDED;
+    uint64_t tx_drops OVS_GUARDED;
+};
+
+struct pkt_info {
+    xpsDevice_t dev_id;
+    /* Sockets and exit pipe the listener waits on. Events of sockets
+     * point to their pkt_if_entry, the exit pipe's to NULL. Entries are
+     * freed after an RCU grace period, so the listener and receive queue
+     * workers use them without locking. */
+    int epoll_fd;
+    /* Exit pipe for the listener thread. */
+    int exit_fds[2];
+    /* Host interface entries. */
+    struct xp_host_if_table ifs;
+    /* Listener Thread ID. */
+    pthread_t listener_thread;
+    /* Queues of trapped packets on their way to host interfaces. */
+    struct xp_rxq_set *rxqs;
+};
+
+static void *pkt_listener(void *arg);
+static void pkt_if_entry_free(struct pkt_if_entry *if_entry);
+
+static XP_STATUS pkt_packet_driver_cb(xpsDevice_t devId, xpsPort_t portNum,
+                                      void *buf, uint16_t buf_size,
+                                      void *userData);
+static void pkt_rxq_deliver(void *aux, struct xp_rxq_pkt **pkts, size_t n);
+
+static int pkt_init(struct xpliant_dev *xp_dev);
+static void pkt_deinit(struct xpliant_dev *xp_dev);
+static int pkt_if_create(struct xpliant_dev *xp_dev, char *name,
+                         xpsInterfaceId_t xps_if_id,
+                         struct ether_addr *mac, int *host_if_id);
+static int pkt_if_delete(struct xpliant_dev *xp_dev, int host_if_id);
+static int pkt_if_filter_create(char *name, struct xpliant_dev *xp_dev,
+                                xpsInterfaceId_t xps_if_id,
+                                int host_if_id, int *host_filter_id);
+static int pkt_if_filter_delete(struct xpliant_dev *xp_dev, int host_filter_id);
+static int pkt_if_control_id_set(struct xpliant_dev *xp_dev,
+                                 xpsInterfaceId_t xps_if_id,
+                                 int host_if_id, bool set);
+
+const struct xp_host_if_api xp_host_packet_api = {
+    pkt_init,
+    pkt_deinit,
+    pkt_if_create,
+    pkt_if_delete,
+    pkt_if_filter_create,
+    pkt_if_filter_delete,
+    pkt_if_control_id_set
+};
+
+static int
+pkt_init(struct xpliant_dev *xp_dev)
+{
+    struct pkt_info *info;
+    struct epoll_event event;
+    XP_STATUS ret;
+
+    ovs_assert(xp_dev);
+    ovs_assert(xp_dev->host_if_info);
+
+    info = xzalloc(sizeof *info);
+    info->dev_id = xp_dev->id;
+
+    info->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (info->epoll_fd < 0) {
+        VLOG_ERR("%s, Unable to create epoll instance. Error(%d) - %s",
+                 __FUNCTION__, errno, strerror(errno));
+        free(info);
+        return EFAULT;
+    }
+
+    /* Create exit pipe and add its read fd to the epoll set. */
+    xpipe(info->exit_fds);
+
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(info->epoll_fd, EPOLL_CTL_ADD, info->exit_fds[0], &event);
+
+    ops_xp_host_if_table_init(&info->ifs);
+    info->rxqs = ops_xp_host_rxq_create(xp_dev->id, pkt_rxq_deliver, info);
+
+    ret = xpsPacketDriverFeatureRxHndlr(XP_MAX_CPU_RX_HDLR,
+                                        pkt_packet_driver_cb,
+                                        (void *)xp_dev);
+    if (ret != XP_NO_ERR) {
+        VLOG_ERR("%s, Unable to register handler of trapped packets",
+                 __FUNCTION__);
+        ops_xp_host_rxq_destroy(info->rxqs);
+        ops_xp_host_if_table_destroy(&info->ifs);
+        close(info->exit_fds[0]);
+        close(info->exit_fds[1]);
+        close(info->epoll_fd);
+        free(info);
+        return EFAULT;
+    }
+
+    info->listener_thread = ovs_thread_create("ops-xp-pkt-listener",
+                                              pkt_listener, info);
+    VLOG_INFO("AF_PACKET listener thread started");
+
+    xp_dev->host_if_info->data = info;
+
+    return 0;
+}
+
+static void
+pkt_deinit(struct xpliant_dev *xp_dev)
+{
+    struct xp_host_if_entry *e;
+    struct xp_host_if_entry *next;
+    struct pkt_info *info;
+    XP_STATUS ret;
+
+    ovs_assert(xp_dev);
+    ovs_assert(xp_dev->host_if_info);
+
+    XP_LOCK();
+    info = (struct pkt_info *)xp_dev->host_if_info->data;
+    XP_UNLOCK();
+
+    if (!info) {
+        return;
+    }
+
+    ret = xpsPacketDriverFeatureRxHndlrDeRegister(XP_MAX_CPU_RX_HDLR);
+    if (ret != XP_NO_ERR) {
+        VLOG_ERR("%s, Unable to deregister handler of trapped packets",
+                 __FUNCTION__);
+    }
+
+    /* Workers write to Tx rings, so they stop before rings are freed. */
+    ops_xp_host_rxq_destroy(info->rxqs);
+
+    /* Stop listener thread. */
+    ignore(write(info->exit_fds[1], "", 1));
+    xpthread_join(info->listener_thread, NULL);
+
+    /* Remove host interfaces. */
+    HMAP_FOR_EACH_SAFE (e, next, fd_node, &info->ifs.fd_map) {
+        pkt_if_delete(xp_dev, e->fd);
+    }
+
+    XP_LOCK();
+    xp_dev->host_if_info->data = NULL;
+    XP_UNLOCK();
+
+    close(info->exit_fds[0]);
+    close(info->exit_fds[1]);
+    close(info->epoll_fd);
+
+    ops_xp_host_if_table_destroy(&info->ifs);
+
+    free(info);
+
+    VLOG_INFO("Host interface AF_PACKET-based instance deallocated.");
+}
+
+/* Size of the rings mapped for a socket with or without Tx ring */
+static size_t
+pkt_ring_size(bool tx_ring)
+{
+    return PKT_RX_RING_SIZE + (tx_ring ? PKT_TX_RING_SIZE : 0);
+}
+
+/* Opens AF_PACKET socket bound to @if_name with Rx and Tx rings mapped
+ * to @ring. If kernel does not support Tx ring with TPACKET_V3, only Rx
+ * ring is mapped and @tx_ring is set to false. Returns the socket or
+ * negative errno. */
+static int
+pkt_socket_open(const char *if_name, uint8_t **ring, bool *tx_ring)
+{
+    struct tpacket_req3 req;
+    struct sockaddr_ll sll;
+    int version = TPACKET_V3;
+    unsigned int ifindex;
+    void *map;
+    int error;
+    int fd;
+
+    ifindex = if_nametoindex(if_name);
+    if (!ifindex) {
+        return -ENODEV;
+    }
+
+    /* No protocol until the rings are set up, so nothing is queued. */
+    fd = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION,
+                   &version, sizeof version)) {
+        goto error;
+    }
+
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = PKT_RX_BLOCK_SIZE;
+    req.tp_block_nr = PKT_RX_BLOCK_NR;
+    req.tp_frame_size = TPACKET_ALIGNMENT << 7;
+    req.tp_frame_nr = PKT_RX_RING_SIZE / req.tp_frame_size;
+    req.tp_retire_blk_tov = PKT_RX_RETIRE_TOV_MS;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req)) {
+        goto error;
+    }
+
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = PKT_TX_BLOCK_SIZE;
+    req.tp_block_nr = PKT_TX_BLOCK_NR;
+    req.tp_frame_size = PKT_TX_FRAME_SIZE;
+    req.tp_frame_nr = PKT_TX_FRAME_NR;
+    *tx_ring = !setsockopt(fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof req);
+    if (!*tx_ring) {
+        VLOG_WARN("No TPACKET_V3 Tx ring on %s, sending without it. "
+                  "Error(%d) - %s", if_name, errno, strerror(errno));
+    }
+
+    map = mmap(NULL, pkt_ring_size(*tx_ring),
+               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        goto error;
+    }
+
+    memset(&sll, 0, sizeof sll);
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex = ifindex;
+    if (bind(fd, (struct sockaddr *)&sll, sizeof sll)) {
+        error = errno;
+        munmap(map, pkt_ring_size(*tx_ring));
+        close(fd);
+        return -error;
+    }
+
+    *ring = map;
+    return fd;
+
+error:
+    error = errno;
+    close(fd);
+    return -error;
+}
+
+static int
+pkt_if_create(struct xpliant_dev *xp_dev, char *name,
+              xpsInterfaceId_t xps_if_id,
+              struct ether_addr *mac, int *host_if_id)
+{
+    char if_name[IFNAMSIZ];
+    char peer_name[IFNAMSIZ];
+    struct pkt_info *info;
+    struct pkt_if_entry *if_entry;
+    struct xp_nl_batch *batch;
+    struct epoll_event event;
+    uint8_t *ring;
+    bool tx_ring;
+    int err;
+    int fd;
+
+    ovs_assert(xp_dev);
+    ovs_assert(xp_dev->host_if_info);
+
+    info = (struct pkt_info *)xp_dev->host_if_info->data;
+    if (!info) {
+        VLOG_ERR("Host IF not initialized for %d device.", xp_dev->id);
+        return EFAULT;
+    }
+
+    snprintf(if_name, IFNAMSIZ, "%s", name);
+    snprintf(peer_name, IFNAMSIZ, "%.*s%s",
+             (int)(IFNAMSIZ - sizeof PKT_PEER_SUFFIX), name, PKT_PEER_SUFFIX);
+
+    batch = ops_xp_nl_batch_create();
+    err = ops_xp_nl_batch_veth(batch, true, if_name, peer_name);
+    if (!err) {
+        err = ops_xp_nl_batch_commit(batch);
+    }
+    if (!err) {
+        err = ops_xp_nl_batch_link(batch, peer_name, NULL, true);
+    }
+    if (!err) {
+        err = ops_xp_nl_batch_commit(batch);
+    }
+    ops_xp_nl_batch_destroy(batch);
+
+    if (err) {
+        VLOG_ERR("Unable to create %s device. %s",
+                 if_name, ovs_strerror(err));
+        return EFAULT;
+    }
+
+    if (0 != ops_xp_net_if_setup(if_name, mac)) {
+        VLOG_ERR("Unable to setup %s interface.", if_name);
+        goto error;
+    }
+
+    fd = pkt_socket_open(peer_name, &ring, &tx_ring);
+    if (fd < 0) {
+        VLOG_ERR("Unable to open packet socket on %s. %s",
+                 peer_name, ovs_strerror(-fd));
+        goto error;
+    }
+
+    *host_if_id = fd;
+
+    if_entry = xzalloc(sizeof(*if_entry));
+    ops_xp_host_if_entry_init(&if_entry->up, xps_if_id, fd, if_name);
+    if_entry->peer_name = xstrdup(peer_name);
+    if_entry->ring = ring;
+    if_entry->tx_ring = tx_ring;
+    ovs_mutex_init(&if_entry->tx_mutex);
+    ops_xp_host_if_table_insert(&info->ifs, &if_entry->up);
+
+    /* Start listening to the interface. */
+    event.events = EPOLLIN;
+    event.data.ptr = if_entry;
+    if (epoll_ctl(info->epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+        VLOG_ERR("Unable to listen to %s interface. Error(%d) - %s",
+                 peer_name, errno, strerror(errno));
+    }
+
+    return 0;
+
+error:
+    batch = ops_xp_nl_batch_create();
+    if (!ops_xp_nl_batch_veth(batch, false, if_name, peer_name)) {
+        ops_xp_nl_batch_commit(batch);
+    }
+    ops_xp_nl_batch_destroy(batch);
+
+    return EFAULT;
+}
+
+static int
+pkt_if_delete(struct xpliant_dev *xp_dev, int host_if_id)
+{
+    struct pkt_info *info;
+    struct xp_host_if_entry *e;
+    struct pkt_if_entry *if_entry;
+    struct xp_nl_batch *batch;
+
+    ovs_assert(xp_dev);
+    ovs_assert(xp_dev->host_if_info);
+
+    info = (struct pkt_info *)xp_dev->host_if_info->data;
+    if (!info) {
+        VLOG_ERR("Host IF not initialized for %d device.", xp_dev->id);
+        return EFAULT;
+    }
+
+    if (host_if_id <= 0) {
+        VLOG_ERR("Invalid host interface ID %d specified.", host_if_id);
+        return EINVAL;
+    }
+
+    e = ops_xp_host_if_table_remove(&info->ifs, host_if_id);
+    if (!e) {
+        return ENOENT;
+    }
+    if_entry = CONTAINER_OF(e, struct pkt_if_entry, up);
+
+    /* Stop listening to the interface. */
+    epoll_ctl(info->epoll_fd, EPOLL_CTL_DEL, e->fd, NULL);
+
+    /* Removing one end of veth pair removes the other one as well. */
+    batch = ops_xp_nl_batch_create();
+    if (!ops_xp_nl_batch_veth(batch, false, e->name,
+                              if_entry->peer_name)) {
+        ops_xp_nl_batch_commit(batch);
+    }
+    ops_xp_nl_batch_destroy(batch);
+
+    /* Listener and receive queue workers may still hold the entry. The
+     * socket and rings go away along with it. */
+    ovsrcu_postpone(pkt_if_entry_free, if_entry);
+
+    return 0;
+}
+
+static void
+pkt_if_entry_free(struct pkt_if_entry *if_entry)
+{
+    munmap(if_entry->ring, pkt_ring_size(if_entry->tx_ring));
+    ops_xp_host_if_entry_destroy(&if_entry->up);
+    ovs_mutex_destroy(&if_entry->tx_mutex);
+    free(if_entry->peer_name);
+    free(if_entry);
+}
+
+static int
+pkt_if_filter_create(char *name, struct xpliant_dev *xp_dev,
+                     xpsInterfaceId_t xps_if_id,
+                     int host_if_id, int *host_filter_id)
+{
+    struct pkt_info *info;
+
+    ovs_assert(xp_dev);
+    ovs_assert(xp_dev->host_if_info);
+
+    info = (struct pkt_info *)xp_dev->host_if_info->data;
+    if (!info) {
+        VLOG_ERR("Host IF not initialized for %d device.", xp_dev->id);
+        return EFAULT;
+    }
+
+    return ops_xp_host_if_table_filter_create(&info->ifs, xps_if_id,
+                                              host_if_id, host_filter_id);
+}
+
+static int
+pkt_if_filter_delete(struct xpliant_dev *xp_dev, int host_filter_id)
+{
+    struct pkt_info *info;
+
+    ovs_assert(xp_dev);
+    ovs_assert(xp_dev->host_if_info);
+
+    info = (struct pkt_info *)xp_dev->host_if_info->data;
+    if (!info) {
+        VLOG_ERR("Host IF not initialized for %d device.", xp_dev->id);
+        return EFAULT;
+    }
+
+    return ops_xp_host_if_table_filter_delete(&info->ifs, host_filter_id);
+}
+
+static int
+pkt_if_control_id_set(struct xpliant_dev *xp_dev,
+                      xpsInterfaceId_t xps_if_id,
+                      int host_if_id, bool set)
+{
+    struct pkt_info *info;
+
+    ovs_assert(xp_dev);
+    ovs_assert(xp_dev->host_if_info);
+
+    info = (struct pkt_info *)xp_dev->host_if_info->data;
+    if (!info) {
+        VLOG_ERR("Host IF not initialized for %d device.", xp_dev->id);
+        return EFAULT;
+    }
+
+    return ops_xp_host_if_table_control_id_set(&info->ifs, xp_dev->id,
+                                               xps_if_id, host_if_id, set);
+}
+
+/* Sends packet of @size bytes at @data, sent by kernel through host
+ * interface of @if_entry, to its port. */
+static void
+pkt_if_send(struct pkt_info *info, struct pkt_if_entry *if_entry,
+            const uint8_t *data, uint32_t size)
+{
+    xpsInterfaceId_t egress_if_id;
+    struct xp_tx_buf *tx_buf;
+    bool filter_created;
+
+    atomic_read_relaxed(&if_entry->up.filter_created, &filter_created);
+    if (!filter_created) {
+        return;
+    }
+    atomic_read_relaxed(&if_entry->up.send_if_id, &egress_if_id);
+
+    tx_buf = ops_xp_dev_tx_buf_get(info->dev_id);
+    if (!tx_buf) {
+        return;
+    }
+
+    if (size > tx_buf->room) {
+        VLOG_WARN_RL(&rl, "%s, Dropping packet of %u bytes from %s",
+                     __FUNCTION__, size, if_entry->up.name);
+        ops_xp_dev_tx_buf_put(info->dev_id, tx_buf);
+        return;
+    }
+
+    VLOG_DBG("%s, Received packet of %u bytes (dst MAC: "
+             ETH_ADDR_FMT") on host interface %u.",
+             __FUNCTION__, size, ETH_ADDR_BYTES_ARGS(data), egress_if_id);
+
+    /* The ring is shared with kernel, so the packet is copied into a Tx
+     * buffer which has room for the Tx header. */
+    memcpy(tx_buf->data, data, size);
+    tx_buf->size = size;
+    ops_xp_dev_send_buf(info->dev_id, egress_if_id, tx_buf);
+}
+
+/* Sends packets of all Rx ring blocks kernel has handed over on host
+ * interface of @if_entry, then gives the blocks back. */
+static void
+pkt_if_recv(struct pkt_info *info, struct pkt_if_entry *if_entry)
+{
+    int n;
+
+    for (n = 0; n < PKT_RX_BLOCK_NR; n++) {
+        struct tpacket_block_desc *bd;
+        struct tpacket3_hdr *hdr;
+        uint32_t i;
+
+        bd = (struct tpacket_block_desc *)
+             (if_entry->ring + if_entry->rx_block * PKT_RX_BLOCK_SIZE);
+        if (!(bd->hdr.bh1.block_status & TP_STATUS_USER)) {
+            return;
+        }
+        atomic_thread_fence(memory_order_acquire);
+
+        hdr = (struct tpacket3_hdr *)
+              ((uint8_t *)bd + bd->hdr.bh1.offset_to_first_pkt);
+        for (i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+            struct sockaddr_ll *sll;
+
+            /* Packets the plugin sent through the Tx ring show up as
+             * outgoing ones. */
+            sll = (struct sockaddr_ll *)
+                  ((uint8_t *)hdr + TPACKET_ALIGN(sizeof *hdr));
+            if (sll->sll_pkttype != PACKET_OUTGOING) {
+                pkt_if_send(info, if_entry, (uint8_t *)hdr + hdr->tp_mac,
+                            hdr->tp_snaplen);
+            }
+            hdr = (struct tpacket3_hdr *)
+                  ((uint8_t *)hdr + hdr->tp_next_offset);
+        }
+
+        atomic_thread_fence(memory_order_release);
+        bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        if_entry->rx_block = (if_entry->rx_block + 1) % PKT_RX_BLOCK_NR;
+    }
+}
+
+/* Handles packets received from host interfaces. */
+static void *
+pkt_listener(void *arg)
+{
+    struct pkt_info *info = arg;
+    struct epoll_event events[PKT_EPOLL_EVENTS];
+
+    /* Handling loop. */
+    while (1) {
+        int n_events;
+        int i;
+
+        /* Deleted entries are freed only while the listener waits, so
+         * entries of returned events stay valid until the next wait. */
+        ovsrcu_quiesce_start();
+        n_events = epoll_wait(info->epoll_fd, events, PKT_EPOLL_EVENTS, -1);
+        ovsrcu_quiesce_end();
+
+        if (n_events < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            VLOG_ERR("%s: Epoll wait failed. Error(%d) - %s",
+                     __FUNCTION__, errno, strerror(errno));
+            return NULL;
+        }
+
+        for (i = 0; i < n_events; i++) {
+            struct pkt_if_entry *if_entry = events[i].data.ptr;
+
+            if (!if_entry) {
+                VLOG_INFO("AF_PACKET listener thread finished.");
+                return NULL;
+            }
+
+            pkt_if_recv(info, if_entry);
+        }
+    } /* while (1) */
+
+    return NULL;
+}
+
+static XP_STATUS
+pkt_packet_driver_cb(xpsDevice_t devId, xpsPort_t portNum,
+                     void *buf, uint16_t buf_size, void *userData)
+{
+    struct xpliant_dev *dev = (struct xpliant_dev *)userData;
+    struct xp_host_if_port_map *port_map;
+    struct pkt_info *info;
+
+    if (!dev || !dev->host_if_info || !dev->host_if_info->data) {
+        return XP_ERR_INVALID_PARAMS;
+    }
+
+    info = (struct pkt_info *)dev->host_if_info->data;
+
+    /* If no host interface is attached then silently ignore the packet */
+    port_map = ops_xp_host_if_table_port_map(&info->ifs);
+    if (portNum >= XP_MAX_TOTAL_PORTS || !port_map->entries[portNum]) {
+        return XP_NO_ERR;
+    }
+
+    ops_xp_host_rxq_enqueue(info->rxqs, portNum, buf, buf_size);
+
+    return XP_NO_ERR;
+}
+
+/* Places packet of @size bytes at @data into the next frame of Tx ring
+ * of @if_entry. Returns false if the ring is full. */
+static bool
+pkt_if_tx_put(struct pkt_if_entry *if_entry, const uint8_t *data,
+              uint16_t size)
+    OVS_REQUIRES(if_entry->tx_mutex)
+{
+    unsigned int frame = if_entry->tx_frame;
+    struct tpacket3_hdr *hdr;
+
+    hdr = (struct tpacket3_hdr *)
+          (if_entry->ring + PKT_RX_RING_SIZE
+           + (frame / PKT_TX_FRAMES_PER_BLOCK) * PKT_TX_BLOCK_SIZE
+           + (frame % PKT_TX_FRAMES_PER_BLOCK) * PKT_TX_FRAME_SIZE);
+
+    if (hdr->tp_status & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) {
+        return false;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    memcpy((uint8_t *)hdr + TPACKET3_HDRLEN - sizeof(struct sockaddr_ll),
+           data, size);
+    hdr->tp_len = size;
+    hdr->tp_next_offset = 0;
+
+    atomic_thread_fence(memory_order_release);
+    hdr->tp_status = TP_STATUS_SEND_REQUEST;
+
+    if_entry->tx_frame = (frame + 1) % PKT_TX_FRAME_NR;
+
+    return true;
+}
+
+/* Has kernel send the frames queued in Tx ring of @if_entry. */
+static void
+pkt_if_tx_kick(struct pkt_if_entry *if_entry)
+{
+    if (sendto(if_entry->up.fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0
+        && errno != EAGAIN && errno != ENOBUFS) {
+        VLOG_ERR_RL(&rl, "%s, Unable to send packets to %s. "
+                    "Error(%d) - %s", __FUNCTION__, if_entry->up.name,
+                    errno, strerror(errno));
+    }
+}
+
+/* Sends packet of @size bytes at @data through socket of @if_entry
+ * which has no Tx ring. Returns false if the packet is dropped. */
+static bool
+pkt_if_tx_send(struct pkt_if_entry *if_entry, const uint8_t *data,
+               uint16_t size)
+{
+    int ret;
+
+    do {
+        ret = send(if_entry->up.fd, data, size, MSG_DONTWAIT);
+    } while ((ret < 0) && (errno == EINTR));
+
+    if (ret < 0) {
+        VLOG_WARN_RL(&rl, "%s, Unable to send packet to %s. "
+                     "Error(%d) - %s", __FUNCTION__, if_entry->up.name,
+                     errno, strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+/* Writes packets of a receive queue into Tx rings of host interfaces.
+ * Kernel is kicked once per run of packets of the same interface.
+ * Interfaces without Tx ring get one send per packet. */
+static void
+pkt_rxq_deliver(void *aux, struct xp_rxq_pkt **pkts, size_t n)
+{
+    struct pkt_info *info = aux;
+    struct xp_host_if_port_map *port_map;
+    struct pkt_if_entry *if_entry;
+    struct pkt_if_entry *pending = NULL;
+    size_t i;
+
+    port_map = ops_xp_host_if_table_port_map(&info->ifs);
+
+    for (i = 0; i < n; i++) {
+        bool queued;
+
+        /* Interface may be gone since the packet was queued. */
+        if (!port_map->entries[pkts[i]->port]) {
+            continue;
+        }
+        if_entry = CONTAINER_OF(port_map->entries[pkts[i]->port],
+                                struct pkt_if_entry, up);
+
+        if (!if_entry->tx_ring) {
+            if (!pkt_if_tx_send(if_entry, pkts[i]->data, pkts[i]->size)) {
+                ovs_mutex_lock(&if_entry->tx_mutex);
+                if_entry->tx_drops++;
+                ovs_mutex_unlock(&if_entry->tx_mutex);
+            }
+            continue;
+        }
+
+        if (pending && pending != if_entry) {
+            pkt_if_tx_kick(pending);
+        }
+        pending = if_entry;
+
+        ovs_mutex_lock(&if_entry->tx_mutex);
+        queued = pkt_if_tx_put(if_entry, pkts[i]->data, pkts[i]->size);
+        if (!queued) {
+            if_entry->tx_drops++;
+        }
+        ovs_mutex_unlock(&if_entry->tx_mutex);
+
+        if (!queued) {
+            VLOG_WARN_RL(&rl, "%s, Tx ring of %s is full, dropping packet",
+                         __FUNCTION__, if_entry->up.name);
+        }
+    }
+
+    if (pending) {
+        pkt_if_tx_kick(pending);
+    }
+}
@@ -0,0 +1,521 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-host-rxq.c
+ *
+ * Purpose: This file contains CPU receive queues of host interfaces for
+ *          the Cavium/XPliant SDK. Trapped packets are sorted into queues
+ *          by class, each queue is delivered by its own worker thread.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <openvswitch/vlog.h>
+#include "dynamic-string.h"
+#include "latch.h"
+#include "ovs-rcu.h"
+#include "ovs-thread.h"
+#include "packets.h"
+#include "poll-loop.h"
+#include "unixctl.h"
+#include "util.h"
+
+#include "ops-xp-host-rxq.h"
+#include "ops-xp-copp.h"
+#include "ops-xp-dev.h"
+#include "ops-xp-util.h"
+
+VLOG_DEFINE_THIS_MODULE(xp_host_rxq);
+
+/* Packets waiting in a queue before new ones are dropped, and packets
+ * handed to the deliver callback at once */
+#define XP_RXQ_DEPTH                512
+#define XP_RXQ_BATCH                32
+
+/* Packets of up to this size are copied into buffers preallocated for
+ * each queue, larger ones into allocated buffers. The pool covers a full
+ * queue and a batch being delivered. */
+#define XP_RXQ_BUF_SIZE             2048
+#define XP_RXQ_POOL_SIZE            (XP_RXQ_DEPTH + XP_RXQ_BATCH)
+#define XP_RXQ_POOL_STRIDE          (sizeof(struct xp_rxq_pkt) + \
+                                     XP_RXQ_BUF_SIZE)
+
+/* L4 ports of control protocols */
+#define XP_RXQ_BGP_PORT             179
+#define XP_RXQ_BFD_PORT             3784
+#define XP_RXQ_BFD_MHOP_PORT        4784
+
+/* IP protocols of control protocols */
+#define XP_RXQ_IPPROTO_OSPF         89
+#define XP_RXQ_IPPROTO_VRRP         112
+
+/* Classes of packets trapped to CPU. Each class has its own queue. */
+enum xp_rxq_class {
+    XP_RXQ_BPDU,        /* STP, LACP, LLDP and other IEEE link-local. */
+    XP_RXQ_ARP,         /* ARP and IPv6 neighbor discovery. */
+    XP_RXQ_CONTROL,     /* Routing and redundancy protocols. */
+    XP_RXQ_TTL,         /* IP packets with expiring TTL. */
+    XP_RXQ_IP,          /* Other IP packets, routed or sent to CPU. */
+    XP_RXQ_OTHER,
+    XP_RXQ_MAX
+};
+
+static const char *const xp_rxq_names[XP_RXQ_MAX] = {
+    "bpdu", "arp", "control", "ttl", "ip", "other"
+};
+
+struct xp_rxq_set;
+
+struct xp_rxq {
+    struct xp_rxq_set *set;
+    struct ovs_mutex mutex;
+    struct ovs_list pending OVS_GUARDED;    /* Contains "struct xp_rxq_pkt"s. */
+    size_t n_pending OVS_GUARDED;
+    struct ovs_list free_bufs OVS_GUARDED;  /* Unused pool buffers. */
+    uint8_t *pool;                          /* XP_RXQ_POOL_SIZE buffers. */
+    uint64_t received OVS_GUARDED;          /* Packets queued. */
+    uint64_t delivered OVS_GUARDED;         /* Packets passed to deliver. */
+    uint64_t drops OVS_GUARDED;             /* Packets dropped on full queue. */
+    struct latch latch;                     /* Kicks the worker. */
+    pthread_t thread;
+};
+
+/* Receive queues of a device. */
+struct xp_rxq_set {
+    xpsDevice_t dev_id;
+    xp_rxq_deliver_cb *deliver;
+    void *aux;
+    struct latch exit_latch;
+    struct xp_rxq queues[XP_RXQ_MAX];
+};
+
+static struct ovs_mutex rxq_mutex = OVS_MUTEX_INITIALIZER;
+
+/* Receive queues by device, for unixctl. */
+static struct xp_rxq_set *rxq_sets[XP_MAX_DEVICES] OVS_GUARDED_BY(rxq_mutex);
+
+/* CPU the worker of each class is bound to, -1 if not bound. */
+static int rxq_cpus[XP_RXQ_MAX] OVS_GUARDED_BY(rxq_mutex) = {
+    [0 ... XP_RXQ_MAX - 1] = -1
+};
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+
+/* Returns class of the Ethernet frame of @size bytes at @pkt. The
+ * hardware reason code is not passed with trapped packets, so the class
+ * is derived from the headers. */
+static enum xp_rxq_class
+xp_rxq_classify(const uint8_t *pkt, size_t size)
+{
+    struct xp_pkt_hdrs hdrs;
+    uint8_t proto;
+
+    if (!ops_xp_pkt_parse(pkt, size, &hdrs)) {
+        return XP_RXQ_OTHER;
+    }
+
+    if (hdrs.link_local || hdrs.eth_type == ETH_TYPE_LACP) {
+        return XP_RXQ_BPDU;
+    }
+
+    if (hdrs.eth_type == ETH_TYPE_ARP || hdrs.eth_type == ETH_TYPE_RARP) {
+        return XP_RXQ_ARP;
+    }
+
+    if (!hdrs.ip) {
+        return XP_RXQ_OTHER;
+    }
+
+    proto = hdrs.ip_proto;
+
+    /* Neighbor discovery is always sent with hop limit of 255 */
+    if (hdrs.eth_type == ETH_TYPE_IPV6 && proto == IPPROTO_ICMPV6 &&
+        hdrs.ip_ttl == 255) {
+        return XP_RXQ_ARP;
+    }
+
+    /* Control protocols are often sent with TTL of 1, so those are told
+     * apart before TTL is checked. */
+    if (proto == IPPROTO_IGMP || proto == IPPROTO_PIM ||
+        proto == XP_RXQ_IPPROTO_OSPF || proto == XP_RXQ_IPPROTO_VRRP) {
+        return XP_RXQ_CONTROL;
+    }
+
+    if (hdrs.l4_ports) {
+        if (proto == IPPROTO_TCP) {
+            if (hdrs.src_port == XP_RXQ_BGP_PORT ||
+                hdrs.dst_port == XP_RXQ_BGP_PORT) {
+                return XP_RXQ_CONTROL;
+            }
+        } else if (hdrs.dst_port == XP_RXQ_BFD_PORT ||
+                   hdrs.dst_port == XP_RXQ_BFD_MHOP_PORT) {
+            return XP_RXQ_CONTROL;
+        }
+    }
+
+    return hdrs.ip_ttl <= 1 ? XP_RXQ_TTL : XP_RXQ_IP;
+}
+
+/* Binds worker of @rxq to @cpu, or lets it run on any CPU if @cpu is
+ * negative. Returns 0 on success, otherwise errno. */
+static int
+xp_rxq_affinity_set(struct xp_rxq *rxq, int cpu)
+{
+    cpu_set_t cpus;
+    int i;
+
+    CPU_ZERO(&cpus);
+    if (cpu < 0) {
+        for (i = 0; i < CPU_SETSIZE; i++) {
+            CPU_SET(i, &cpus);
+        }
+    } else if (cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &cpus);
+    } else {
+        return EINVAL;
+    }
+
+    return pthread_setaffinity_np(rxq->thread, sizeof cpus, &cpus);
+}
+
+/* Returns a buffer for a packet of @size bytes, from the pool of @rxq if
+ * it fits. Returns NULL if the pool has run out. */
+static struct xp_rxq_pkt *
+xp_rxq_pkt_alloc(struct xp_rxq *rxq, uint16_t size)
+    OVS_REQUIRES(rxq->mutex)
+{
+    struct xp_rxq_pkt *pkt;
+
+    if (size > XP_RXQ_BUF_SIZE) {
+        pkt = xmalloc(sizeof *pkt + size);
+        pkt->pooled = false;
+        return pkt;
+    }
+
+    if (list_is_empty(&rxq->free_bufs)) {
+        return NULL;
+    }
+
+    pkt = CONTAINER_OF(list_pop_front(&rxq->free_bufs), struct xp_rxq_pkt,
+                       list_node);
+    pkt->pooled = true;
+    return pkt;
+}
+
+static void
+xp_rxq_pkt_free(struct xp_rxq *rxq, struct xp_rxq_pkt *pkt)
+    OVS_REQUIRES(rxq->mutex)
+{
+    if (pkt->pooled) {
+        list_push_back(&rxq->free_bufs, &pkt->list_node);
+    } else {
+        free(pkt);
+    }
+}
+
+/* Passes packets of a queue to the deliver callback in batches. */
+static void *
+xp_rxq_worker(void *arg)
+{
+    struct xp_rxq *rxq = arg;
+    struct xp_rxq_set *set = rxq->set;
+    struct xp_rxq_pkt *batch[XP_RXQ_BATCH];
+
+    while (!latch_is_set(&set->exit_latch)) {
+        size_t n = 0;
+        size_t i;
+
+        ovs_mutex_lock(&rxq->mutex);
+        while (n < XP_RXQ_BATCH && !list_is_empty(&rxq->pending)) {
+            batch[n++] = CONTAINER_OF(list_pop_front(&rxq->pending),
+                                      struct xp_rxq_pkt, list_node);
+            rxq->n_pending--;
+        }
+        ovs_mutex_unlock(&rxq->mutex);
+
+        if (!n) {
+            latch_wait(&set->exit_latch);
+            latch_wait(&rxq->latch);
+            poll_block();
+            latch_poll(&rxq->latch);
+            continue;
+        }
+
+        set->deliver(set->aux, batch, n);
+
+        ovs_mutex_lock(&rxq->mutex);
+        rxq->delivered += n;
+        for (i = 0; i < n; i++) {
+            xp_rxq_pkt_free(rxq, batch[i]);
+        }
+        ovs_mutex_unlock(&rxq->mutex);
+
+        /* The queue may stay busy for long, the worker never blocks then */
+        ovsrcu_quiesce();
+    }
+
+    return NULL;
+}
+
+/* Creates receive queues of device @dev_id and starts their workers.
+ * Packets are passed to @deliver along with @aux. */
+struct xp_rxq_set *
+ops_xp_host_rxq_create(xpsDevice_t dev_id, xp_rxq_deliver_cb *deliver,
+                       void *aux)
+{
+    struct xp_rxq_set *set;
+    int i, j;
+
+    ovs_assert(dev_id < XP_MAX_DEVICES);
+
+    set = xzalloc(sizeof *set);
+    set->dev_id = dev_id;
+    set->deliver = deliver;
+    set->aux = aux;
+    latch_init(&set->exit_latch);
+
+    ovs_mutex_lock(&rxq_mutex);
+    for (i = 0; i < XP_RXQ_MAX; i++) {
+        struct xp_rxq *rxq = &set->queues[i];
+        char name[32];
+
+        rxq->set = set;
+        ovs_mutex_init(&rxq->mutex);
+        list_init(&rxq->pending);
+        latch_init(&rxq->latch);
+
+        list_init(&rxq->free_bufs);
+        rxq->pool = xmalloc(XP_RXQ_POOL_SIZE * XP_RXQ_POOL_STRIDE);
+        for (j = 0; j < XP_RXQ_POOL_SIZE; j++) {
+            struct xp_rxq_pkt *pkt;
+
+            pkt = (struct xp_rxq_pkt *) &rxq->pool[j * XP_RXQ_POOL_STRIDE];
+            list_push_back(&rxq->free_bufs, &pkt->list_node);
+        }
+
+        snprintf(name, sizeof name, "ops-xp-rxq-%s", xp_rxq_names[i]);
+        rxq->thread = ovs_thread_create(name, xp_rxq_worker, rxq);
+
+        if (rxq_cpus[i] >= 0 && xp_rxq_affinity_set(rxq, rxq_cpus[i])) {
+            VLOG_WARN("Unable to bind %s receive queue to CPU %d",
+                      xp_rxq_names[i], rxq_cpus[i]);
+        }
+    }
+    rxq_sets[dev_id] = set;
+    ovs_mutex_unlock(&rxq_mutex);
+
+    VLOG_INFO("Device #%u receive queue workers started", dev_id);
+
+    return set;
+}
+
+/* Stops the workers and frees @set. Packets still queued are dropped. */
+void
+ops_xp_host_rxq_destroy(struct xp_rxq_set *set)
+{
+    struct xp_rxq_pkt *pkt;
+    int i;
+
+    if (!set) {
+        return;
+    }
+
+    ovs_mutex_lock(&rxq_mutex);
+    rxq_sets[set->dev_id] = NULL;
+    ovs_mutex_unlock(&rxq_mutex);
+
+    latch_set(&set->exit_latch);
+    for (i = 0; i < XP_RXQ_MAX; i++) {
+        xpthread_join(set->queues[i].thread, NULL);
+    }
+
+    for (i = 0; i < XP_RXQ_MAX; i++) {
+        struct xp_rxq *rxq = &set->queues[i];
+
+        ovs_mutex_lock(&rxq->mutex);
+        LIST_FOR_EACH_POP (pkt, list_node, &rxq->pending) {
+            xp_rxq_pkt_free(rxq, pkt);
+        }
+        ovs_mutex_unlock(&rxq->mutex);
+
+        free(rxq->pool);
+        latch_destroy(&rxq->latch);
+        ovs_mutex_destroy(&rxq->mutex);
+    }
+
+    latch_destroy(&set->exit_latch);
+    free(set);
+}
+
+/* Copies packet of @size bytes at @buf received on @port to its receive
+ * queue. Returns ENOBUFS if the queue is full, EAGAIN if the packet
+ * exceeds CPU policer rates. Packets dropped by the queue are not charged
+ * to the policers. */
+int
+ops_xp_host_rxq_enqueue(struct xp_rxq_set *set, xpsPort_t port,
+                        const void *buf, uint16_t size)
+{
+    struct xp_rxq *rxq;
+    struct xp_rxq_pkt *pkt;
+    bool kick;
+
+    rxq = &set->queues[xp_rxq_classify(buf, size)];
+
+    ovs_mutex_lock(&rxq->mutex);
+    pkt = rxq->n_pending < XP_RXQ_DEPTH ? xp_rxq_pkt_alloc(rxq, size) : NULL;
+    if (!pkt) {
+        rxq->drops++;
+        ovs_mutex_unlock(&rxq->mutex);
+        VLOG_WARN_RL(&rl, "Receive queue %s is full, dropping packet "
+                     "from port %u", xp_rxq_names[rxq - set->queues], port);
+        return ENOBUFS;
+    }
+    ovs_mutex_unlock(&rxq->mutex);
+
+    if (!ops_xp_copp_police(set->dev_id, port, buf, size)) {
+        ovs_mutex_lock(&rxq->mutex);
+        xp_rxq_pkt_free(rxq, pkt);
+        ovs_mutex_unlock(&rxq->mutex);
+        return EAGAIN;
+    }
+
+    pkt->port = port;
+    pkt->size = size;
+    memcpy(pkt->data, buf, size);
+
+    ovs_mutex_lock(&rxq->mutex);
+    /* The worker only sleeps on an empty queue */
+    kick = !rxq->n_pending;
+    list_push_back(&rxq->pending, &pkt->list_node);
+    rxq->n_pending++;
+    rxq->received++;
+    ovs_mutex_unlock(&rxq->mutex);
+
+    if (kick) {
+        latch_set(&rxq->latch);
+    }
+
+    return 0;
+}
+
+static void
+xp_rxq_unixctl_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                    const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds d_str = DS_EMPTY_INITIALIZER;
+    int id, i;
+
+    ovs_mutex_lock(&rxq_mutex);
+    for (id = 0; id < XP_MAX_DEVICES; id++) {
+        struct xp_rxq_set *set = rxq_sets[id];
+
+        if (!set) {
+            continue;
+        }
+
+        ds_put_format(&d_str, "Device #%d\n", id);
+        ds_put_format(&d_str, "  %-9s%-5s%-8s%-16s%-16s%-16s\n", "Queue",
+                      "CPU", "Queued", "Received", "Delivered", "Drops");
+        for (i = 0; i < XP_RXQ_MAX; i++) {
+            struct xp_rxq *rxq = &set->queues[i];
+
+            ds_put_format(&d_str, "  %-9s", xp_rxq_names[i]);
+            if (rxq_cpus[i] >= 0) {
+                ds_put_format(&d_str, "%-5d", rxq_cpus[i]);
+            } else {
+                ds_put_format(&d_str, "%-5s", "any");
+            }
+
+            ovs_mutex_lock(&rxq->mutex);
+            ds_put_format(&d_str, "%-8"PRIuSIZE"%-16"PRIu64"%-16"PRIu64
+                          "%-16"PRIu64"\n", rxq->n_pending, rxq->received,
+                          rxq->delivered, rxq->drops);
+            ovs_mutex_unlock(&rxq->mutex);
+        }
+    }
+    ovs_mutex_unlock(&rxq_mutex);
+
+    unixctl_command_reply(conn, ds_cstr(&d_str));
+    ds_destroy(&d_str);
+}
+
+static void
+xp_rxq_unixctl_affinity(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                        const char *argv[], void *aux OVS_UNUSED)
+{
+    unsigned int cpu_arg;
+    int class, cpu, id;
+    int error = 0;
+
+    for (class = 0; class < XP_RXQ_MAX; class++) {
+        if (!strcmp(argv[1], xp_rxq_names[class])) {
+            break;
+        }
+    }
+    if (class == XP_RXQ_MAX) {
+        unixctl_command_reply_error(conn, "Unknown receive queue");
+        return;
+    }
+
+    if (!strcmp(argv[2], "any")) {
+        cpu = -1;
+    } else if (str_to_uint(argv[2], 10, &cpu_arg) && cpu_arg < CPU_SETSIZE) {
+        cpu = cpu_arg;
+    } else {
+        unixctl_command_reply_error(conn, "Invalid CPU");
+        return;
+    }
+
+    ovs_mutex_lock(&rxq_mutex);
+    for (id = 0; id < XP_MAX_DEVICES && !error; id++) {
+        if (rxq_sets[id]) {
+            error = xp_rxq_affinity_set(&rxq_sets[id]->queues[class], cpu);
+        }
+    }
+    if (!error) {
+        rxq_cpus[class] = cpu;
+    }
+    ovs_mutex_unlock(&rxq_mutex);
+
+    if (error) {
+        unixctl_command_reply_error(conn, ovs_strerror(error));
+        return;
+    }
+
+    unixctl_command_reply(conn, NULL);
+}
+
+void
+ops_xp_host_rxq_unixctl_init(void)
+{
+    static bool registered;
+    if (registered) {
+        return;
+    }
+    registered = true;
+
+    unixctl_command_register("xp/host/rxq-show", "", 0, 0,
+                             xp_rxq_unixctl_show, NULL);
+    unixctl_command_register("xp/host/rxq-affinity", "queue cpu|any", 2, 2,
+                             xp_rxq_unixctl_affinity, NULL);
+}
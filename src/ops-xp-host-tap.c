@@ -30,11 +30,17 @@
 #include <openvswitch/vlog.h>
 #include <netinet/ether.h>
 #include <time.h>
+#include <sys/epoll.h>
 #include <sys/time.h>
 
+#include "ovs-atomic.h"
+#include "ovs-rcu.h"
 #include "socket-util.h"
 #include "ops-xp-util.h"
+#include "ops-xp-netlink.h"
 #include "ops-xp-host.h"
+#include "ops-xp-host-if-table.h"
+#include "ops-xp-host-rxq.h"
 #include "ops-xp-dev.h"
 #include "ops-xp-dev-init.h"
 #include "openXpsPacketDrv.h"
@@ -43,49 +49,37 @@
 
 VLOG_DEFINE_THIS_MODULE(xp_host_tap);
 
-static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
+/* Readiness events handled per wakeup of TAP listener, and frames read
+ * from a TAP interface per readiness event */
+#define TAP_EPOLL_EVENTS        64
+#define TAP_READ_BURST          32
 
-struct tap_if_entry {
-    /* Node in a if_id_to_tap_if_map. */
-    struct hmap_node if_id_node;
-    /* Node in a fd_to_tap_if_map. */
-    struct hmap_node fd_node;
-    xpsInterfaceId_t if_id;
-    /* ID of the interface which will be used for sending. */
-    xpsInterfaceId_t send_if_id;
-    int fd;
-    char *name;
-    bool filter_created;
-};
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
 
 struct tap_info {
     xpsDevice_t dev_id;
-    /* Pipe which will notify TAP listener thread about
-     * new TAP interface added. */
-    int if_upd_fds[2];
+    /* TAP interface fds and exit pipe the listener waits on. Events of
+     * TAP fds point to their xp_host_if_entry, the exit pipe's to NULL.
+     * Entries are freed after an RCU grace period, so the listener can
+     * use them without locking. */
+    int epoll_fd;
     /* Exit pipe for TAP listener thread. */
     int exit_fds[2];
-    struct ovs_mutex mutex;
-    fd_set read_fd_set;
-    /* XPS intf ID to tap_if_entry map. */
-    struct hmap if_id_to_tap_if_map;
-    /* FD to tap_if_entry map. */
-    struct hmap fd_to_tap_if_map;
+    /* TAP interface entries. */
+    struct xp_host_if_table ifs;
     /* Listener Thread ID. */
     pthread_t listener_thread;
+    /* Queues of trapped packets on their way to TAP interfaces. */
+    struct xp_rxq_set *rxqs;
 };
 
-static struct tap_if_entry *tap_get_if_entry_by_fd(struct tap_info *tap_info,
-                                                   int fd);
-
-static struct tap_if_entry *tap_get_if_entry_by_if_id(struct tap_info *tap_info,
-                                                      xpsInterfaceId_t if_id);
-
 static void *tap_listener(void *arg);
+static void tap_if_entry_free(struct xp_host_if_entry *if_entry);
 
 static XP_STATUS tap_packet_driver_cb(xpsDevice_t devId, xpsPort_t portNum,
                                       void *buf, uint16_t buf_size,
                                       void *userData);
+static void tap_rxq_deliver(void *aux, struct xp_rxq_pkt **pkts, size_t n);
 
 static int tap_init(struct xpliant_dev *xp_dev);
 static void tap_deinit(struct xpliant_dev *xp_dev);
@@ -115,6 +109,7 @@ static int
 tap_init(struct xpliant_dev *xp_dev)
 {
     struct tap_info *info;
+    struct epoll_event event;
     XP_STATUS ret;
 
     ovs_assert(xp_dev);
@@ -123,27 +118,39 @@ tap_init(struct xpliant_dev *xp_dev)
     info = xzalloc(sizeof *info);
     info->dev_id = xp_dev->id;
 
+    info->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (info->epoll_fd < 0) {
+        VLOG_ERR("%s, Unable to create epoll instance. Error(%d) - %s",
+                 __FUNCTION__, errno, strerror(errno));
+        free(info);
+        return EFAULT;
+    }
+
+    /* Create exit pipe and add its read fd to the epoll set. */
+    xpipe(info->exit_fds);
+
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(info->epoll_fd, EPOLL_CTL_ADD, info->exit_fds[0], &event);
+
+    ops_xp_host_if_table_init(&info->ifs);
+    info->rxqs = ops_xp_host_rxq_create(xp_dev->id, tap_rxq_deliver, info);
+
     ret = xpsPacketDriverFeatureRxHndlr(XP_MAX_CPU_RX_HDLR,
                                         tap_packet_driver_cb,
                                         (void *)xp_dev);
     if (ret != XP_NO_ERR) {
         VLOG_ERR("%s, Unable to register handler of trapped packets",
                  __FUNCTION__);
+        ops_xp_host_rxq_destroy(info->rxqs);
+        ops_xp_host_if_table_destroy(&info->ifs);
+        close(info->exit_fds[0]);
+        close(info->exit_fds[1]);
+        close(info->epoll_fd);
         free(info);
         return EFAULT;
     }
 
-    /* Create control pipes and add their read fds to info->read_fd_set. */
-    xpipe(info->if_upd_fds);
-    xpipe(info->exit_fds);
-
-    FD_SET(info->if_upd_fds[0], &info->read_fd_set);
-    FD_SET(info->exit_fds[0], &info->read_fd_set);
-
-    ovs_mutex_init_recursive(&info->mutex);
-    hmap_init(&info->if_id_to_tap_if_map);
-    hmap_init(&info->fd_to_tap_if_map);
-
     info->listener_thread = ovs_thread_create("ops-xp-tap-listener",
                                               tap_listener,
                                               info);
@@ -157,8 +164,8 @@ tap_init(struct xpliant_dev *xp_dev)
 static void
 tap_deinit(struct xpliant_dev *xp_dev)
 {
-    struct tap_if_entry *e;
-    struct tap_if_entry *next;
+    struct xp_host_if_entry *e;
+    struct xp_host_if_entry *next;
     struct tap_info *info;
     XP_STATUS ret;
 
@@ -180,24 +187,23 @@ tap_deinit(struct xpliant_dev *xp_dev)
                  __FUNCTION__);
     }
 
+    /* Workers write to TAP fds, so they stop before fds are closed. */
+    ops_xp_host_rxq_destroy(info->rxqs);
+
     /* Stop VPORT listener thread. */
     ignore(write(info->exit_fds[1], "", 1));
     xpthread_join(info->listener_thread, NULL);
 
-    close(info->if_upd_fds[0]);
-    close(info->if_upd_fds[1]);
-    close(info->exit_fds[0]);
-    close(info->exit_fds[1]);
-
     /* Remove xpnet interfaces. */
-    HMAP_FOR_EACH_SAFE (e, next, fd_node, &info->fd_to_tap_if_map) {
+    HMAP_FOR_EACH_SAFE (e, next, fd_node, &info->ifs.fd_map) {
         tap_if_delete(xp_dev, e->fd);
     }
 
-    hmap_destroy(&info->if_id_to_tap_if_map);
-    hmap_destroy(&info->fd_to_tap_if_map);
+    close(info->exit_fds[0]);
+    close(info->exit_fds[1]);
+    close(info->epoll_fd);
 
-    ovs_mutex_destroy(&info->mutex);
+    ops_xp_host_if_table_destroy(&info->ifs);
 
     free(info);
 
@@ -213,7 +219,8 @@ tap_if_create(struct xpliant_dev *xp_dev, char *name,
     int fd;
     char tap_if_name[IFNAMSIZ];
     struct tap_info *info;
-    struct tap_if_entry *if_entry;
+    struct xp_host_if_entry *if_entry;
+    struct epoll_event event;
 
     ovs_assert(xp_dev);
     ovs_assert(xp_dev->host_if_info);
@@ -247,23 +254,16 @@ tap_if_create(struct xpliant_dev *xp_dev, char *name,
     *host_if_id = fd;
 
     if_entry = xzalloc(sizeof(*if_entry));
-    if_entry->if_id = xps_if_id;
-    if_entry->send_if_id = xps_if_id;
-    if_entry->fd = fd;
-    if_entry->name = xstrdup(tap_if_name);
-    if_entry->filter_created = false;
-
-    ovs_mutex_lock(&info->mutex);
-
-    hmap_insert(&info->fd_to_tap_if_map, &if_entry->fd_node, if_entry->fd);
-
-    /* Register interface fd in TAP read_fd_set. */
-    FD_SET(fd, &info->read_fd_set);
-
-    ovs_mutex_unlock(&info->mutex);
-
-    /* Notify listener thread about new TAP interface. */
-    ignore(write(info->if_upd_fds[1], "", 1));
+    ops_xp_host_if_entry_init(if_entry, xps_if_id, fd, tap_if_name);
+    ops_xp_host_if_table_insert(&info->ifs, if_entry);
+
+    /* Start listening to the interface. */
+    event.events = EPOLLIN;
+    event.data.ptr = if_entry;
+    if (epoll_ctl(info->epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+        VLOG_ERR("Unable to listen to %s interface. Error(%d) - %s",
+                 tap_if_name, errno, strerror(errno));
+    }
 
     return 0;
 }
@@ -272,7 +272,8 @@ static int
 tap_if_delete(struct xpliant_dev *xp_dev, int host_if_id)
 {
     struct tap_info *info;
-    struct tap_if_entry *if_entry;
+    struct xp_host_if_entry *if_entry;
+    struct xp_nl_batch *batch;
 
     ovs_assert(xp_dev);
     ovs_assert(xp_dev->host_if_info);
@@ -288,31 +289,32 @@ tap_if_delete(struct xpliant_dev *xp_dev, int host_if_id)
         return EINVAL;
     }
 
-    ovs_mutex_lock(&info->mutex);
-
-    if_entry = tap_get_if_entry_by_fd(info, host_if_id);
+    if_entry = ops_xp_host_if_table_remove(&info->ifs, host_if_id);
     if (!if_entry) {
-        ovs_mutex_unlock(&info->mutex);
         return ENOENT;
     }
 
-    tap_if_filter_delete(xp_dev, if_entry->if_id + 1);
-
-    hmap_remove(&info->fd_to_tap_if_map, &if_entry->fd_node);
-
-    /* Clear interface socket in TAP read_fd_set. */
-    FD_CLR(if_entry->fd, &info->read_fd_set);
+    /* Stop listening to the interface. */
+    epoll_ctl(info->epoll_fd, EPOLL_CTL_DEL, if_entry->fd, NULL);
 
-    ovs_mutex_unlock(&info->mutex);
+    batch = ops_xp_nl_batch_create();
+    if (!ops_xp_nl_batch_link(batch, if_entry->name, NULL, false)) {
+        ops_xp_nl_batch_commit(batch);
+    }
+    ops_xp_nl_batch_destroy(batch);
 
-    ops_xp_system("/sbin/ifconfig %s down", if_entry->name);
+    /* TAP listener may still hold the entry and read from its fd, so
+     * the fd is closed along with the entry. */
+    ovsrcu_postpone(tap_if_entry_free, if_entry);
 
-    free(if_entry->name);
+    return 0;
+}
 
-    close(host_if_id);
+static void
+tap_if_entry_free(struct xp_host_if_entry *if_entry)
+{
+    ops_xp_host_if_entry_destroy(if_entry);
     free(if_entry);
-
-    return 0;
 }
 
 static int
@@ -321,8 +323,6 @@ tap_if_filter_create(char *name, struct xpliant_dev *xp_dev,
                      int host_if_id, int *host_filter_id)
 {
     struct tap_info *info;
-    struct tap_if_entry *if_entry;
-    XP_STATUS status = XP_NO_ERR;
 
     ovs_assert(xp_dev);
     ovs_assert(xp_dev->host_if_info);
@@ -333,42 +333,14 @@ tap_if_filter_create(char *name, struct xpliant_dev *xp_dev,
         return EFAULT;
     }
 
-    if (host_if_id <= 0) {
-        VLOG_ERR("Invalid TAP interface ID %d specified.", host_if_id);
-        return EINVAL;
-    }
-
-    ovs_mutex_lock(&info->mutex);
-
-    if_entry = tap_get_if_entry_by_fd(info, host_if_id);
-    if (!if_entry) {
-        ovs_mutex_unlock(&info->mutex);
-        return ENOENT;
-    }
-
-    if(if_entry->filter_created)
-    {
-        /* Filter already present */
-        ovs_mutex_unlock(&info->mutex);
-        return 0;
-    }
-
-    *host_filter_id = xps_if_id + 1;
-    if_entry->filter_created = true;
-
-    hmap_insert(&info->if_id_to_tap_if_map, &if_entry->if_id_node,
-                if_entry->if_id);
-
-    ovs_mutex_unlock(&info->mutex);
-
-    return 0;
+    return ops_xp_host_if_table_filter_create(&info->ifs, xps_if_id,
+                                              host_if_id, host_filter_id);
 }
 
 static int
 tap_if_filter_delete(struct xpliant_dev *xp_dev, int host_filter_id)
 {
     struct tap_info *info;
-    struct tap_if_entry *if_entry;
 
     ovs_assert(xp_dev);
     ovs_assert(xp_dev->host_if_info);
@@ -379,26 +351,7 @@ tap_if_filter_delete(struct xpliant_dev *xp_dev, int host_filter_id)
         return EFAULT;
     }
 
-    if (host_filter_id <= 0) {
-        VLOG_ERR("Invalid TAP interface ID %d specified.", host_filter_id);
-        return EINVAL;
-    }
-
-    ovs_mutex_lock(&info->mutex);
-
-    if_entry = tap_get_if_entry_by_if_id(info, host_filter_id - 1);
-    if (!if_entry) {
-        ovs_mutex_unlock(&info->mutex);
-        return ENOENT;
-    }
-
-    hmap_remove(&info->if_id_to_tap_if_map, &if_entry->if_id_node);
-
-    if_entry->filter_created = false;
-
-    ovs_mutex_unlock(&info->mutex);
-
-    return 0;
+    return ops_xp_host_if_table_filter_delete(&info->ifs, host_filter_id);
 }
 
 static int
@@ -406,10 +359,7 @@ tap_if_control_id_set(struct xpliant_dev *xp_dev,
                       xpsInterfaceId_t xps_if_id, 
                       int host_if_id, bool set)
 {
-    xpsInterfaceType_e if_type;
-    XP_STATUS status = XP_NO_ERR;
     struct tap_info *info;
-    struct tap_if_entry *if_entry;
 
     ovs_assert(xp_dev);
     ovs_assert(xp_dev->host_if_info);
@@ -420,87 +370,73 @@ tap_if_control_id_set(struct xpliant_dev *xp_dev,
         return EFAULT;
     }
 
-    if (host_if_id <= 0) {
-        VLOG_ERR("Invalid TAP interface ID %d specified.", host_if_id);
-        return EINVAL;
-    }
-
-    ovs_mutex_lock(&info->mutex);
+    return ops_xp_host_if_table_control_id_set(&info->ifs, xp_dev->id,
+                                               xps_if_id, host_if_id, set);
+}
 
-    if_entry = tap_get_if_entry_by_fd(info, host_if_id);
-    if (!if_entry) {
-        ovs_mutex_unlock(&info->mutex);
-        return ENOENT;
-    }
+/* Sends up to TAP_READ_BURST frames waiting on TAP interface of
+ * @if_entry to its port. @buf is used if no Tx buffer is available.
+ * Frames are dropped if @drain is set. */
+static void
+tap_if_recv(struct tap_info *info, struct xp_host_if_entry *if_entry,
+            char *buf, bool drain)
+{
+    int n;
 
-    if (set) {
-        status = xpsInterfaceGetType(xps_if_id, &if_type);
-        if (status != XP_NO_ERR) {
-            ovs_mutex_unlock(&info->mutex);
-            VLOG_ERR("%s, Failed to get interface type. Error: %d", 
-                     __FUNCTION__, status);
-            return EPERM;
+    for (n = 0; n < TAP_READ_BURST; n++) {
+        xpsInterfaceId_t egress_if_id;
+        struct xp_tx_buf *tx_buf;
+        bool filter_created;
+        int bytes_recv;
+        void *data;
+
+        /* Read the packet straight into a Tx buffer, so it is
+         * sent without a copy. */
+        tx_buf = ops_xp_dev_tx_buf_get(info->dev_id);
+        data = tx_buf ? (void *)tx_buf->data : buf;
+
+        do {
+            bytes_recv = read(if_entry->fd, data, RX_MAX_FRM_LEN_MAX_VAL);
+        } while ((bytes_recv < 0) && (errno == EINTR));
+
+        if (bytes_recv <= 0) {
+            if ((bytes_recv < 0) && (errno != EWOULDBLOCK)) {
+                VLOG_WARN_RL(&rl, "%s, Read from recv socket failed. "
+                             "Error(%d) - %s",
+                             __FUNCTION__, errno, strerror(errno));
+            }
+            ops_xp_dev_tx_buf_put(info->dev_id, tx_buf);
+            return;
         }
 
-        if (if_type != XPS_PORT) {
-            ovs_mutex_unlock(&info->mutex);
-            return 0;
+        atomic_read_relaxed(&if_entry->filter_created, &filter_created);
+        if (!filter_created) {
+            ops_xp_dev_tx_buf_put(info->dev_id, tx_buf);
+            continue;
         }
+        atomic_read_relaxed(&if_entry->send_if_id, &egress_if_id);
 
-        status = xpsPortGetPortControlIntfId(xp_dev->id, xps_if_id,
-                                             &if_entry->send_if_id);
-        if (status) {
-            ovs_mutex_unlock(&info->mutex);
-            VLOG_ERR("%s, Unable to get port control interface ID for "
-                     "interface: %u. Error: %d",
-                     __FUNCTION__, xps_if_id, status);
-            return EPERM;
+        if (drain) {
+            VLOG_WARN_RL(&rl, "%s, Drain %u bytes from TAP interface %u",
+                         __FUNCTION__, bytes_recv, egress_if_id);
+            ops_xp_dev_tx_buf_put(info->dev_id, tx_buf);
+            continue;
         }
-    } else {
-        if_entry->send_if_id = xps_if_id;
-    }
-
-    ovs_mutex_unlock(&info->mutex);
-
-    return 0;
-}
-
-/* Finds tap_if_entry using fd. */
-static struct tap_if_entry *
-tap_get_if_entry_by_fd(struct tap_info *tap_info, int fd)
-{
-    struct hmap_node *e;
-
-    if (!tap_info || (fd <= 0)) {
-        VLOG_ERR("%s, Invalid data.", __FUNCTION__);
-        return NULL;
-    }
-
-    e = hmap_first_with_hash(&tap_info->fd_to_tap_if_map, fd);
-    if (e) {
-        return CONTAINER_OF(e, struct tap_if_entry, fd_node);
-    }
-
-    return NULL;
-}
-
-/* Finds tap_if_entry using xps interface id. */
-static struct tap_if_entry *
-tap_get_if_entry_by_if_id(struct tap_info *tap_info, xpsInterfaceId_t if_id)
-{
-    struct hmap_node *e;
 
-    if (!tap_info || (if_id < 0)) {
-        VLOG_ERR("%s, Invalid data.", __FUNCTION__);
-        return NULL;
-    }
-
-    e = hmap_first_with_hash(&tap_info->if_id_to_tap_if_map, if_id);
-    if (e) {
-        return CONTAINER_OF(e, struct tap_if_entry, if_id_node);
+        VLOG_DBG("%s, Received packet of %d bytes (dst MAC: "
+                 ETH_ADDR_FMT") on TAP interface %u.",
+                 __FUNCTION__, bytes_recv,
+                 ETH_ADDR_BYTES_ARGS((uint8_t *)data),
+                 egress_if_id);
+
+        /* Send packet to host. */
+        if (tx_buf) {
+            tx_buf->size = bytes_recv;
+            ops_xp_dev_send_buf(info->dev_id, egress_if_id, tx_buf);
+        } else {
+            ops_xp_dev_send(info->dev_id, egress_if_id, buf, bytes_recv);
+        }
     }
-
-    return NULL;
 }
 
 /* Handles packets received from TAP interfaces. */
@@ -508,8 +444,8 @@ static void *
 tap_listener(void *arg)
 {
     char *buf;
-    int ret;
     struct tap_info *info = arg;
+    struct epoll_event events[TAP_EPOLL_EVENTS];
     struct timeval init_time;
     const uint8_t INIT_DRAIN_TIME = 5;
     bool time_initialized = false;
@@ -523,85 +459,46 @@ tap_listener(void *arg)
 
     /* Handling loop. */
     while (1) {
-        int bytes_recv;
+        struct timeval cur_time, delta_time;
+        int n_events;
         int i;
 
-        ovs_mutex_lock(&info->mutex);
-        fd_set read_fd_set = info->read_fd_set;
-        ovs_mutex_unlock(&info->mutex);
-
-        if (select(FD_SETSIZE, &read_fd_set, NULL, NULL, NULL) < 0) {
-            VLOG_ERR("%s: Select failed. Error(%d) - %s",
+        /* Deleted TAP entries are freed only while the listener waits, so
+         * entries of returned events stay valid until the next wait. */
+        ovsrcu_quiesce_start();
+        n_events = epoll_wait(info->epoll_fd, events, TAP_EPOLL_EVENTS, -1);
+        ovsrcu_quiesce_end();
+
+        if (n_events < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            VLOG_ERR("%s: Epoll wait failed. Error(%d) - %s",
                      __FUNCTION__, errno, strerror(errno));
             free(buf);
             return NULL;
         }
 
-        for (i = 0; i < FD_SETSIZE; i++) {
-            if (FD_ISSET (i, &read_fd_set)) {
-
-                struct tap_if_entry *if_entry;
-                xpsInterfaceId_t egress_if_id;
-                struct timeval cur_time, delta_time;
-
-                do {
-                    bytes_recv = read(i, buf, RX_MAX_FRM_LEN_MAX_VAL);
-                } while ((bytes_recv < 0) && (errno == EINTR));
-
-                if ((bytes_recv < 0) && (errno != EWOULDBLOCK)) {
-                    VLOG_WARN("%s, Read from recv socket failed. Error(%d) - %s",
-                              __FUNCTION__, errno, strerror(errno));
-                    continue;
-                }
-
-                if (i == info->exit_fds[0]) {
-                    VLOG_INFO("TAP listener thread finished.");
-                    free(buf);
-                    return NULL;
-                } else if (i == info->if_upd_fds[0]) {
-                    /* New TAP interface has been added so
-                     * need to listen to it as well. */
-                    VLOG_INFO("%s, New TAP interface added for listening.",
-                              __FUNCTION__);
-                    continue;
-                }
-
-                ovs_mutex_lock(&info->mutex);
-                /* Figure out egress interface ID. */
-                if_entry = tap_get_if_entry_by_fd(info, i);
-                if (!if_entry || !if_entry->filter_created) {
-                    ovs_mutex_unlock(&info->mutex);
-                    continue;
-                }
-                egress_if_id = if_entry->send_if_id;
-
-                ovs_mutex_unlock(&info->mutex);
-
-                if (!time_initialized) {
-                    gettimeofday(&init_time, NULL);
-                    time_initialized = true;
-                }
-
-                gettimeofday(&cur_time, NULL);
-                timersub(&cur_time, &init_time, &delta_time);
-
-                if (delta_time.tv_sec < INIT_DRAIN_TIME) {
-                    VLOG_WARN_RL(&rl, "%s, Drain %u bytes from TAP interface %u",
-                                 __FUNCTION__, bytes_recv, egress_if_id);
-                    continue;
-                }
-
-                VLOG_DBG("%s, Received packet of %d bytes (dst MAC: "
-                         ETH_ADDR_FMT") on TAP interface %u.",
-                         __FUNCTION__, bytes_recv,
-                         ETH_ADDR_BYTES_ARGS((uint8_t *)buf),
-                         egress_if_id);
-
-                /* Send packet to host. */
-                ops_xp_dev_send(info->dev_id, egress_if_id, buf, bytes_recv);
-
-            } /* if (FD_ISSET (i, &read_fd_set)) */
-        } /* for (i = 0; i < FD_SETSIZE; i++) */
+        if (!time_initialized) {
+            gettimeofday(&init_time, NULL);
+            time_initialized = true;
+        }
+
+        gettimeofday(&cur_time, NULL);
+        timersub(&cur_time, &init_time, &delta_time);
+
+        for (i = 0; i < n_events; i++) {
+            struct xp_host_if_entry *if_entry = events[i].data.ptr;
+
+            if (!if_entry) {
+                VLOG_INFO("TAP listener thread finished.");
+                free(buf);
+                return NULL;
+            }
+
+            tap_if_recv(info, if_entry, buf,
+                        delta_time.tv_sec < INIT_DRAIN_TIME);
+        }
     } /* while (1) */
 
     return NULL;
@@ -613,56 +510,62 @@ static XP_STATUS
 tap_packet_driver_cb(xpsDevice_t devId, xpsPort_t portNum,
                      void *buf, uint16_t buf_size, void *userData)
 {
-    XP_STATUS status;
-    int ret;
-    int fd;
-    struct tap_if_entry *if_entry;
-    xpsInterfaceId_t if_id;
     struct xpliant_dev *dev = (struct xpliant_dev *)userData;
+    struct xp_host_if_port_map *port_map;
     struct tap_info *info;
 
-    if (!dev || !dev->host_if_info) {
+    if (!dev || !dev->host_if_info || !dev->host_if_info->data) {
         return XP_ERR_INVALID_PARAMS;
     }
 
     info = (struct tap_info *)dev->host_if_info->data;
 
-    status = xpsPortGetPortIntfId(devId, portNum, &if_id);
-    if (status != XP_NO_ERR) {
-        VLOG_ERR("%s, Unable to get interface ID for a port: %u",
-                 __FUNCTION__, portNum);
-        return status;
+    /* If no TAP interface is attached then silently ignore the packet */
+    port_map = ops_xp_host_if_table_port_map(&info->ifs);
+    if (portNum >= XP_MAX_TOTAL_PORTS || !port_map->entries[portNum]) {
+        return XP_NO_ERR;
     }
 
-    ovs_mutex_lock(&info->mutex);
+    /* The packet is written to TAP interface by the worker of its receive
+     * queue, so a flood of one kind of packets does not delay others. */
+    ops_xp_host_rxq_enqueue(info->rxqs, portNum, buf, buf_size);
 
-    /* Figure out fd for this interface ID. */
-    if_entry = tap_get_if_entry_by_if_id(info, if_id);
-    if (!if_entry) {
-        /* If no fd is attached then silently ignore the packet */
-        VLOG_INFO("%s, Unable to get TAP interface entry for a port: %u",
-                  __FUNCTION__, portNum);
-        ovs_mutex_unlock(&info->mutex);
-        return XP_NO_ERR;
-    }
-    fd = if_entry->fd;
+    return XP_NO_ERR;
+}
+
+/* Writes packets of a receive queue to TAP interfaces. TAP devices take
+ * a single frame per write, so it is one write per packet. Interfaces
+ * are looked up without locking. */
+static void
+tap_rxq_deliver(void *aux, struct xp_rxq_pkt **pkts, size_t n)
+{
+    struct tap_info *info = aux;
+    struct xp_host_if_port_map *port_map;
+    struct xp_host_if_entry *if_entry;
+    size_t i;
+    int ret;
+
+    port_map = ops_xp_host_if_table_port_map(&info->ifs);
 
-    VLOG_DBG("%s, Sending packet of %d bytes to TAP interface %u.",
-             __FUNCTION__, buf_size, if_id);
+    for (i = 0; i < n; i++) {
+        /* Interface may be gone since the packet was queued. */
+        if_entry = port_map->entries[pkts[i]->port];
+        if (!if_entry) {
+            continue;
+        }
 
-    ovs_mutex_unlock(&info->mutex);
+        VLOG_DBG("%s, Sending packet of %d bytes to TAP interface %u.",
+                 __FUNCTION__, pkts[i]->size, if_entry->if_id);
 
-    /* Send a packet to xpnet interface. */
-    do {
-        ret = write(fd, buf, buf_size);
-    } while ((ret < 0) && (errno == EINTR));
+        /* Send a packet to xpnet interface. */
+        do {
+            ret = write(if_entry->fd, pkts[i]->data, pkts[i]->size);
+        } while ((ret < 0) && (errno == EINTR));
 
-    if (ret < 0) {
-        VLOG_ERR_RL(&rl, "%s, Unable to send packet to TAP interface %u. "
-                    "Error(%d) - %s",
-                    __FUNCTION__, if_entry->if_id, errno, strerror(errno));
-        return XP_ERR_SOCKET_SEND;
+        if (ret < 0) {
+            VLOG_ERR_RL(&rl, "%s, Unable to send packet to TAP interface "
+                        "%u. Error(%d) - %s", __FUNCTION__, if_entry->if_id,
+                        errno, strerror(errno));
+        }
     }
-
-    return XP_NO_ERR;
 }
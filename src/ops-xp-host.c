@@ -29,6 +29,7 @@ VLOG_DEFINE_THIS_MODULE(xp_host);
 
 extern const struct xp_host_if_api xp_host_netdev_api;
 extern const struct xp_host_if_api xp_host_tap_api;
+extern const struct xp_host_if_api xp_host_packet_api;
 
 /* Initializes HOST interface. */
 int
@@ -51,6 +52,10 @@ ops_xp_host_init(struct xpliant_dev *xp_dev, xp_host_if_type_t type)
         info->exec = &xp_host_tap_api;
         info->data = NULL;
         break;
+    case XP_HOST_IF_PACKET:
+        info->exec = &xp_host_packet_api;
+        info->data = NULL;
+        break;
     default:
         return EINVAL;
     }
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2016, Cavium, Inc.
+ * All Rights Reserved.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *   not use this file except in compliance with the License. You may obtain
+ *   a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *   WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *   License for the specific language governing permissions and limitations
+ *   under the License.
+ *
+ * File: ops-xp-netlink.c
+ *
+ * Purpose: This file contains OpenSwitch kernel link configuration
+ *          over rtnetlink for the Cavium/XPliant SDK.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <net/if.h>
+#include <linux/rtnetlink.h>
+#include <linux/veth.h>
+
+#include "netlink.h"
+#include "netlink-socket.h"
+#include "ofpbuf.h"
+#include "ovs-thread.h"
+#include "util.h"
+#include "ops-xp-util.h"
+#include "ops-xp-netlink.h"
+
+
+VLOG_DEFINE_THIS_MODULE(xp_netlink);
+
+static struct vlog_rate_limit nl_rl = VLOG_RATE_LIMIT_INIT(5, 20);
+
+/* Persistent rtnetlink socket shared by all batches. Created on first
+ * commit. */
+static struct ovs_mutex nl_mutex = OVS_MUTEX_INITIALIZER;
+static struct nl_sock *nl_rt_sock OVS_GUARDED_BY(nl_mutex);
+
+struct xp_nl_batch {
+    struct nl_transaction txns[XP_NL_BATCH_MAX];
+    size_t n;                   /* Number of queued requests */
+    int error;                  /* First error since last commit */
+};
+
+
+struct xp_nl_batch *
+ops_xp_nl_batch_create(void)
+{
+    return xzalloc(sizeof(struct xp_nl_batch));
+}
+
+/* Drops requests which have not been committed and frees @batch. */
+void
+ops_xp_nl_batch_destroy(struct xp_nl_batch *batch)
+{
+    size_t i;
+
+    if (!batch) {
+        return;
+    }
+
+    for (i = 0; i < batch->n; i++) {
+        ofpbuf_delete(batch->txns[i].request);
+    }
+    free(batch);
+}
+
+/* Sends all queued requests to kernel in one go and waits for the
+ * acknowledgements. Returns the first error that occurred since the last
+ * commit or 0 if all requests succeeded. */
+int
+ops_xp_nl_batch_commit(struct xp_nl_batch *batch)
+{
+    struct nl_transaction *txnsp[XP_NL_BATCH_MAX];
+    int error = 0;
+    size_t i;
+
+    if (batch->n) {
+        ovs_mutex_lock(&nl_mutex);
+        if (!nl_rt_sock) {
+            error = nl_sock_create(NETLINK_ROUTE, &nl_rt_sock);
+        }
+        if (!error) {
+            for (i = 0; i < batch->n; i++) {
+                txnsp[i] = &batch->txns[i];
+            }
+            nl_sock_transact_multiple(nl_rt_sock, txnsp, batch->n);
+        } else {
+            VLOG_ERR("Failed to create rtnetlink socket. %s",
+                     ovs_strerror(error));
+        }
+        ovs_mutex_unlock(&nl_mutex);
+
+        for (i = 0; i < batch->n; i++) {
+            struct nl_transaction *txn = &batch->txns[i];
+
+            if (!error && txn->error) {
+                VLOG_WARN_RL(&nl_rl, "rtnetlink request %"PRIu16" failed. %s",
+                             nl_msg_nlmsghdr(txn->request)->nlmsg_type,
+                             ovs_strerror(txn->error));
+                if (!batch->error) {
+                    batch->error = txn->error;
+                }
+            }
+            ofpbuf_delete(txn->request);
+        }
+        batch->n = 0;
+    }
+
+    error = error ? error : batch->error;
+    batch->error = 0;
+
+    return error;
+}
+
+/* Queues @request into @batch committing the batch if it is full. */
+static int
+nl_batch_queue(struct xp_nl_batch *batch, struct ofpbuf *request)
+{
+    struct nl_transaction *txn = &batch->txns[batch->n++];
+
+    txn->request = request;
+    txn->reply = NULL;
+    txn->error = 0;
+
+    if (batch->n == XP_NL_BATCH_MAX) {
+        int error = ops_xp_nl_batch_commit(batch);
+
+        /* Keep error to report it on explicit commit. */
+        batch->error = error;
+    }
+
+    return 0;
+}
+
+/* Queues setting of administrative state and, if @mac is not NULL,
+ * MAC address of interface @if_name. */
+int
+ops_xp_nl_batch_link(struct xp_nl_batch *batch, const char *if_name,
+                     const struct ether_addr *mac, bool up)
+{
+    struct ofpbuf *request;
+    struct ifinfomsg *ifi;
+    unsigned int ifindex;
+
+    ifindex = if_nametoindex(if_name);
+    if (!ifindex) {
+        VLOG_WARN_RL(&nl_rl, "Unknown interface %s", if_name);
+        return ENODEV;
+    }
+
+    request = ofpbuf_new(64);
+    nl_msg_put_nlmsghdr(request, sizeof(struct ifinfomsg), RTM_NEWLINK,
+                        NLM_F_REQUEST | NLM_F_ACK);
+
+    ifi = ofpbuf_put_zeros(request, sizeof(*ifi));
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_index = ifindex;
+    ifi->ifi_change = IFF_UP;
+    ifi->ifi_flags = up ? IFF_UP : 0;
+
+    if (mac) {
+        nl_msg_put_unspec(request, IFLA_ADDRESS, mac, ETH_ALEN);
+    }
+
+    return nl_batch_queue(batch, request);
+}
+
+/* Queues creation of veth pair @if_name, @peer_name or its removal.
+ * Removing @if_name removes its peer as well. */
+int
+ops_xp_nl_batch_veth(struct xp_nl_batch *batch, bool add,
+                     const char *if_name, const char *peer_name)
+{
+    struct ofpbuf *request;
+    size_t linkinfo_ofs, data_ofs, peer_ofs;
+
+    VLOG_DBG("%s: %s veth %s peer %s",
+             __FUNCTION__, add ? "Add" : "Delete", if_name, peer_name);
+
+    request = ofpbuf_new(256);
+    nl_msg_put_nlmsghdr(request, sizeof(struct ifinfomsg),
+                        add ? RTM_NEWLINK : RTM_DELLINK,
+                        NLM_F_REQUEST | NLM_F_ACK |
+                        (add ? NLM_F_CREATE | NLM_F_EXCL : 0));
+    ofpbuf_put_zeros(request, sizeof(struct ifinfomsg));
+    nl_msg_put_string(request, IFLA_IFNAME, if_name);
+
+    if (add) {
+        linkinfo_ofs = nl_msg_start_nested(request, IFLA_LINKINFO);
+        nl_msg_put_string(request, IFLA_INFO_KIND, "veth");
+        data_ofs = nl_msg_start_nested(request, IFLA_INFO_DATA);
+        peer_ofs = nl_msg_start_nested(request, VETH_INFO_PEER);
+        ofpbuf_put_zeros(request, sizeof(struct ifinfomsg));
+        nl_msg_put_string(request, IFLA_IFNAME, peer_name);
+        nl_msg_end_nested(request, peer_ofs);
+        nl_msg_end_nested(request, data_ofs);
+        nl_msg_end_nested(request, linkinfo_ofs);
+    }
+
+    return nl_batch_queue(batch, request);
+}
@@ -34,6 +34,7 @@
 #include "netdev-provider.h"
 #include "netdev.h"
 #include "poll-loop.h"
+#include "bitmap.h"
 #include "simap.h"
 #include "smap.h"
 #include "sset.h"
@@ -53,6 +54,9 @@
 #include "ops-xp-vlan.h"
 #include "ops-xp-lag.h"
 #include "ops-xp-routing.h"
+#include "ops-xp-classifier.h"
+#include "ops-xp-host-rxq.h"
+#include "ops-xp-copp.h"
 #include "ops-xp-util.h"
 #include "openXpsVlan.h"
 #include "openXpsPacketDrv.h"
@@ -75,6 +79,41 @@ const struct ofproto_class ofproto_xpliant_class;
 static struct hmap all_ofproto_xpliant = HMAP_INITIALIZER(&all_ofproto_xpliant);
 
 #define XP_VRF_DEFAULT_ID 0
+#define XP_VRF_DEFAULT_NAME "vrf_default"
+#define XP_VRF_MAX 256
+
+/* HW VRF IDs in use. Each VRF gets its own ID, so routes and hosts of
+ * different VRFs do not overlap in HW tables. */
+static unsigned long vrf_id_map[BITMAP_N_LONGS(XP_VRF_MAX)];
+
+/* Returns HW VRF ID for VRF 'name' or XP_VRF_MAX if all IDs are in use. */
+static size_t
+vrf_id_alloc(const char *name)
+{
+    size_t vrf_id;
+
+    if (STR_EQ(name, XP_VRF_DEFAULT_NAME)) {
+        vrf_id = XP_VRF_DEFAULT_ID;
+    } else {
+        vrf_id = bitmap_scan(vrf_id_map, false, XP_VRF_DEFAULT_ID + 1,
+                             XP_VRF_MAX);
+    }
+
+    if ((vrf_id < XP_VRF_MAX) && !bitmap_is_set(vrf_id_map, vrf_id)) {
+        bitmap_set1(vrf_id_map, vrf_id);
+        return vrf_id;
+    }
+
+    return XP_VRF_MAX;
+}
+
+static void
+vrf_id_free(size_t vrf_id)
+{
+    if (vrf_id < XP_VRF_MAX) {
+        bitmap_set0(vrf_id_map, vrf_id);
+    }
+}
 
 typedef uint32_t OVS_BITWISE odp_port_t;
 #define ODP_PORT_C(X) ((OVS_FORCE odp_port_t) (X))
@@ -217,15 +256,14 @@ ofproto_xpliant_port_open_type(const char *datapath_type, const char *port_type)
 static int
 ofproto_xpliant_type_run(const char *type)
 {
-    /* TODO: Add periodic activity here if required
-     * for ofproto_xpliant_class type */
+    ops_xp_cls_run();
     return 0;
 }
 
 static void
 ofproto_xpliant_type_wait(const char *type)
 {
-    /* TODO */
+    ops_xp_cls_wait();
 }
 
 
@@ -287,10 +325,15 @@ ofproto_xpliant_construct(struct ofproto *ofproto_)
         ofproto->ml = ofproto->xpdev->ml;
         ofproto->has_bonded_bundles = false;
         ofproto->vrf = true;
-        ofproto->vrf_id = XP_VRF_DEFAULT_ID;
+        ofproto->vrf_id = vrf_id_alloc(ofproto_->name);
+        if (ofproto->vrf_id >= XP_VRF_MAX) {
+             VLOG_ERR("Unable to allocate HW VRF ID for %s", ofproto_->name);
+             return ENOSPC;
+        }
         ofproto->l3_mgr = ops_xp_l3_mgr_create(ofproto->xpdev->id);
         if (!ofproto->l3_mgr) {
              VLOG_ERR("Unable to create L3 manager on VRF %u", ofproto->vrf_id);
+             vrf_id_free(ofproto->vrf_id);
              return EPERM;
         }
         /* Set default ECMP hash values */
@@ -353,6 +396,9 @@ ofproto_xpliant_destruct(struct ofproto *ofproto_)
     VLOG_INFO("%s: up.name %s", __FUNCTION__, ofproto->up.name);
 
     ops_xp_l3_mgr_unref(ofproto);
+    if (ofproto->vrf) {
+        vrf_id_free(ofproto->vrf_id);
+    }
 
     hmap_remove(&all_ofproto_xpliant, &ofproto->all_ofproto_xpliant_node);
 
@@ -396,6 +442,8 @@ ofproto_xpliant_run(struct ofproto *ofproto_)
         }
     }
 
+    ops_xp_routing_run(ofproto);
+
     return 0;
 }
 
@@ -403,14 +451,20 @@ static void
 ofproto_xpliant_wait(struct ofproto *ofproto_)
 {
     struct ofproto_xpliant *ofproto = ops_xp_ofproto_cast(ofproto_);
-    /* TODO */
+
+    ops_xp_routing_wait(ofproto);
 }
 
 static void
 ofproto_xpliant_type_get_memory_usage(const char *type, struct simap *usage)
 {
-    VLOG_INFO("%s: type %s", __FUNCTION__, type);
-    /* TODO */
+    struct ofproto_xpliant *ofproto;
+
+    HMAP_FOR_EACH (ofproto, all_ofproto_xpliant_node, &all_ofproto_xpliant) {
+        if (ofproto->l3_mgr && STR_EQ(ofproto->up.type, type)) {
+            ops_xp_l3_mgr_get_memory_usage(ofproto->l3_mgr, usage);
+        }
+    }
 }
 
 /* ## ---------------- ## */
@@ -3001,4 +3055,8 @@ ofproto_xpliant_unixctl_init(void)
                              1, 1, xp_sdk_log_level, NULL);
 
     ops_xp_routing_unixctl_init();
+    ops_xp_cls_unixctl_init();
+    ops_xp_host_rxq_unixctl_init();
+    ops_xp_copp_unixctl_init();
+    ops_xp_dev_unixctl_init();
 }
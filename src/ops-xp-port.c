@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include <openvswitch/vlog.h>
+#include "ovs-rcu.h"
 
 #include "ops-xp-netdev.h"
 #include "ops-xp-host.h"
@@ -164,8 +165,11 @@ ops_xp_port_event_handler(void *arg)
     uint32_t port;
 
     for (;;) {
-        /* Sleep for a while */
+        /* Sleep for a while. The thread holds no RCU protected pointers
+         * while sleeping, so let RCU grace periods complete. */
+        ovsrcu_quiesce_start();
         ops_xp_msleep(XP_PORT_LINK_POLL_INTERVAL);
+        ovsrcu_quiesce_end();
 
         /* Iterate over all enabled ports */
         for (port = 0; port < XP_MAX_TOTAL_PORTS; port++) {
@@ -35,10 +35,18 @@
 #include "ops-xp-routing.h"
 #include "ops-xp-vlan.h"
 #include "unixctl.h"
+#include "poll-loop.h"
+#include "timeval.h"
 #include "openXpsReasonCodeTable.h"
 
 VLOG_DEFINE_THIS_MODULE(xp_routing);
 
+/* Max number of buckets of resilient ECMP group */
+#define XP_L3_ECMP_MAX_BUCKETS 128
+
+/* Interval between re-programming attempts of stale host routes (ms) */
+#define XP_L3_STALE_RETRY_INTERVAL 1000
+
 typedef struct {
     struct ofproto_xpliant *ofproto;
     char *prefix;
@@ -47,6 +55,8 @@ typedef struct {
 } xp_l3_test_params_t;
 
 typedef struct {
+    struct ovs_mutex mutex;     /* Guards test statistics, so the test does
+                                 * not contend with routes programming */
     uint32_t exec_sec;          /* Last test execution time (sec) */
     uint32_t exec_usec;         /* Last test execution time (usec) */
     uint32_t active_routes;     /* Routes in HW */
@@ -63,6 +73,13 @@ route_delete(struct ofproto_xpliant *ofproto, xp_route_entry_t *route);
 static void
 nh_group_delete(struct ofproto_xpliant *ofproto, xp_nh_group_entry_t *nh_group);
 
+static bool
+route_host_release(struct ofproto_xpliant *ofproto,
+                   const xp_host_entry_t *host);
+
+static void
+route_compress_update(struct ofproto_xpliant *ofproto, xp_route_entry_t *route);
+
 
 /* Creates and returns a new L3 manager. */
 xp_l3_mgr_t *
@@ -77,16 +94,19 @@ ops_xp_l3_mgr_create(xpsDevice_t devId)
     ovs_mutex_init_recursive(&mgr->mutex);
 
     list_init(&mgr->dummy_host_list);
+    list_init(&mgr->stale_routes);
 
     hmap_init(&mgr->route_map);
     hmap_init(&mgr->nh_group_map);
     hmap_init(&mgr->host_map);
     hmap_init(&mgr->host_id_map);
+    simap_init(&mgr->nh_weights);
 
     mgr->ecmp_hash = (OFPROTO_ECMP_HASH_SRCPORT | OFPROTO_ECMP_HASH_DSTPORT |
                         OFPROTO_ECMP_HASH_SRCIP | OFPROTO_ECMP_HASH_DSTIP);
 
     mgr->dbg = xzalloc(sizeof(xp_l3_dbg_t));
+    ovs_mutex_init(&((xp_l3_dbg_t *)mgr->dbg)->mutex);
 
     return mgr;
 }
@@ -117,22 +137,22 @@ ops_xp_l3_mgr_destroy(struct ofproto_xpliant *ofproto)
         sleep(1);
         --i;
     }
+    ovs_mutex_destroy(&dbg->mutex);
     free(dbg);
 
-    /* Remove dummy/empty host entries */
-    {
-        xp_host_entry_t *e = NULL;
-
-        LIST_FOR_EACH_POP (e, list_node, &mgr->dummy_host_list) {
-            free(e);
-        }
-    }
-
     /* Clear and destroy routes map. */
     {
         xp_route_entry_t *e = NULL;
         xp_route_entry_t *next = NULL;
 
+        /* Routes are going away, so there is no need to program
+         * compressed routes on removal of their covers. */
+        mgr->route_compression = false;
+        HMAP_FOR_EACH (e, hmap_node, &mgr->route_map) {
+            list_init(&e->covered);
+            e->cover = NULL;
+        }
+
         HMAP_FOR_EACH_SAFE (e, next, hmap_node, &mgr->route_map) {
             route_delete(ofproto, e);
         }
@@ -162,6 +182,18 @@ ops_xp_l3_mgr_destroy(struct ofproto_xpliant *ofproto)
         hmap_destroy(&mgr->host_id_map);
     }
 
+    simap_destroy(&mgr->nh_weights);
+
+    /* Remove dummy/empty host entries. Done last since removal of
+     * routes and hosts returns their entries to the dummy list. */
+    {
+        xp_host_entry_t *e = NULL;
+
+        LIST_FOR_EACH_POP (e, list_node, &mgr->dummy_host_list) {
+            free(e);
+        }
+    }
+
     ovs_mutex_destroy(&mgr->mutex);
 
     free(mgr);
@@ -189,6 +221,24 @@ ops_xp_l3_mgr_unref(struct ofproto_xpliant *ofproto)
     }
 }
 
+/* Adds HW L3 tables usage of L3 manager 'mgr' to 'usage'. */
+void
+ops_xp_l3_mgr_get_memory_usage(xp_l3_mgr_t *mgr, struct simap *usage)
+{
+    ovs_assert(mgr);
+    ovs_assert(usage);
+
+    ovs_mutex_lock(&mgr->mutex);
+    simap_increase(usage, "xp-l3-routes", hmap_count(&mgr->route_map));
+    simap_increase(usage, "xp-l3-hw-ipv4-routes", mgr->hw_usage.ipv4_routes);
+    simap_increase(usage, "xp-l3-hw-ipv6-routes", mgr->hw_usage.ipv6_routes);
+    simap_increase(usage, "xp-l3-hw-hosts", mgr->hw_usage.hosts);
+    simap_increase(usage, "xp-l3-hw-host-routes", mgr->hw_usage.host_routes);
+    simap_increase(usage, "xp-l3-hw-nh-groups", mgr->hw_usage.nh_groups);
+    simap_increase(usage, "xp-l3-hw-nexthops", mgr->hw_usage.nh_entries);
+    ovs_mutex_unlock(&mgr->mutex);
+}
+
 static xp_host_entry_t *
 host_entry_alloc(xp_l3_mgr_t *mgr)
 {
@@ -219,6 +269,39 @@ host_entry_free(xp_l3_mgr_t *mgr, xp_host_entry_t *host)
     }
 }
 
+/* Inserts host entry 'e' programmed at 'hash' index of the HW host table
+ * into host_map. The entry which used to be at 'hash' index has been moved
+ * by HW to 'rehash' index. */
+static void
+host_map_insert(xp_l3_mgr_t *mgr, xp_host_entry_t *e,
+                uint32_t hash, uint32_t rehash)
+{
+    if (hash != rehash) {
+        struct hmap_node *node;
+
+        /* Update entry index in the host table. */
+        node = hmap_first_with_hash(&mgr->host_map, hash);
+        if (node != NULL) {
+            hmap_remove(&mgr->host_map, node);
+            hmap_insert(&mgr->host_map, node, rehash);
+        }
+    }
+    hmap_insert(&mgr->host_map, &e->hmap_node, hash);
+}
+
+static XP_STATUS
+host_entry_hw_add(struct ofproto_xpliant *ofproto, xp_host_entry_t *e,
+                  bool local, uint32_t *hash, uint32_t *rehash)
+{
+    if (local) {
+        return xpsL3AddIpHostControlEntry(ofproto->xpdev->id, &e->xp_host,
+                                          hash, rehash);
+    }
+
+    return xpsL3AddIpHostEntry(ofproto->xpdev->id, &e->xp_host,
+                               hash, rehash);
+}
+
 /* Function to add l3 host entry via ofproto */
 int
 ops_xp_routing_add_host_entry(struct ofproto_xpliant *ofproto,
@@ -303,17 +386,17 @@ ops_xp_routing_add_host_entry(struct ofproto_xpliant *ofproto,
 
     e->is_ipv6_addr = is_ipv6_addr;
 
-    if (local) {
-        status = xpsL3AddIpHostControlEntry(ofproto->xpdev->id, &e->xp_host,
-                                            &hash, &rehash);
-    } else {
-        status = xpsL3AddIpHostEntry(ofproto->xpdev->id, &e->xp_host,
-                                     &hash, &rehash);
+    status = host_entry_hw_add(ofproto, e, local, &hash, &rehash);
+    if ((status != XP_NO_ERR) && route_host_release(ofproto, e)) {
+        /* Host route with the same address has been moved
+         * to the LPM table. Try again. */
+        status = host_entry_hw_add(ofproto, e, local, &hash, &rehash);
     }
 
     if (status != XP_NO_ERR) {
         VLOG_ERR("%s, Could not add L3 host entry on hardware. Error: %d",
                  __FUNCTION__, status);
+        ++l3_mgr->hw_usage.host_failures;
         host_entry_free(l3_mgr, e);
         ovs_mutex_unlock(&l3_mgr->mutex);
         return EAGAIN;
@@ -327,18 +410,9 @@ ops_xp_routing_add_host_entry(struct ofproto_xpliant *ofproto,
              IP_ARGS(e->ipv4_dest_addr.s_addr),
              ETH_ADDR_BYTES_ARGS(e->xp_host.nhEntry.nextHop.macDa));
 
-    if (hash != rehash) {
-        struct hmap_node *node;
-
-        /* Update entry index in the host table. */
-        node = hmap_first_with_hash(&l3_mgr->host_map, hash);
-        if (node != NULL) {
-            hmap_remove(&l3_mgr->host_map, node);
-            hmap_insert(&l3_mgr->host_map, node, rehash);
-        }
-    }
-    hmap_insert(&l3_mgr->host_map, &e->hmap_node, hash);
+    host_map_insert(l3_mgr, e, hash, rehash);
     hmap_insert(&l3_mgr->host_id_map, &e->hmap_id_node, e->id);
+    ++l3_mgr->hw_usage.hosts;
 
     ovs_mutex_unlock(&l3_mgr->mutex);
 
@@ -386,6 +460,9 @@ ops_xp_routing_delete_host_entry(struct ofproto_xpliant *ofproto,
     /* Remove Host Entry from the HW */
     status = xpsL3RemoveIpHostEntryByIndex(ofproto->xpdev->id, (uint32_t)index,
                                            host_entry_type);
+    if (status == XP_NO_ERR) {
+        --l3_mgr->hw_usage.hosts;
+    }
     ovs_mutex_unlock(&l3_mgr->mutex);
 
     if (status != XP_NO_ERR) {
@@ -396,30 +473,30 @@ ops_xp_routing_delete_host_entry(struct ofproto_xpliant *ofproto,
     return 0;
 }
 
+/* Returns number of HW NH entries used by 'nh_group'. */
+static uint32_t
+nh_group_hw_size(const xp_nh_group_entry_t *nh_group)
+{
+    return nh_group->n_buckets ? nh_group->n_buckets : nh_group->size;
+}
+
+/* Allocates NH group for up to 'size' NHs. HW NH entries are allocated
+ * by nh_group_add() once NHs of the group are known. */
 static xp_nh_group_entry_t *
 nh_group_alloc(uint32_t size)
 {
     xp_nh_group_entry_t *nh_group;
-    XP_STATUS status;
-    uint32_t nh_id;
 
     if (size > OFPROTO_MAX_NH_PER_ROUTE) {
         return NULL;
     }
 
-    /* Allocate new NH group ID */
-    status = xpsL3CreateRouteNextHop(size, &nh_id);
-    if (status != XP_NO_ERR) {
-        VLOG_ERR("Could not allocate NH on hardware. Err %d", status);
-        return NULL;
-    }
-
     /* Allocate and init NH group entry */
     nh_group = xzalloc(sizeof(*nh_group));
     hmap_init(&nh_group->nh_map);
     ovs_refcount_init(&nh_group->ref_cnt);
+    list_init(&nh_group->host_routes);
     nh_group->size = size;
-    nh_group->nh_id = nh_id;
 
     if (size > 0) {
         hmap_reserve(&nh_group->nh_map, size);
@@ -440,9 +517,12 @@ nh_group_free(xp_nh_group_entry_t *nh_group)
     VLOG_DBG("%s: nexthop id %u, size %u",
              __FUNCTION__, nh_group->nh_id, nh_group->size);
 
-    status = xpsL3DestroyRouteNextHop(nh_group->size, nh_group->nh_id);
-    if (status != XP_NO_ERR) {
-        VLOG_WARN("Could not remove next hop on hardware. Err %d", status);
+    if (nh_group->in_hw) {
+        status = xpsL3DestroyRouteNextHop(nh_group_hw_size(nh_group),
+                                          nh_group->nh_id);
+        if (status != XP_NO_ERR) {
+            VLOG_WARN("Could not remove next hop on hardware. Err %d", status);
+        }
     }
 
     HMAP_FOR_EACH_SAFE(e, next, hmap_node, &nh_group->nh_map) {
@@ -451,6 +531,7 @@ nh_group_free(xp_nh_group_entry_t *nh_group)
         free(e);
     }
     hmap_destroy(&nh_group->nh_map);
+    free(nh_group->buckets);
     free(nh_group);
 }
 
@@ -470,12 +551,28 @@ nh_group_delete(struct ofproto_xpliant *ofproto, xp_nh_group_entry_t *nh_group)
     if (hmap_contains(&ofproto->l3_mgr->nh_group_map,
                       &nh_group->hmap_node)) {
         hmap_remove(&ofproto->l3_mgr->nh_group_map, &nh_group->hmap_node);
+        --ofproto->l3_mgr->hw_usage.nh_groups;
+        ofproto->l3_mgr->hw_usage.nh_entries -= nh_group_hw_size(nh_group);
     }
 
-    HMAP_FOR_EACH(e, hmap_node, &nh_group->nh_map) {
-        status = xpsL3ClearRouteNextHop(ofproto->xpdev->id, e->xp_nh_id);
-        if (status != XP_NO_ERR) {
-            VLOG_WARN("Could not clear NH on hardware. Status: %d", status);
+    if (!nh_group->in_hw) {
+        /* HW NH entries have not been allocated */
+    } else if (nh_group->n_buckets) {
+        uint32_t i;
+
+        for (i = 0; i < nh_group->n_buckets; i++) {
+            status = xpsL3ClearRouteNextHop(ofproto->xpdev->id,
+                                            nh_group->nh_id + i);
+            if (status != XP_NO_ERR) {
+                VLOG_WARN("Could not clear NH on hardware. Status: %d", status);
+            }
+        }
+    } else {
+        HMAP_FOR_EACH(e, hmap_node, &nh_group->nh_map) {
+            status = xpsL3ClearRouteNextHop(ofproto->xpdev->id, e->xp_nh_id);
+            if (status != XP_NO_ERR) {
+                VLOG_WARN("Could not clear NH on hardware. Status: %d", status);
+            }
         }
     }
 
@@ -492,16 +589,160 @@ nh_group_unref(struct ofproto_xpliant *ofproto, xp_nh_group_entry_t *nh_group)
     }
 }
 
-/* Creates NH group on the HW */
+/* Calculates how many of 'n_buckets' buckets each of 'n_nhs' NHs gets in
+ * proportion to NH 'weight'. Each NH gets at least one bucket. The remainder
+ * of the division goes first to NHs which 'used' more buckets before. */
+static void
+nh_group_buckets_quota(uint32_t n_buckets, uint32_t n_nhs,
+                       const uint32_t *weight, const uint32_t *used,
+                       uint32_t *quota)
+{
+    uint64_t total = 0;
+    uint32_t assigned = 0;
+    uint32_t i, max;
+
+    for (i = 0; i < n_nhs; i++) {
+        total += weight[i];
+    }
+
+    for (i = 0; i < n_nhs; i++) {
+        quota[i] = MAX(1, (uint64_t)n_buckets * weight[i] / total);
+        assigned += quota[i];
+    }
+
+    /* Minimal share may have given away more buckets than there are */
+    while (assigned > n_buckets) {
+        for (i = 1, max = 0; i < n_nhs; i++) {
+            if (quota[i] > quota[max]) {
+                max = i;
+            }
+        }
+        --quota[max];
+        --assigned;
+    }
+
+    for (i = 0; (assigned < n_buckets) && (i < n_nhs); i++) {
+        if (used[i] > quota[i]) {
+            ++quota[i];
+            ++assigned;
+        }
+    }
+
+    for (i = 0; assigned < n_buckets; i = (i + 1) % n_nhs) {
+        ++quota[i];
+        ++assigned;
+    }
+}
+
+/* Assigns NHs of 'nh_group' to its buckets.
+ *
+ * Each NH gets a share of buckets in proportion to its weight, so
+ * weighted NHs are replicated across buckets. Buckets of 'prev' group, which
+ * 'nh_group' replaces, keep their NH while it is still in the group and
+ * does not exceed its share. So only flows hashed to buckets of removed
+ * NHs, or to buckets handed over to new NHs, change their path. */
+static void
+nh_group_buckets_assign(xp_nh_group_entry_t *nh_group,
+                        const xp_nh_group_entry_t *prev)
+{
+    uint32_t n_nhs = hmap_count(&nh_group->nh_map);
+    uint32_t n_buckets = nh_group->n_buckets;
+    xp_nh_entry_t **nhs;
+    uint32_t *weight;
+    uint32_t *owner;
+    uint32_t *quota;
+    uint32_t *used;
+    uint32_t i, b;
+    xp_nh_entry_t *nh;
+
+    if (!n_buckets || !n_nhs) {
+        return;
+    }
+
+    nhs = xmalloc(n_nhs * sizeof *nhs);
+    owner = xmalloc(n_buckets * sizeof *owner);
+    quota = xcalloc(n_nhs, sizeof *quota);
+    used = xcalloc(n_nhs, sizeof *used);
+    weight = xmalloc(n_nhs * sizeof *weight);
+
+    i = 0;
+    HMAP_FOR_EACH (nh, hmap_node, &nh_group->nh_map) {
+        weight[i] = nh->weight;
+        nhs[i++] = nh;
+    }
+
+    /* Find NHs which keep their buckets of the previous group */
+    for (b = 0; b < n_buckets; b++) {
+        owner[b] = n_nhs;
+        if (prev && (prev->n_buckets == n_buckets) && prev->buckets[b]) {
+            for (i = 0; i < n_nhs; i++) {
+                if (strcmp(nhs[i]->id, prev->buckets[b]->id) == 0) {
+                    owner[b] = i;
+                    ++used[i];
+                    break;
+                }
+            }
+        }
+    }
+
+    nh_group_buckets_quota(n_buckets, n_nhs, weight, used, quota);
+
+    /* Release buckets above the share */
+    memset(used, 0, n_nhs * sizeof *used);
+    for (b = 0; b < n_buckets; b++) {
+        if (owner[b] < n_nhs) {
+            if (used[owner[b]] < quota[owner[b]]) {
+                ++used[owner[b]];
+            } else {
+                owner[b] = n_nhs;
+            }
+        }
+    }
+
+    /* Hand free buckets over to NHs below their share */
+    for (b = 0, i = 0; b < n_buckets; b++) {
+        if (owner[b] == n_nhs) {
+            while (used[i] >= quota[i]) {
+                i = (i + 1) % n_nhs;
+            }
+            owner[b] = i;
+            ++used[i];
+        }
+        nh_group->buckets[b] = nhs[owner[b]];
+    }
+
+    free(weight);
+    free(used);
+    free(quota);
+    free(owner);
+    free(nhs);
+}
+
+/* Writes NHs of 'nh_group' into HW NH entries */
 static int
-nh_group_add(struct ofproto_xpliant *ofproto, xp_nh_group_entry_t *nh_group)
+nh_group_hw_write(struct ofproto_xpliant *ofproto,
+                  xp_nh_group_entry_t *nh_group)
 {
     xp_nh_entry_t *e;
     XP_STATUS status;
+    uint32_t i;
 
-    ovs_assert(ofproto);
-    ovs_assert(ofproto->l3_mgr);
-    ovs_assert(nh_group);
+    if (nh_group->n_buckets) {
+        for (i = 0; i < nh_group->n_buckets; i++) {
+            e = nh_group->buckets[i];
+            if (!e) {
+                continue;
+            }
+            status = xpsL3SetRouteNextHop(ofproto->xpdev->id,
+                                          nh_group->nh_id + i, &e->xp_nh);
+            if (status != XP_NO_ERR) {
+                VLOG_ERR("Could not set next hop on hardware. Status: %d",
+                         status);
+                return EHOSTUNREACH;
+            }
+        }
+        return 0;
+    }
 
     HMAP_FOR_EACH(e, hmap_node, &nh_group->nh_map) {
         status = xpsL3SetRouteNextHop(ofproto->xpdev->id, e->xp_nh_id, &e->xp_nh);
@@ -511,8 +752,102 @@ nh_group_add(struct ofproto_xpliant *ofproto, xp_nh_group_entry_t *nh_group)
         }
     }
 
+    return 0;
+}
+
+/* Allocates HW NH entries for 'nh_group'.
+ *
+ * NHs of resilient or weighted group are spread across a block of buckets.
+ * Resilient group has a fixed number of buckets regardless of how many NHs
+ * it has. Weighted group without resilient hashing gets a bucket per unit
+ * of weight. Otherwise each NH has a single HW NH entry. */
+static int
+nh_group_hw_alloc(xp_l3_mgr_t *mgr, xp_nh_group_entry_t *nh_group)
+{
+    uint32_t n_nhs = hmap_count(&nh_group->nh_map);
+    uint32_t n_buckets = 0;
+    uint32_t weights = 0;
+    bool weighted = false;
+    xp_nh_entry_t *nh;
+    XP_STATUS status;
+    uint32_t nh_id;
+    uint32_t i;
+
+    HMAP_FOR_EACH (nh, hmap_node, &nh_group->nh_map) {
+        weights += nh->weight;
+        weighted |= (nh->weight != 1);
+    }
+    nh_group->size = n_nhs;
+
+    if (n_nhs > 1) {
+        if (mgr->ecmp_buckets && (n_nhs <= mgr->ecmp_buckets)) {
+            n_buckets = mgr->ecmp_buckets;
+        } else if (weighted) {
+            n_buckets = MIN(weights, XP_L3_ECMP_MAX_BUCKETS);
+        }
+    }
+
+    if (n_buckets) {
+        status = xpsL3CreateRouteNextHop(n_buckets, &nh_id);
+        if (status != XP_NO_ERR) {
+            VLOG_WARN("Could not allocate %u NH buckets on hardware. Err %d",
+                      n_buckets, status);
+            n_buckets = 0;
+        }
+    }
+
+    /* Allocate new NH group ID */
+    if (!n_buckets) {
+        status = xpsL3CreateRouteNextHop(nh_group->size, &nh_id);
+        if (status != XP_NO_ERR) {
+            VLOG_ERR("Could not allocate NH on hardware. Err %d", status);
+            return ENOMEM;
+        }
+    }
+
+    nh_group->nh_id = nh_id;
+    nh_group->in_hw = true;
+    nh_group->n_buckets = n_buckets;
+    if (n_buckets) {
+        nh_group->buckets = xcalloc(n_buckets, sizeof *nh_group->buckets);
+    }
+
+    i = 0;
+    HMAP_FOR_EACH (nh, hmap_node, &nh_group->nh_map) {
+        nh->xp_nh_id = nh_id + i++;
+    }
+
+    return 0;
+}
+
+/* Creates NH group on the HW. 'prev' is the NH group which 'nh_group'
+ * replaces for a route, if any. */
+static int
+nh_group_add(struct ofproto_xpliant *ofproto, xp_nh_group_entry_t *nh_group,
+             const xp_nh_group_entry_t *prev)
+{
+    int rc;
+
+    ovs_assert(ofproto);
+    ovs_assert(ofproto->l3_mgr);
+    ovs_assert(nh_group);
+
+    rc = nh_group_hw_alloc(ofproto->l3_mgr, nh_group);
+    if (rc) {
+        return rc;
+    }
+
+    nh_group_buckets_assign(nh_group, prev);
+
+    rc = nh_group_hw_write(ofproto, nh_group);
+    if (rc) {
+        return rc;
+    }
+
     hmap_insert(&ofproto->l3_mgr->nh_group_map,
                 &nh_group->hmap_node, nh_group->hash);
+    ++ofproto->l3_mgr->hw_usage.nh_groups;
+    ofproto->l3_mgr->hw_usage.nh_entries += nh_group_hw_size(nh_group);
     return 0;
 }
 
@@ -535,7 +870,6 @@ nh_insert(xp_nh_group_entry_t *nh_group, xp_nh_entry_t *nh)
     ovs_assert(nh);
 
     /* Update NH group's hash and insert NH into the group */
-    nh->xp_nh_id = nh_group->nh_id + hmap_count(&nh_group->nh_map);
     nh_group->hash = hash_string(nh->id, nh_group->hash);
     hmap_insert(&nh_group->nh_map, &nh->hmap_node, hash_string(nh->id, 0));
 
@@ -544,9 +878,8 @@ nh_insert(xp_nh_group_entry_t *nh_group, xp_nh_entry_t *nh)
         nh_group->size = hmap_count(&nh_group->nh_map);
     }
 
-    VLOG_DBG("%s: nexthop group id %u, size %u, hash %08X, nh %s, nh id %u",
-             __FUNCTION__, nh_group->nh_id, nh_group->size,
-             nh_group->hash, nh->id, nh->xp_nh_id);
+    VLOG_DBG("%s: nexthop group size %u, hash %08X, nh %s, weight %u",
+             __FUNCTION__, nh_group->size, nh_group->hash, nh->id, nh->weight);
 }
 
 static int
@@ -589,6 +922,15 @@ nh_update(xp_l3_mgr_t *mgr, xp_nh_entry_t *xp_nh,
     return 0;
 }
 
+/* Returns configured ECMP weight of NH 'nh_id'. */
+static uint32_t
+nh_weight_get(xp_l3_mgr_t *mgr, const char *nh_id)
+{
+    uint32_t weight = simap_get(&mgr->nh_weights, nh_id);
+
+    return weight ? weight : 1;
+}
+
 static xp_nh_entry_t *
 nh_create(xp_l3_mgr_t *mgr, struct ofproto_route_nexthop *nh)
 {
@@ -606,99 +948,639 @@ nh_create(xp_l3_mgr_t *mgr, struct ofproto_route_nexthop *nh)
         free(nh_entry);
         return NULL;
     }
-    nh_entry->id = xstrdup(nh->id);
-    nh_entry->nh_port = (nh->type == OFPROTO_NH_PORT);
+    nh_entry->id = xstrdup(nh->id);
+    nh_entry->nh_port = (nh->type == OFPROTO_NH_PORT);
+    nh_entry->weight = nh_weight_get(mgr, nh->id);
+
+    return nh_entry;
+}
+
+static xp_nh_entry_t *
+nh_lookup(xp_nh_group_entry_t *nh_group, const char *nh_id)
+{
+    xp_nh_entry_t *e;
+
+    ovs_assert(nh_id);
+
+    if (nh_group) {
+        HMAP_FOR_EACH(e, hmap_node, &nh_group->nh_map) {
+            if (strcmp(e->id, nh_id) == 0) {
+                return e;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static xp_nh_group_entry_t *
+nh_group_lookup_by_route(xp_l3_mgr_t *mgr, struct ofproto_route *route)
+{
+    xp_nh_group_entry_t *e;
+    uint32_t hash;
+    bool found;
+    uint32_t i;
+
+    ovs_assert(mgr);
+    ovs_assert(route);
+
+    for (i = 0, hash = 0; i < route->n_nexthops; i++) {
+        hash = hash_string(route->nexthops[i].id, hash);
+        VLOG_DBG("%s: nexthop %s, type %u, state %u",
+                 __FUNCTION__, route->nexthops[i].id,
+                 route->nexthops[i].type, route->nexthops[i].state);
+    }
+
+    HMAP_FOR_EACH_WITH_HASH(e, hmap_node, hash, &mgr->nh_group_map) {
+        if (e->size == route->n_nexthops) {
+            VLOG_DBG("%s: nexthop group id %u, size %u",
+                     __FUNCTION__, e->nh_id, e->size);
+
+            found = true;
+            for (i = 0; i < route->n_nexthops; i++) {
+                xp_nh_entry_t *nh = nh_lookup(e, route->nexthops[i].id);
+
+                if ((nh == NULL) ||
+                    (nh->weight != nh_weight_get(mgr, nh->id))) {
+                    found = false;
+                    break;
+                }
+            }
+
+            if (found) {
+                ovs_refcount_ref(&e->ref_cnt);
+                return e;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static xp_nh_group_entry_t *
+nh_group_lookup_by_group(xp_l3_mgr_t *mgr, xp_nh_group_entry_t *nh_group)
+{
+    xp_nh_group_entry_t *e;
+    xp_nh_entry_t *nh_e;
+    bool found;
+
+    ovs_assert(mgr);
+    ovs_assert(nh_group);
+
+    HMAP_FOR_EACH_WITH_HASH(e, hmap_node, nh_group->hash, &mgr->nh_group_map) {
+        if (hmap_count(&e->nh_map) == hmap_count(&nh_group->nh_map)) {
+            found = true;
+            HMAP_FOR_EACH(nh_e, hmap_node, &nh_group->nh_map) {
+                xp_nh_entry_t *nh = nh_lookup(e, nh_e->id);
+
+                if ((nh == NULL) || (nh->weight != nh_e->weight)) {
+                    found = false;
+                    break;
+                }
+            }
+
+            if (found) {
+                ovs_refcount_ref(&e->ref_cnt);
+                return e;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* Returns route entry with 'prefix' without taking a reference. */
+static xp_route_entry_t *
+route_find(xp_l3_mgr_t *mgr, const char *prefix)
+{
+    xp_route_entry_t *e;
+
+    HMAP_FOR_EACH_WITH_HASH(e, hmap_node, hash_string(prefix, 0),
+                            &mgr->route_map) {
+        if (strcmp(e->prefix, prefix) == 0) {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+/* Formats network address of 'route' masked to 'len' bits as a prefix
+ * string in the same notation that is used for route_map keys. */
+static void
+route_prefix_format(const xp_route_entry_t *route, uint8_t len,
+                    char *buf, size_t size)
+{
+    char ip_str[INET6_ADDRSTRLEN];
+
+    if (route->xp_route.type == XP_PREFIX_TYPE_IPV4) {
+        uint32_t addr;
+
+        /* IPv4 address is kept in host order */
+        memcpy(&addr, route->xp_route.ipv4Addr, sizeof addr);
+        addr = len ? (addr & (UINT32_MAX << (32 - len))) : 0;
+        addr = htonl(addr);
+        inet_ntop(AF_INET, &addr, ip_str, sizeof ip_str);
+    } else {
+        uint8_t addr[sizeof(struct in6_addr)];
+        uint32_t i;
+
+        memcpy(addr, route->xp_route.ipv6Addr, sizeof addr);
+        for (i = 0; i < sizeof addr; i++) {
+            if (len >= (i + 1) * 8) {
+                continue;
+            }
+            addr[i] &= (len > i * 8) ? (uint8_t)(0xFF << (8 - (len - i * 8))) : 0;
+        }
+        inet_ntop(AF_INET6, addr, ip_str, sizeof ip_str);
+    }
+
+    snprintf(buf, size, "%s/%u", ip_str, len);
+}
+
+/* Returns true if 'outer' route is less specific than 'inner' route
+ * and covers it. */
+static bool
+route_prefix_covers(const xp_route_entry_t *outer,
+                    const xp_route_entry_t *inner)
+{
+    char prefix[INET6_ADDRSTRLEN + 5];
+
+    if ((outer->xp_route.type != inner->xp_route.type) ||
+        (outer->xp_route.ipMaskLen >= inner->xp_route.ipMaskLen)) {
+        return false;
+    }
+
+    route_prefix_format(inner, outer->xp_route.ipMaskLen,
+                        prefix, sizeof prefix);
+    return (strcmp(prefix, outer->prefix) == 0);
+}
+
+/* Returns the longest route from the RIB that covers 'route'. */
+static xp_route_entry_t *
+route_cover_lookup(xp_l3_mgr_t *mgr, const xp_route_entry_t *route)
+{
+    char prefix[INET6_ADDRSTRLEN + 5];
+    xp_route_entry_t *e;
+    uint8_t len;
+
+    for (len = route->xp_route.ipMaskLen; len-- > 0;) {
+        route_prefix_format(route, len, prefix, sizeof prefix);
+        e = route_find(mgr, prefix);
+        if (e) {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+/* Programs route into the HW LPM table and updates table usage. */
+static int
+route_lpm_add(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
+{
+    xp_l3_mgr_t *mgr = ofproto->l3_mgr;
+    uint32_t route_index;
+    XP_STATUS status;
+
+    route->xp_route.nhEcmpSize = route->nh_group ?
+                                 nh_group_hw_size(route->nh_group) : 0;
+    route->xp_route.nhId = route->nh_group ? route->nh_group->nh_id : 0;
+
+    status = xpsL3AddIpRouteEntry(ofproto->xpdev->id, &route->xp_route,
+                                  &route_index);
+    if (status) {
+        ++mgr->hw_usage.route_failures;
+        VLOG_ERR("Could not add route to hardware. Error: %d. "
+                 "Routes in HW: IPv4 %u, IPv6 %u",
+                 status, mgr->hw_usage.ipv4_routes,
+                 mgr->hw_usage.ipv6_routes);
+        return EAGAIN;
+    }
+
+    if (route->xp_route.type == XP_PREFIX_TYPE_IPV4) {
+        ++mgr->hw_usage.ipv4_routes;
+    } else {
+        ++mgr->hw_usage.ipv6_routes;
+    }
+    route->in_hw = true;
+
+    return 0;
+}
+
+/* Removes route from the HW LPM table and updates table usage. */
+static int
+route_lpm_remove(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
+{
+    xp_l3_mgr_t *mgr = ofproto->l3_mgr;
+    XP_STATUS status;
+
+    status = xpsL3RemoveIpRouteEntry(ofproto->xpdev->id, &route->xp_route);
+    if (status != XP_NO_ERR) {
+        VLOG_WARN("Failed to remove route from hardware. Err %d", status);
+        return EFAULT;
+    }
+
+    if (route->xp_route.type == XP_PREFIX_TYPE_IPV4) {
+        --mgr->hw_usage.ipv4_routes;
+    } else {
+        --mgr->hw_usage.ipv6_routes;
+    }
+    route->in_hw = false;
+
+    return 0;
+}
+
+/* Returns true if 'route' may be placed into the exact match host table,
+ * i.e. it is a host prefix resolved via a single nexthop. */
+static bool
+route_is_host(const xp_route_entry_t *route)
+{
+    uint8_t host_len;
+
+    host_len = (route->xp_route.type == XP_PREFIX_TYPE_IPV4) ? 32 : 128;
+
+    return (route->xp_route.ipMaskLen == host_len) && route->nh_group &&
+           (hmap_count(&route->nh_group->nh_map) == 1);
+}
+
+/* Programs host route into the HW host table and updates table usage.
+ * Host table entry keeps its own copy of the route's nexthop. */
+static int
+route_host_add(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
+{
+    xp_l3_mgr_t *mgr = ofproto->l3_mgr;
+    xp_host_entry_t *host;
+    xp_nh_entry_t *nh;
+    uint32_t hash, rehash;
+    XP_STATUS status;
+
+    nh = CONTAINER_OF(hmap_first(&route->nh_group->nh_map),
+                      xp_nh_entry_t, hmap_node);
+
+    host = host_entry_alloc(mgr);
+    host->xp_host.type = route->xp_route.type;
+    host->xp_host.vrfId = route->xp_route.vrfId;
+    host->xp_host.nhEntry = nh->xp_nh;
+    host->xp_host.nhEntry.propTTL = false;
+
+    if (route->xp_route.type == XP_PREFIX_TYPE_IPV4) {
+        memcpy(host->xp_host.ipv4Addr, route->xp_route.ipv4Addr,
+               sizeof host->xp_host.ipv4Addr);
+        memcpy(&host->ipv4_dest_addr, route->xp_route.ipv4Addr,
+               sizeof host->ipv4_dest_addr);
+    } else {
+        host->is_ipv6_addr = true;
+        memcpy(host->xp_host.ipv6Addr, route->xp_route.ipv6Addr,
+               sizeof host->xp_host.ipv6Addr);
+        memcpy(host->ipv6_dest_addr, route->xp_route.ipv6Addr,
+               sizeof host->ipv6_dest_addr);
+    }
+
+    status = xpsL3AddIpHostEntry(ofproto->xpdev->id, &host->xp_host,
+                                 &hash, &rehash);
+    if (status != XP_NO_ERR) {
+        VLOG_DBG("%s: could not add host route to host table. Error: %d",
+                 __FUNCTION__, status);
+        host_entry_free(mgr, host);
+        return EAGAIN;
+    }
+
+    host_map_insert(mgr, host, hash, rehash);
+    ++mgr->hw_usage.hosts;
+    ++mgr->hw_usage.host_routes;
+
+    route->host = host;
+    route->in_hw = true;
+    list_push_back(&route->nh_group->host_routes, &route->host_node);
+
+    return 0;
+}
+
+/* Removes host route from the HW host table and updates table usage. */
+static int
+route_host_remove(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
+{
+    xp_l3_mgr_t *mgr = ofproto->l3_mgr;
+    xp_host_entry_t *host = route->host;
+    XP_STATUS status;
+
+    status = xpsL3RemoveIpHostEntryByIndex(ofproto->xpdev->id,
+                                           hmap_node_hash(&host->hmap_node),
+                                           host->xp_host.type);
+    if (status != XP_NO_ERR) {
+        VLOG_WARN("Failed to remove host route from hardware. Err %d", status);
+    }
+
+    hmap_remove(&mgr->host_map, &host->hmap_node);
+    host_entry_free(mgr, host);
+    --mgr->hw_usage.hosts;
+    --mgr->hw_usage.host_routes;
+
+    list_remove(&route->host_node);
+    route->host = NULL;
+    route->in_hw = false;
+
+    return (status == XP_NO_ERR) ? 0 : EFAULT;
+}
+
+/* Programs route into HW. Host routes go into the host table while it has
+ * room for them, so the LPM table is left for real prefixes. */
+static int
+route_hw_add(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
+{
+    if (route_is_host(route)) {
+        if (!route_host_add(ofproto, route)) {
+            return 0;
+        }
+        ++ofproto->l3_mgr->hw_usage.host_route_fallbacks;
+    }
+
+    return route_lpm_add(ofproto, route);
+}
+
+/* Removes route from HW. */
+static int
+route_hw_remove(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
+{
+    if (route->host) {
+        return route_host_remove(ofproto, route);
+    }
+
+    return route_lpm_remove(ofproto, route);
+}
+
+/* Re-programs host table entry of host route 'route' after its NH group
+ * has changed. The route is put into the LPM table before the old entry
+ * is removed, so traffic to the host keeps being forwarded meanwhile. It
+ * stays in the LPM table if it is no longer a host route with a single
+ * nexthop or the host table has no room for it. If the LPM table is full
+ * the old entry is left in place and an error is returned. */
+static int
+route_host_replace(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
+{
+    int rc;
+
+    rc = route_lpm_add(ofproto, route);
+    if (rc) {
+        return rc;
+    }
+
+    route_host_remove(ofproto, route);
+
+    if (route_is_host(route)) {
+        if (route_host_add(ofproto, route)) {
+            ++ofproto->l3_mgr->hw_usage.host_route_fallbacks;
+        } else if (route_lpm_remove(ofproto, route)) {
+            /* Host table entry takes precedence over the LPM one */
+            VLOG_WARN("Host route %s left in LPM table", route->prefix);
+        }
+    }
+    route->in_hw = true;
+
+    return 0;
+}
+
+/* Queues 'route' which could not be placed into HW or whose host table
+ * entry could not be updated for re-programming by ops_xp_routing_run(). */
+static void
+route_stale_mark(xp_l3_mgr_t *mgr, xp_route_entry_t *route)
+{
+    if (list_is_empty(&route->stale_node)) {
+        if (list_is_empty(&mgr->stale_routes)) {
+            mgr->stale_retry_time = time_msec() + XP_L3_STALE_RETRY_INTERVAL;
+        }
+        list_push_back(&mgr->stale_routes, &route->stale_node);
+    }
+}
+
+/* Points route programmed into HW to 'nh_group'. On failure the route
+ * keeps pointing to its old NH group both in HW and in 'route'. */
+static int
+route_hw_update(struct ofproto_xpliant *ofproto, xp_route_entry_t *route,
+                xp_nh_group_entry_t *nh_group)
+{
+    xp_nh_group_entry_t *old_nh_group;
+    uint32_t old_nh_ecmp_size;
+    uint32_t old_nh_id;
+    XP_STATUS status;
+    int rc = 0;
+
+    old_nh_ecmp_size = route->xp_route.nhEcmpSize;
+    old_nh_id = route->xp_route.nhId;
+
+    route->xp_route.nhEcmpSize = nh_group ? nh_group_hw_size(nh_group) : 0;
+    route->xp_route.nhId = nh_group ? nh_group->nh_id : 0;
+
+    if (route->host) {
+        /* Host table entry has a copy of the nexthop, so re-program it. */
+        old_nh_group = route->nh_group;
+        route->nh_group = nh_group;
+        rc = route_host_replace(ofproto, route);
+        route->nh_group = old_nh_group;
+    } else {
+        status = xpsL3UpdateIpRouteEntry(ofproto->xpdev->id,
+                                         &route->xp_route);
+        if (status) {
+            VLOG_ERR("Could not update route on hardware. Err %d", status);
+            rc = EACCES;
+        }
+    }
+
+    if (rc) {
+        route->xp_route.nhEcmpSize = old_nh_ecmp_size;
+        route->xp_route.nhId = old_nh_id;
+    }
+
+    return rc;
+}
+
+/* Re-programs host table entries of routes that use 'nh_group' after
+ * its nexthops have been updated. */
+static void
+nh_group_host_routes_update(struct ofproto_xpliant *ofproto,
+                            xp_nh_group_entry_t *nh_group)
+{
+    struct ovs_list routes;
+    xp_route_entry_t *e;
+
+    /* Routes get linked back to 'nh_group', so walk a detached list. */
+    list_move(&routes, &nh_group->host_routes);
+    list_init(&nh_group->host_routes);
+
+    LIST_FOR_EACH_POP (e, host_node, &routes) {
+        list_init(&e->host_node);
+        if (route_hw_update(ofproto, e, nh_group)) {
+            /* Old entry is still in HW and has to be linked back, so
+             * the route gets updated along with the group next time. */
+            list_push_back(&nh_group->host_routes, &e->host_node);
+            route_stale_mark(ofproto->l3_mgr, e);
+            VLOG_WARN("Could not update host route %s on hardware, "
+                      "will retry", e->prefix);
+        }
+    }
+}
+
+/* Retries re-programming of host routes whose host table entries could
+ * not be updated after their NH group had changed, and placement of routes
+ * which could not be programmed into HW. */
+void
+ops_xp_routing_run(struct ofproto_xpliant *ofproto)
+{
+    xp_l3_mgr_t *mgr = ofproto->l3_mgr;
+    struct ovs_list routes;
+    xp_route_entry_t *e;
+
+    if (!mgr) {
+        return;
+    }
+
+    ovs_mutex_lock(&mgr->mutex);
+
+    if (list_is_empty(&mgr->stale_routes)
+        || time_msec() < mgr->stale_retry_time) {
+        ovs_mutex_unlock(&mgr->mutex);
+        return;
+    }
+
+    list_move(&routes, &mgr->stale_routes);
+    list_init(&mgr->stale_routes);
+
+    LIST_FOR_EACH_POP (e, stale_node, &routes) {
+        list_init(&e->stale_node);
+        if (!e->in_hw) {
+            /* Route is re-queued if it still does not fit. */
+            ++mgr->hw_usage.stale_route_retries;
+            route_compress_update(ofproto, e);
+            continue;
+        }
+
+        if (!e->host) {
+            continue;
+        }
+
+        ++mgr->hw_usage.stale_route_retries;
+        list_remove(&e->host_node);
+        list_init(&e->host_node);
+        if (route_host_replace(ofproto, e)) {
+            list_push_back(&e->nh_group->host_routes, &e->host_node);
+            route_stale_mark(mgr, e);
+        }
+    }
 
-    return nh_entry;
+    ovs_mutex_unlock(&mgr->mutex);
 }
 
-static xp_nh_entry_t *
-nh_lookup(xp_nh_group_entry_t *nh_group, const char *nh_id)
+void
+ops_xp_routing_wait(struct ofproto_xpliant *ofproto)
 {
-    xp_nh_entry_t *e;
-
-    ovs_assert(nh_id);
+    xp_l3_mgr_t *mgr = ofproto->l3_mgr;
 
-    if (nh_group) {
-        HMAP_FOR_EACH(e, hmap_node, &nh_group->nh_map) {
-            if (strcmp(e->id, nh_id) == 0) {
-                return e;
-            }
-        }
+    if (!mgr) {
+        return;
     }
 
-    return NULL;
+    ovs_mutex_lock(&mgr->mutex);
+    if (!list_is_empty(&mgr->stale_routes)) {
+        poll_timer_wait_until(mgr->stale_retry_time);
+    }
+    ovs_mutex_unlock(&mgr->mutex);
 }
 
-static xp_nh_group_entry_t *
-nh_group_lookup_by_route(xp_l3_mgr_t *mgr, struct ofproto_route *route)
+/* Moves host route with the address of neighbor 'host' from the host table
+ * into the LPM table, so the neighbor entry can take its place.
+ * Returns true if host table entry has been released. */
+static bool
+route_host_release(struct ofproto_xpliant *ofproto,
+                   const xp_host_entry_t *host)
 {
-    xp_nh_group_entry_t *e;
-    uint32_t hash;
-    bool found;
-    uint32_t i;
+    char prefix[INET6_ADDRSTRLEN + 5];
+    xp_route_entry_t *route;
+    xp_route_entry_t key;
 
-    ovs_assert(mgr);
-    ovs_assert(route);
+    memset(&key, 0, sizeof key);
+    key.xp_route.type = host->xp_host.type;
+    memcpy(key.xp_route.ipv4Addr, host->xp_host.ipv4Addr,
+           sizeof key.xp_route.ipv4Addr);
+    memcpy(key.xp_route.ipv6Addr, host->xp_host.ipv6Addr,
+           sizeof key.xp_route.ipv6Addr);
 
-    for (i = 0, hash = 0; i < route->n_nexthops; i++) {
-        hash = hash_string(route->nexthops[i].id, hash);
-        VLOG_DBG("%s: nexthop %s, type %u, state %u",
-                 __FUNCTION__, route->nexthops[i].id,
-                 route->nexthops[i].type, route->nexthops[i].state);
+    route_prefix_format(&key, host->is_ipv6_addr ? 128 : 32,
+                        prefix, sizeof prefix);
+    route = route_find(ofproto->l3_mgr, prefix);
+    if (!route || !route->host) {
+        return false;
     }
 
-    HMAP_FOR_EACH_WITH_HASH(e, hmap_node, hash, &mgr->nh_group_map) {
-        if (e->size == route->n_nexthops) {
-            VLOG_DBG("%s: nexthop group id %u, size %u",
-                     __FUNCTION__, e->nh_id, e->size);
+    VLOG_DBG("%s: move route %s to LPM table", __FUNCTION__, route->prefix);
 
-            found = true;
-            for (i = 0; i < route->n_nexthops; i++) {
-                if (nh_lookup(e, route->nexthops[i].id) == NULL) {
-                    found = false;
-                    break;
-                }
-            }
+    route_host_remove(ofproto, route);
+    if (route_lpm_add(ofproto, route)) {
+        VLOG_ERR("Could not move route %s to LPM table, will retry",
+                 route->prefix);
+        route_stale_mark(ofproto->l3_mgr, route);
+    }
 
-            if (found) {
-                ovs_refcount_ref(&e->ref_cnt);
-                return e;
-            }
+    return true;
+}
+
+/* Decides whether 'route' has to be in the HW LPM table.
+ *
+ * With route compression enabled a route which resolves to the same NH group
+ * as its closest covering route is not programmed since LPM lookup on the
+ * covering route gives the same result. Such route is linked to its cover,
+ * so it can be re-evaluated once the cover changes or goes away. */
+static void
+route_compress_update(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
+{
+    xp_l3_mgr_t *mgr = ofproto->l3_mgr;
+    xp_route_entry_t *cover = NULL;
+    bool compress = false;
+
+    if (mgr->route_compression) {
+        cover = route_cover_lookup(mgr, route);
+        compress = cover && cover->nh_group &&
+                   (cover->nh_group == route->nh_group);
+    }
+
+    if (compress && route->in_hw) {
+        route_hw_remove(ofproto, route);
+    } else if (!compress && !route->in_hw) {
+        if (route_hw_add(ofproto, route)) {
+            /* Route is neither in HW nor served by its cover. */
+            VLOG_WARN("Could not program route %s on hardware, will retry",
+                      route->prefix);
+            route_stale_mark(mgr, route);
+            cover = NULL;
         }
     }
 
-    return NULL;
+    if (route->cover) {
+        list_remove(&route->cover_node);
+        route->cover = NULL;
+    }
+
+    if (!route->in_hw && cover) {
+        route->cover = cover;
+        list_push_back(&cover->covered, &route->cover_node);
+    }
 }
 
-static xp_nh_group_entry_t *
-nh_group_lookup_by_group(xp_l3_mgr_t *mgr, xp_nh_group_entry_t *nh_group)
+/* Re-evaluates all routes that are not in HW because of 'route'. */
+static void
+route_covered_update(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
 {
-    xp_nh_group_entry_t *e;
-    xp_nh_entry_t *nh_e;
-    bool found;
-
-    ovs_assert(mgr);
-    ovs_assert(nh_group);
+    struct ovs_list covered;
+    xp_route_entry_t *e;
 
-    HMAP_FOR_EACH_WITH_HASH(e, hmap_node, nh_group->hash, &mgr->nh_group_map) {
-        if (e->size == nh_group->size) {
-            found = true;
-            HMAP_FOR_EACH(nh_e, hmap_node, &nh_group->nh_map) {
-                if (nh_lookup(e, nh_e->id) == NULL) {
-                    found = false;
-                    break;
-                }
-            }
+    /* Routes may get linked back to 'route', so walk a detached list. */
+    list_move(&covered, &route->covered);
+    list_init(&route->covered);
 
-            if (found) {
-                ovs_refcount_ref(&e->ref_cnt);
-                return e;
-            }
-        }
+    LIST_FOR_EACH_POP (e, cover_node, &covered) {
+        e->cover = NULL;
+        route_compress_update(ofproto, e);
     }
-
-    return NULL;
 }
 
 static int
@@ -709,7 +1591,6 @@ route_update(struct ofproto_xpliant *ofproto,
     xp_nh_entry_t *nh;
     bool nh_add;
     uint32_t i;
-    XP_STATUS status;
     int rc;
     xp_nh_group_entry_t *nh_group;
     uint32_t n_nexthops;
@@ -813,7 +1694,7 @@ route_update(struct ofproto_xpliant *ofproto,
                      __FUNCTION__, nh_group->nh_id);
         } else {
             /* Create NH group on hardware */
-            rc = nh_group_add(ofproto, nh_group);
+            rc = nh_group_add(ofproto, nh_group, xp_route->nh_group);
             if (rc) {
                 VLOG_ERR("Failed to add next hop group");
                 nh_group_delete(ofproto, nh_group);
@@ -824,29 +1705,36 @@ route_update(struct ofproto_xpliant *ofproto,
         }
 
         /* Update route entry */
-        xp_route->xp_route.nhEcmpSize = nh_group->size;
-        xp_route->xp_route.nhId = nh_group->nh_id;
-
-        status = xpsL3UpdateIpRouteEntry(ofproto->xpdev->id,
-                                         &xp_route->xp_route);
-        if (status) {
-            VLOG_ERR("Could not update route on hardware. Err %d", status);
-            nh_group_delete(ofproto, nh_group);
-            return EACCES;
+        if (xp_route->in_hw) {
+            rc = route_hw_update(ofproto, xp_route, nh_group);
+            if (rc) {
+                /* Other routes may share the group, so only drop the
+                 * reference of this route. */
+                nh_group_unref(ofproto, nh_group);
+                return rc;
+            }
+        } else {
+            xp_route->xp_route.nhEcmpSize = nh_group_hw_size(nh_group);
+            xp_route->xp_route.nhId = nh_group->nh_id;
         }
         nh_group_unref(ofproto, xp_route->nh_group);
         xp_route->nh_group = nh_group;
 
+        /* NH group has changed so the route and routes hidden
+         * behind it may need to be programmed. */
+        if (!xp_route->in_hw) {
+            route_compress_update(ofproto, xp_route);
+        }
+        route_covered_update(ofproto, xp_route);
+
     } else {
         /* Update NH entries on HW */
-        HMAP_FOR_EACH(nh, hmap_node, &nh_group->nh_map) {
-            status = xpsL3SetRouteNextHop(ofproto->xpdev->id,
-                                          nh->xp_nh_id, &nh->xp_nh);
-            if (status != XP_NO_ERR) {
-                VLOG_ERR("Could not set next hop on hardware. Err %d", status);
-                return EACCES;
-            }
+        if (nh_group_hw_write(ofproto, nh_group)) {
+            return EACCES;
         }
+
+        /* Host routes keep own copies of the nexthop */
+        nh_group_host_routes_update(ofproto, nh_group);
     }
 
     return 0;
@@ -856,13 +1744,13 @@ static int
 route_add(struct ofproto_xpliant *ofproto, struct ofproto_route *route)
 {
     uint8_t prefix_len;
-    uint32_t route_index;
     uint32_t hash;
     xp_nh_group_entry_t *nh_group;
     xp_l3_mgr_t *mgr;
     xp_route_entry_t *e;
+    xp_route_entry_t *cover;
+    xp_route_entry_t *covered;
     xp_nh_entry_t *nh;
-    XP_STATUS status;
     uint32_t i;
     int rc;
 
@@ -897,7 +1785,7 @@ route_add(struct ofproto_xpliant *ofproto, struct ofproto_route *route)
         }
 
         /* Create NH group on hardware */
-        rc = nh_group_add(ofproto, nh_group);
+        rc = nh_group_add(ofproto, nh_group, NULL);
         if (rc) {
             VLOG_ERR("Failed to add next hop group");
             nh_group_delete(ofproto, nh_group);
@@ -942,24 +1830,45 @@ route_add(struct ofproto_xpliant *ofproto, struct ofproto_route *route)
 
     e->nh_group = nh_group;
     e->xp_route.vrfId = ofproto->vrf_id;
-    e->xp_route.nhEcmpSize = nh_group->size;
+    e->xp_route.nhEcmpSize = nh_group_hw_size(nh_group);
     e->xp_route.nhId = nh_group->nh_id;
-
-    status = xpsL3AddIpRouteEntry(ofproto->xpdev->id, &e->xp_route,
-                                  &route_index);
-    if (status) {
-        VLOG_ERR("Could not add route to hardware. Error: %d", status);
-        nh_group_unref(ofproto, e->nh_group);
-        free(e);
-        return EAGAIN;
+    list_init(&e->covered);
+    list_init(&e->stale_node);
+
+    /* Skip programming of the route if its covering route already
+     * forwards to the same NH group. */
+    cover = mgr->route_compression ? route_cover_lookup(mgr, e) : NULL;
+    if (cover && (cover->nh_group == nh_group)) {
+        e->cover = cover;
+        list_push_back(&cover->covered, &e->cover_node);
+    } else {
+        rc = route_hw_add(ofproto, e);
+        if (rc) {
+            nh_group_unref(ofproto, e->nh_group);
+            free(e);
+            return rc;
+        }
     }
 
     e->prefix = xstrdup(route->prefix);
     hash = hash_string(route->prefix, 0);
     hmap_insert(&mgr->route_map, &e->hmap_node, hash);
 
-    VLOG_DBG("%s: RIB size %u. Added route %s",
-             __FUNCTION__, hmap_count(&mgr->route_map), route->prefix);
+    /* The new route may now be the closest cover for some routes
+     * which are not in HW. Re-evaluate them. */
+    if (cover) {
+        xp_route_entry_t *next;
+
+        LIST_FOR_EACH_SAFE (covered, next, cover_node, &cover->covered) {
+            if (covered != e && route_prefix_covers(e, covered)) {
+                route_compress_update(ofproto, covered);
+            }
+        }
+    }
+
+    VLOG_DBG("%s: RIB size %u. Added route %s%s",
+             __FUNCTION__, hmap_count(&mgr->route_map), route->prefix,
+             e->in_hw ? "" : " (compressed)");
     return 0;
 }
 
@@ -967,30 +1876,27 @@ static xp_route_entry_t *
 route_lookup(xp_l3_mgr_t *mgr, const char *prefix)
 {
     xp_route_entry_t *e;
-    uint32_t hash;
 
     ovs_assert(mgr);
     ovs_assert(prefix);
 
-    hash = hash_string(prefix, 0);
     VLOG_DBG("%s: Search for route %s with hash %08X",
-             __FUNCTION__, prefix, hash);
+             __FUNCTION__, prefix, hash_string(prefix, 0));
 
-    HMAP_FOR_EACH_WITH_HASH(e, hmap_node, hash, &mgr->route_map) {
-        if (strcmp(e->prefix, prefix) == 0) {
-            ovs_refcount_ref(&e->ref_cnt);
-            return e;
-        }
+    e = route_find(mgr, prefix);
+    if (e) {
+        ovs_refcount_ref(&e->ref_cnt);
     }
 
-    return NULL;
+    return e;
 }
 
 static void
 route_delete(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
 {
+    xp_route_entry_t *e;
+    xp_route_entry_t *next;
     xp_l3_mgr_t *mgr;
-    XP_STATUS status;
 
     ovs_assert(ofproto);
     ovs_assert(ofproto->l3_mgr);
@@ -1003,9 +1909,25 @@ route_delete(struct ofproto_xpliant *ofproto, xp_route_entry_t *route)
     VLOG_DBG("%s: RIB size %u. Removed route %s",
              __FUNCTION__, hmap_count(&mgr->route_map), route->prefix);
 
-    status = xpsL3RemoveIpRouteEntry(ofproto->xpdev->id, &route->xp_route);
-    if (status != XP_NO_ERR) {
-        VLOG_WARN("Failed to remove route from hardware. Err %d", status);
+    if (route->in_hw) {
+        route_hw_remove(ofproto, route);
+    }
+
+    if (!list_is_empty(&route->stale_node)) {
+        list_remove(&route->stale_node);
+    }
+
+    if (route->cover) {
+        list_remove(&route->cover_node);
+        route->cover = NULL;
+    }
+
+    /* Routes hidden behind this one have to find a new cover
+     * or be programmed into HW. */
+    LIST_FOR_EACH_SAFE (e, next, cover_node, &route->covered) {
+        list_remove(&e->cover_node);
+        e->cover = NULL;
+        route_compress_update(ofproto, e);
     }
 
     nh_group_unref(ofproto, route->nh_group);
@@ -1079,7 +2001,6 @@ delete_nh_entry(struct ofproto_xpliant *ofproto, struct ofproto_route *route)
     xp_route_entry_t *e;
     xp_nh_entry_t *nh;
     uint32_t n_nexthops;
-    XP_STATUS status;
     xp_nh_group_entry_t *nh_group;
     xp_nh_group_entry_t *old_nh_group;
     int rc;
@@ -1151,7 +2072,7 @@ delete_nh_entry(struct ofproto_xpliant *ofproto, struct ofproto_route *route)
                      __FUNCTION__, nh_group->nh_id);
         } else {
             /* Create NH group on hardware */
-            rc = nh_group_add(ofproto, nh_group);
+            rc = nh_group_add(ofproto, nh_group, e->nh_group);
             if (rc) {
                 VLOG_ERR("Failed to add NH group");
                 route_unref(ofproto, e);
@@ -1161,30 +2082,34 @@ delete_nh_entry(struct ofproto_xpliant *ofproto, struct ofproto_route *route)
             VLOG_DBG("%s: create new NH group %u",
                      __FUNCTION__, nh_group->nh_id);
         }
-
-        e->xp_route.nhEcmpSize = nh_group->size;
-        e->xp_route.nhId = nh_group->nh_id;
     } else {
         VLOG_DBG("%s: ofproto %s, route %s without nexthops",
                  __FUNCTION__, ofproto->up.name, e->prefix);
         nh_group = NULL;
-        e->xp_route.nhEcmpSize = 0;
-        e->xp_route.nhId = 0;
     }
 
-    status = xpsL3UpdateIpRouteEntry(ofproto->xpdev->id, &e->xp_route);
-    if (status) {
-        VLOG_ERR("Could not update route on hardware. Err %d", status);
-        if (nh_group) {
-            /* Delete NH group that just has been created */
-            nh_group_delete(ofproto, nh_group);
+    if (e->in_hw) {
+        if (route_hw_update(ofproto, e, nh_group)) {
+            /* Other routes may share the group, so only drop the
+             * reference of this route. */
+            nh_group_unref(ofproto, nh_group);
+            route_unref(ofproto, e);
+            return EPERM;
         }
-        route_unref(ofproto, e);
-        return EPERM;
+    } else {
+        e->xp_route.nhEcmpSize = nh_group ? nh_group_hw_size(nh_group) : 0;
+        e->xp_route.nhId = nh_group ? nh_group->nh_id : 0;
     }
 
     nh_group_unref(ofproto, e->nh_group);
     e->nh_group = nh_group;
+
+    /* NH group has changed so the route and routes hidden
+     * behind it may need to be programmed. */
+    if (!e->in_hw) {
+        route_compress_update(ofproto, e);
+    }
+    route_covered_update(ofproto, e);
     route_unref(ofproto, e);
 
     return 0;
@@ -1855,9 +2780,9 @@ unixctl_l3_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
     const struct ofproto_xpliant *ofproto = NULL;
     struct ds d_str = DS_EMPTY_INITIALIZER;
 
-    ds_put_cstr(&d_str, "=================================================\n");
-    ds_put_cstr(&d_str, "VRF            Routes      Hosts       NH Groups \n");
-    ds_put_cstr(&d_str, "=================================================\n");
+    ds_put_cstr(&d_str, "=========================================================\n");
+    ds_put_cstr(&d_str, "VRF            ID      Routes      Hosts       NH Groups \n");
+    ds_put_cstr(&d_str, "=========================================================\n");
 
     sset_init(&names);
     ofproto_enumerate_names("vrf", &names);
@@ -1866,8 +2791,8 @@ unixctl_l3_show(struct unixctl_conn *conn, int argc OVS_UNUSED,
 
         if (ofproto && ofproto->l3_mgr) {
             ovs_mutex_lock(&ofproto->l3_mgr->mutex);
-            ds_put_format(&d_str, "%-15s%-12u%-12u%-12u\n",
-                          ofproto->up.name,
+            ds_put_format(&d_str, "%-15s%-8"PRIuSIZE"%-12u%-12u%-12u\n",
+                          ofproto->up.name, ofproto->vrf_id,
                           hmap_count(&ofproto->l3_mgr->route_map),
                           hmap_count(&ofproto->l3_mgr->host_map),
                           hmap_count(&ofproto->l3_mgr->nh_group_map));
@@ -2029,6 +2954,7 @@ l3_mgr_show_nexthops(xp_l3_mgr_t *mgr, struct ds *d_str)
         uint32_t nh_cnt = 0;
         HMAP_FOR_EACH(nh_e, hmap_node, &nhg_e->nh_map) {
             char mac_str[XP_STR_MAC_BUF_LEN];
+            char nh_str[64];
             macAddr_t macDa;
 
             if (nh_cnt == 0) {
@@ -2042,8 +2968,15 @@ l3_mgr_show_nexthops(xp_l3_mgr_t *mgr, struct ds *d_str)
             snprintf(mac_str, sizeof(mac_str),
                      ETH_ADDR_FMT, ETH_ADDR_BYTES_ARGS(macDa));
 
+            if (nh_e->weight != 1) {
+                snprintf(nh_str, sizeof nh_str, "%s*%u",
+                         nh_e->id, nh_e->weight);
+            } else {
+                snprintf(nh_str, sizeof nh_str, "%s", nh_e->id);
+            }
+
             ds_put_format(d_str, "%-20s%-20s%-15u%-15u%-14u%s\n",
-                          nh_e->id, mac_str,
+                          nh_str, mac_str,
                           nh_e->xp_nh.nextHop.l3InterfaceId,
                           nh_e->xp_nh.nextHop.egressIntfId,
                           nh_e->xp_nh.serviceInstId,
@@ -2073,6 +3006,187 @@ unixctl_l3_show_nexthops(struct unixctl_conn *conn, int argc OVS_UNUSED,
     ds_destroy(&d_str);
 }
 
+static void
+l3_mgr_show_usage(xp_l3_mgr_t *mgr, struct ds *d_str)
+{
+    uint32_t hw_routes;
+    uint32_t routes;
+
+    if (!mgr) {
+        VLOG_ERR("%s, No L3 manager present.", __FUNCTION__);
+        return;
+    }
+
+    ovs_assert(d_str);
+
+    ovs_mutex_lock(&mgr->mutex);
+
+    routes = hmap_count(&mgr->route_map);
+    hw_routes = mgr->hw_usage.ipv4_routes + mgr->hw_usage.ipv6_routes +
+                mgr->hw_usage.host_routes;
+
+    ds_put_cstr(d_str, "====================================================\n");
+    ds_put_format(d_str, "Route compression : %s\n",
+                  mgr->route_compression ? "enabled" : "disabled");
+    ds_put_format(d_str, "RIB routes        : %u\n", routes);
+    ds_put_format(d_str, "HW IPv4 routes    : %u\n", mgr->hw_usage.ipv4_routes);
+    ds_put_format(d_str, "HW IPv6 routes    : %u\n", mgr->hw_usage.ipv6_routes);
+    ds_put_format(d_str, "HW host routes    : %u\n",
+                  mgr->hw_usage.host_routes);
+    ds_put_format(d_str, "Host routes in LPM: %u\n",
+                  mgr->hw_usage.host_route_fallbacks);
+    ds_put_format(d_str, "Stale routes      : %"PRIuSIZE" (%u retries)\n",
+                  list_size(&mgr->stale_routes),
+                  mgr->hw_usage.stale_route_retries);
+    ds_put_format(d_str, "Compressed routes : %u\n",
+                  routes > hw_routes ? routes - hw_routes : 0);
+    if (mgr->ecmp_buckets) {
+        ds_put_format(d_str, "ECMP buckets      : %u\n", mgr->ecmp_buckets);
+    } else {
+        ds_put_cstr(d_str, "ECMP buckets      : disabled\n");
+    }
+    ds_put_format(d_str, "HW hosts          : %u\n", mgr->hw_usage.hosts);
+    ds_put_format(d_str, "HW NH groups      : %u\n", mgr->hw_usage.nh_groups);
+    ds_put_format(d_str, "HW nexthops       : %u\n", mgr->hw_usage.nh_entries);
+    ds_put_format(d_str, "Route add errors  : %u\n",
+                  mgr->hw_usage.route_failures);
+    ds_put_format(d_str, "Host add errors   : %u\n",
+                  mgr->hw_usage.host_failures);
+    ds_put_cstr(d_str, "====================================================\n");
+
+    ovs_mutex_unlock(&mgr->mutex);
+}
+
+static void
+unixctl_l3_show_usage(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                      const char *argv[], void *aux OVS_UNUSED)
+{
+    const struct ofproto_xpliant *ofproto = NULL;
+    struct ds d_str = DS_EMPTY_INITIALIZER;
+
+    ofproto = ops_xp_ofproto_lookup(argv[1]);
+    if (!ofproto) {
+        unixctl_command_reply_error(conn, "no such VRF");
+        return;
+    }
+
+    l3_mgr_show_usage(ofproto->l3_mgr, &d_str);
+    unixctl_command_reply(conn, ds_cstr(&d_str));
+    ds_destroy(&d_str);
+}
+
+/* Enables or disables route compression and re-evaluates all routes, so
+ * routes get removed from or programmed back into HW LPM table. */
+static void
+l3_mgr_route_compression_set(struct ofproto_xpliant *ofproto, bool enable)
+{
+    xp_l3_mgr_t *mgr = ofproto->l3_mgr;
+    xp_route_entry_t *e;
+
+    ovs_mutex_lock(&mgr->mutex);
+
+    if (mgr->route_compression != enable) {
+        mgr->route_compression = enable;
+
+        HMAP_FOR_EACH (e, hmap_node, &mgr->route_map) {
+            if (enable || !e->in_hw) {
+                route_compress_update(ofproto, e);
+            }
+        }
+    }
+
+    ovs_mutex_unlock(&mgr->mutex);
+}
+
+static void
+unixctl_l3_route_compression(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                             const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ofproto_xpliant *ofproto = NULL;
+    bool enable;
+
+    ofproto = ops_xp_ofproto_lookup(argv[1]);
+    if (!ofproto || !ofproto->l3_mgr) {
+        unixctl_command_reply_error(conn, "no such VRF");
+        return;
+    }
+
+    if (STR_EQ(argv[2], "on")) {
+        enable = true;
+    } else if (STR_EQ(argv[2], "off")) {
+        enable = false;
+    } else {
+        unixctl_command_reply_error(conn, "invalid mode (on|off)");
+        return;
+    }
+
+    l3_mgr_route_compression_set(ofproto, enable);
+    unixctl_command_reply(conn, enable ? "route compression enabled" :
+                                         "route compression disabled");
+}
+
+/* Sets number of buckets of resilient ECMP groups. Applies to NH groups
+ * created afterwards. */
+static void
+unixctl_l3_ecmp_resilient(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                          const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ofproto_xpliant *ofproto = NULL;
+    uint32_t buckets = 0;
+
+    ofproto = ops_xp_ofproto_lookup(argv[1]);
+    if (!ofproto || !ofproto->l3_mgr) {
+        unixctl_command_reply_error(conn, "no such VRF");
+        return;
+    }
+
+    if (!STR_EQ(argv[2], "off")) {
+        if (!ovs_scan(argv[2], "%u", &buckets) ||
+            (buckets < 2) || (buckets > XP_L3_ECMP_MAX_BUCKETS)) {
+            unixctl_command_reply_error(conn, "invalid number of buckets");
+            return;
+        }
+    }
+
+    ovs_mutex_lock(&ofproto->l3_mgr->mutex);
+    ofproto->l3_mgr->ecmp_buckets = buckets;
+    ovs_mutex_unlock(&ofproto->l3_mgr->mutex);
+
+    unixctl_command_reply(conn, buckets ? "resilient ECMP enabled" :
+                                          "resilient ECMP disabled");
+}
+
+/* Sets ECMP weight of a NH. Applies to NH groups created afterwards. */
+static void
+unixctl_l3_nexthop_weight(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                          const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ofproto_xpliant *ofproto = NULL;
+    uint32_t weight = 0;
+
+    ofproto = ops_xp_ofproto_lookup(argv[1]);
+    if (!ofproto || !ofproto->l3_mgr) {
+        unixctl_command_reply_error(conn, "no such VRF");
+        return;
+    }
+
+    if (!ovs_scan(argv[3], "%u", &weight) ||
+        (weight < 1) || (weight > XP_L3_ECMP_MAX_BUCKETS)) {
+        unixctl_command_reply_error(conn, "invalid weight");
+        return;
+    }
+
+    ovs_mutex_lock(&ofproto->l3_mgr->mutex);
+    if (weight == 1) {
+        simap_find_and_delete(&ofproto->l3_mgr->nh_weights, argv[2]);
+    } else {
+        simap_put(&ofproto->l3_mgr->nh_weights, argv[2], weight);
+    }
+    ovs_mutex_unlock(&ofproto->l3_mgr->mutex);
+
+    unixctl_command_reply(conn, NULL);
+}
+
 static void
 l3_test_routes(struct ofproto_xpliant *ofproto, const char *prefix,
                uint32_t count, uint32_t ignore_err)
@@ -2158,9 +3272,9 @@ l3_test_routes(struct ofproto_xpliant *ofproto, const char *prefix,
         t2.tv_usec = usec;
         timeradd(&t2, &t1, &r);
 
-        /* Update L3 Manager statistics */
+        /* Update test statistics */
         {
-            ovs_mutex_lock(&ofproto->l3_mgr->mutex);
+            ovs_mutex_lock(&dbg->mutex);
 
             dbg->exec_sec = r.tv_sec;
             dbg->exec_usec = r.tv_usec;
@@ -2188,7 +3302,7 @@ l3_test_routes(struct ofproto_xpliant *ofproto, const char *prefix,
                 }
             }
 
-            ovs_mutex_unlock(&ofproto->l3_mgr->mutex);
+            ovs_mutex_unlock(&dbg->mutex);
         }
     }
 
@@ -2248,9 +3362,9 @@ unixctl_l3_test_add_routes(struct unixctl_conn *conn, int argc OVS_UNUSED,
     }
 
     /* Check that the test is not currently running */
-    ovs_mutex_lock(&ofproto->l3_mgr->mutex);
+    ovs_mutex_lock(&dbg->mutex);
     if (dbg->started) {
-        ovs_mutex_unlock(&ofproto->l3_mgr->mutex);
+        ovs_mutex_unlock(&dbg->mutex);
         unixctl_command_reply_error(conn, "Failed to start test. "
                                     "Another test is currently running.");
         return;
@@ -2262,7 +3376,7 @@ unixctl_l3_test_add_routes(struct unixctl_conn *conn, int argc OVS_UNUSED,
     dbg->started = true;
     dbg->add_routes = true;
     dbg->kickout = false;
-    ovs_mutex_unlock(&ofproto->l3_mgr->mutex);
+    ovs_mutex_unlock(&dbg->mutex);
 
     params.ofproto = ofproto;
     params.prefix = xstrdup(prefix_s);
@@ -2324,9 +3438,9 @@ unixctl_l3_test_del_routes(struct unixctl_conn *conn, int argc OVS_UNUSED,
     }
 
     /* Check that the test is not currently running */
-    ovs_mutex_lock(&ofproto->l3_mgr->mutex);
+    ovs_mutex_lock(&dbg->mutex);
     if (dbg->started) {
-        ovs_mutex_unlock(&ofproto->l3_mgr->mutex);
+        ovs_mutex_unlock(&dbg->mutex);
         unixctl_command_reply_error(conn, "Failed to start test. "
                                     "Another test is currently running.");
         return;
@@ -2338,7 +3452,7 @@ unixctl_l3_test_del_routes(struct unixctl_conn *conn, int argc OVS_UNUSED,
     dbg->started = true;
     dbg->add_routes = false;
     dbg->kickout = false;
-    ovs_mutex_unlock(&ofproto->l3_mgr->mutex);
+    ovs_mutex_unlock(&dbg->mutex);
 
     params.ofproto = ofproto;
     params.prefix = xstrdup(prefix_s);
@@ -2374,6 +3488,7 @@ unixctl_l3_test_show_routes(struct unixctl_conn *conn, int argc OVS_UNUSED,
         return;
     }
 
+    ovs_mutex_lock(&dbg->mutex);
     ds_put_cstr(&d_str, "====================================================\n");
     ds_put_format(&d_str, "Test state        : %s\n",
                   dbg->started ? (dbg->add_routes ?
@@ -2390,6 +3505,7 @@ unixctl_l3_test_show_routes(struct unixctl_conn *conn, int argc OVS_UNUSED,
     ds_put_format(&d_str, "Execution time    : %u.%06u seconds\n",
                   dbg->exec_sec, dbg->exec_usec);
     ds_put_cstr(&d_str, "====================================================\n");
+    ovs_mutex_unlock(&dbg->mutex);
 
     unixctl_command_reply(conn, ds_cstr(&d_str));
     ds_destroy(&d_str);
@@ -2412,6 +3528,14 @@ ops_xp_routing_unixctl_init(void)
                              unixctl_l3_show_hosts, NULL);
     unixctl_command_register("xp/l3/show-nexthops", "vrf", 1, 1,
                              unixctl_l3_show_nexthops, NULL);
+    unixctl_command_register("xp/l3/show-usage", "vrf", 1, 1,
+                             unixctl_l3_show_usage, NULL);
+    unixctl_command_register("xp/l3/route-compression", "vrf {on|off}", 2, 2,
+                             unixctl_l3_route_compression, NULL);
+    unixctl_command_register("xp/l3/ecmp-resilient", "vrf {buckets|off}", 2, 2,
+                             unixctl_l3_ecmp_resilient, NULL);
+    unixctl_command_register("xp/l3/nexthop-weight", "vrf nexthop weight",
+                             3, 3, unixctl_l3_nexthop_weight, NULL);
     unixctl_command_register("xp/l3/test/add-routes",
                              "vrf {start_prefix | file} [count [ignore_err]]",
                              2, 4, unixctl_l3_test_add_routes, NULL);
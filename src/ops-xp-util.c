@@ -27,12 +27,14 @@
 #include <sys/ioctl.h>
 #include <net/ethernet.h>
 #include <netinet/ether.h>
+#include <netinet/in.h>
 #include <netpacket/packet.h>
 #include <sys/select.h>
 
 #include "smap.h"
 #include "socket-util.h"
 #include "ops-xp-util.h"
+#include "ops-xp-netlink.h"
 #include "openXpsPort.h"
 
 
@@ -246,18 +248,6 @@ ops_xp_parse_netmask_str(const char *netmask_str, ovs_be32 *mask)
     return 0;
 }
 
-int
-ops_xp_linux_route_update(bool route_add, const char *prefix,
-                          const char *nh, bool nh_port)
-{
-    VLOG_DBG("%s: %s route %s nexthop %s",
-             __FUNCTION__, route_add ? "Add" : "Delete", prefix, nh);
-
-    return ops_xp_system("route %s -net %s %s %s",
-                         (route_add ? "add" : "del"), prefix,
-                         (nh_port ? "dev" : "gw"), nh);
-}
-
 bool
 ops_xp_is_l3_packet(void* buf, uint16_t bufSize)
 {
@@ -308,6 +298,78 @@ ops_xp_is_ip_packet(void* buf, uint16_t bufSize)
     return false;
 }
 
+/* Parses headers of the Ethernet frame of @size bytes at @pkt into
+ * @hdrs. Headers the frame is too short for are left unset. Returns
+ * false if the frame has no complete Ethernet header. */
+bool
+ops_xp_pkt_parse(const uint8_t *pkt, size_t size, struct xp_pkt_hdrs *hdrs)
+{
+    size_t ofs = 2 * ETH_ADDR_LEN;
+    size_t l4_ofs = 0;
+
+    memset(hdrs, 0, sizeof *hdrs);
+
+    if (size < ETH_HEADER_LEN) {
+        return false;
+    }
+
+    hdrs->eth_dst = pkt;
+
+    /* IEEE reserved 01:80:C2:00:00:0X addresses carry STP, LLDP and
+     * slow protocols */
+    hdrs->link_local = pkt[0] == 0x01 && pkt[1] == 0x80 && pkt[2] == 0xC2 &&
+                       !pkt[3] && !pkt[4] && !(pkt[5] & 0xF0);
+
+    hdrs->eth_type = (pkt[ofs] << 8) | pkt[ofs + 1];
+    ofs += 2;
+    while ((hdrs->eth_type == ETH_TYPE_VLAN_8021Q ||
+            hdrs->eth_type == ETH_TYPE_VLAN_8021AD) && size >= ofs + 4) {
+        hdrs->eth_type = (pkt[ofs + 2] << 8) | pkt[ofs + 3];
+        ofs += 4;
+    }
+
+    switch (hdrs->eth_type) {
+    case ETH_TYPE_IP:
+        if (size < ofs + IP_HEADER_LEN) {
+            return true;
+        }
+        hdrs->ip = true;
+        hdrs->ip_options = (pkt[ofs] & 0x0F) > IP_HEADER_LEN / 4;
+        hdrs->ip_proto = pkt[ofs + 9];
+        hdrs->ip_ttl = pkt[ofs + 8];
+        hdrs->ip_mcast = (pkt[ofs + 16] & 0xF0) == 0xE0 ||
+                         (pkt[ofs + 16] == 0xFF && pkt[ofs + 17] == 0xFF &&
+                          pkt[ofs + 18] == 0xFF && pkt[ofs + 19] == 0xFF);
+        /* Only the first fragment has L4 header */
+        if (!(((pkt[ofs + 6] << 8) | pkt[ofs + 7]) & 0x1FFF)) {
+            l4_ofs = ofs + (pkt[ofs] & 0x0F) * 4;
+        }
+        break;
+    case ETH_TYPE_IPV6:
+        if (size < ofs + IPV6_HEADER_LEN) {
+            return true;
+        }
+        hdrs->ip = true;
+        hdrs->ip_proto = pkt[ofs + 6];
+        hdrs->ip_ttl = pkt[ofs + 7];
+        hdrs->ip_options = hdrs->ip_proto == IPPROTO_HOPOPTS;
+        hdrs->ip_mcast = pkt[ofs + 24] == 0xFF;
+        l4_ofs = ofs + IPV6_HEADER_LEN;
+        break;
+    default:
+        return true;
+    }
+
+    if (l4_ofs && (hdrs->ip_proto == IPPROTO_TCP ||
+                   hdrs->ip_proto == IPPROTO_UDP) && size >= l4_ofs + 4) {
+        hdrs->l4_ports = true;
+        hdrs->src_port = (pkt[l4_ofs] << 8) | pkt[l4_ofs + 1];
+        hdrs->dst_port = (pkt[l4_ofs + 2] << 8) | pkt[l4_ofs + 3];
+    }
+
+    return true;
+}
+
 /* Copies src mac into dst mac in reverse order. */
 void
 ops_xp_mac_copy_and_reverse(uint8_t *dst_mac, const uint8_t *src_mac)
@@ -487,36 +549,32 @@ ops_xp_tun_alloc(char *name, int flags)
 int
 ops_xp_net_if_setup(char *intf_name, struct ether_addr *mac)
 {
-    int  rc = 0;
+    struct xp_nl_batch *batch = ops_xp_nl_batch_create();
     char buf[32] = {0};
+    int rc;
 
-    /* Bring the Ethernet interface DOWN. */
-    rc = ops_xp_system("/sbin/ifconfig %s down", intf_name);
-    if (rc != 0) {
-        VLOG_ERR("Failed to bring down %s interface. (rc=%d)",
-                 intf_name, rc);
-        return EFAULT;
+    /* Bring the interface DOWN, set its MAC address and bring it UP
+     * in a single rtnetlink transaction. */
+    rc = ops_xp_nl_batch_link(batch, intf_name, NULL, false);
+    if (!rc) {
+        rc = ops_xp_nl_batch_link(batch, intf_name, mac, false);
     }
-
-    /* Set MAC address for the Ethernet interface. */
-    rc = ops_xp_system("/sbin/ip link set %s address %s",
-                       intf_name, ether_ntoa_r(mac, buf));
-    if (rc != 0) {
-        VLOG_ERR("Failed to set MAC address for %s interface. (rc=%d)",
-                 intf_name, rc);
-        return EFAULT;
+    if (!rc) {
+        rc = ops_xp_nl_batch_link(batch, intf_name, NULL, true);
     }
+    if (!rc) {
+        rc = ops_xp_nl_batch_commit(batch);
+    }
+    ops_xp_nl_batch_destroy(batch);
 
-    VLOG_INFO("Set MAC address for %s to %s", intf_name, buf);
-
-    /* Bring the Ethernet interface UP. */
-    rc = ops_xp_system("/sbin/ifconfig %s up", intf_name);
     if (rc != 0) {
-        VLOG_ERR("Failed to bring up %s interface. (rc=%d)",
-                 intf_name, rc);
+        VLOG_ERR("Failed to set up %s interface. (rc=%d)", intf_name, rc);
         return EFAULT;
     }
 
+    VLOG_INFO("Set MAC address for %s to %s",
+              intf_name, ether_ntoa_r(mac, buf));
+
     return 0;
 }
 